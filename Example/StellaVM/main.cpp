@@ -73,6 +73,20 @@ auto error_code_name(const ErrorCode code) -> const char*
             return "native_reentrancy";
         case ErrorCode::bytecode_limit_exceeded:
             return "bytecode_limit_exceeded";
+        case ErrorCode::invalid_record_index:
+            return "invalid_record_index";
+        case ErrorCode::invalid_field_index:
+            return "invalid_field_index";
+        case ErrorCode::unsupported_operation:
+            return "unsupported_operation";
+        case ErrorCode::not_suspended:
+            return "not_suspended";
+        case ErrorCode::snapshot_mismatch:
+            return "snapshot_mismatch";
+        case ErrorCode::invalid_string_access:
+            return "invalid_string_access";
+        case ErrorCode::stale_intern_table:
+            return "stale_intern_table";
     }
     return "unknown";
 }
@@ -365,7 +379,7 @@ auto run_buffer_heavy_case() -> stella::vm::Result<BenchmarkStats>
         [&](const std::uint64_t iteration) -> Result<std::uint64_t> {
             constexpr std::size_t payload_size = 512;
 
-            MoveBuffer payload(payload_size);
+            MoveBuffer payload = MoveBuffer::uninitialized(payload_size);
             auto bytes = payload.bytes();
             const std::int64_t seed = sample_input(iteration);
             for (std::size_t i = 0; i < bytes.size(); ++i)
@@ -397,6 +411,65 @@ auto run_buffer_heavy_case() -> stella::vm::Result<BenchmarkStats>
         });
 }
 
+auto run_buffer_opcode_case() -> stella::vm::Result<BenchmarkStats>
+{
+    using namespace stella::vm;
+
+    VM vm;
+
+    Program program;
+    program.code = {
+        {OpCode::push_input, 0},
+        {OpCode::buffer_xor_const, 0x5A},
+        {OpCode::buffer_hash, 0},
+        {OpCode::halt, 0},
+    };
+
+    const auto verify = vm.verify(program, 1);
+    if (!verify.has_value())
+    {
+        return std::unexpected(verify.error());
+    }
+
+    return run_case(
+        "Buffer Opcodes (xor/crc32c)",
+        10'000,
+        200'000,
+        [&](const std::uint64_t iteration) -> Result<std::uint64_t> {
+            constexpr std::size_t payload_size = 512;
+
+            MoveBuffer payload = MoveBuffer::uninitialized(payload_size);
+            auto bytes = payload.bytes();
+            const std::int64_t seed = sample_input(iteration);
+            for (std::size_t i = 0; i < bytes.size(); ++i)
+            {
+                const auto value = static_cast<std::uint8_t>((seed + static_cast<std::int64_t>(i * 13U)) & 0xFF);
+                bytes[i] = std::byte {value};
+            }
+
+            vm.clear_inputs();
+            const auto index = static_cast<std::uint32_t>(vm.push_input(Value::owned_buffer(std::move(payload))));
+            if (index != 0)
+            {
+                return make_unexpected(
+                    ErrorCode::invalid_input_index,
+                    "Expected input slot 0 after clear_inputs.");
+            }
+
+            Result<Value> result = vm.run_unchecked(program);
+            if (!result.has_value())
+            {
+                return std::unexpected(result.error());
+            }
+            if (!result->is_i64())
+            {
+                return make_unexpected(ErrorCode::type_mismatch, "Buffer opcode case returned non-i64.");
+            }
+
+            return static_cast<std::uint64_t>(result->as_i64());
+        });
+}
+
 auto run_branchy_case() -> stella::vm::Result<BenchmarkStats>
 {
     using namespace stella::vm;
@@ -494,7 +567,7 @@ auto run_benchmark_suite() -> stella::vm::VoidResult
     using namespace stella::vm;
 
     std::vector<BenchmarkStats> all_stats;
-    all_stats.reserve(4);
+    all_stats.reserve(5);
 
     Result<BenchmarkStats> arith = run_arith_heavy_case();
     if (!arith.has_value())
@@ -517,6 +590,13 @@ auto run_benchmark_suite() -> stella::vm::VoidResult
     }
     all_stats.push_back(buffer_heavy.value());
 
+    Result<BenchmarkStats> buffer_opcodes = run_buffer_opcode_case();
+    if (!buffer_opcodes.has_value())
+    {
+        return std::unexpected(buffer_opcodes.error());
+    }
+    all_stats.push_back(buffer_opcodes.value());
+
     Result<BenchmarkStats> branchy = run_branchy_case();
     if (!branchy.has_value())
     {
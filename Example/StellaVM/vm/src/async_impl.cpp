@@ -0,0 +1,233 @@
+module;
+#include <condition_variable>
+#include <coroutine>
+#include <expected>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+module vm;
+
+namespace stella::vm
+{
+struct PendingValue::State final
+{
+    std::mutex mutex;
+    std::condition_variable completed;
+    std::optional<Result<Value>> result;
+    std::move_only_function<void()> continuation;
+};
+
+PendingValueAwaiter::PendingValueAwaiter(PendingValue pending) noexcept
+    : pending_(std::move(pending))
+{
+}
+
+auto PendingValueAwaiter::await_ready() const -> bool
+{
+    return pending_.ready();
+}
+
+void PendingValueAwaiter::await_suspend(std::coroutine_handle<> continuation) const
+{
+    pending_.on_ready([continuation] { continuation.resume(); });
+}
+
+auto PendingValueAwaiter::await_resume() const -> Result<Value>
+{
+    return pending_.take();
+}
+
+auto PendingValue::create() -> PendingValue
+{
+    PendingValue pending;
+    pending.state_ = std::make_shared<State>();
+    return pending;
+}
+
+auto PendingValue::completed(Result<Value> result) -> PendingValue
+{
+    PendingValue pending = create();
+    pending.state_->result.emplace(std::move(result));
+    return pending;
+}
+
+void PendingValue::complete(Result<Value> result) const
+{
+    std::move_only_function<void()> continuation;
+    {
+        const std::scoped_lock lock(state_->mutex);
+        if (state_->result.has_value())
+        {
+            return;
+        }
+        state_->result.emplace(std::move(result));
+        continuation = std::move(state_->continuation);
+    }
+    state_->completed.notify_all();
+
+    // Outside the lock: the continuation commonly resumes a VM or coroutine that takes the result right away.
+    if (continuation)
+    {
+        continuation();
+    }
+}
+
+PendingValue::operator bool() const noexcept
+{
+    return state_ != nullptr;
+}
+
+auto PendingValue::ready() const -> bool
+{
+    const std::scoped_lock lock(state_->mutex);
+    return state_->result.has_value();
+}
+
+void PendingValue::wait() const
+{
+    std::unique_lock lock(state_->mutex);
+    state_->completed.wait(lock, [this] { return state_->result.has_value(); });
+}
+
+auto PendingValue::take() const -> Result<Value>
+{
+    const std::scoped_lock lock(state_->mutex);
+    return std::move(state_->result).value();
+}
+
+void PendingValue::on_ready(std::move_only_function<void()> continuation) const
+{
+    {
+        const std::scoped_lock lock(state_->mutex);
+        if (!state_->result.has_value())
+        {
+            state_->continuation = std::move(continuation);
+            return;
+        }
+    }
+    continuation();
+}
+
+auto PendingValue::operator co_await() const noexcept -> PendingValueAwaiter
+{
+    return PendingValueAwaiter(*this);
+}
+
+RunAwaitable::RunAwaitable(VM& vm, const Program& program, Executor& executor) noexcept
+    : vm_(&vm)
+    , program_(&program)
+    , executor_(&executor)
+{
+}
+
+auto RunAwaitable::await_ready() const noexcept -> bool
+{
+    return false;
+}
+
+void RunAwaitable::await_suspend(std::coroutine_handle<> continuation)
+{
+    continuation_ = continuation;
+    executor_->execute([this] { advance(vm_->run_resumable(*program_)); });
+}
+
+auto RunAwaitable::await_resume() -> Result<Value>
+{
+    return std::move(result_);
+}
+
+void RunAwaitable::advance(Result<RunSlice> slice)
+{
+    if (slice.has_value() && slice->status == RunStatus::awaiting_native)
+    {
+        slice->pending.on_ready([this] { executor_->execute([this] { advance(vm_->resume()); }); });
+        return;
+    }
+    if (slice.has_value() && slice->status != RunStatus::completed)
+    {
+        executor_->execute([this] { advance(vm_->resume()); });
+        return;
+    }
+
+    if (slice.has_value())
+    {
+        result_ = std::move(slice->value);
+    }
+    else
+    {
+        result_ = std::unexpected(slice.error());
+    }
+    continuation_.resume();
+}
+
+StepSequence::Iterator::Iterator(StepSequence* sequence) noexcept
+    : sequence_(sequence)
+{
+}
+
+auto StepSequence::Iterator::operator*() const -> Result<RunSlice>&
+{
+    return *sequence_->current_;
+}
+
+auto StepSequence::Iterator::operator++() -> Iterator&
+{
+    sequence_->advance();
+    return *this;
+}
+
+void StepSequence::Iterator::operator++(int)
+{
+    sequence_->advance();
+}
+
+auto StepSequence::Iterator::at_end() const noexcept -> bool
+{
+    return sequence_ == nullptr || !sequence_->current_.has_value();
+}
+
+StepSequence::StepSequence(VM& vm, const Program& program) noexcept
+    : vm_(&vm)
+    , program_(&program)
+{
+}
+
+auto StepSequence::begin() -> Iterator
+{
+    if (!started_)
+    {
+        started_ = true;
+        current_.emplace(vm_->run_resumable(*program_));
+    }
+    return Iterator(this);
+}
+
+auto StepSequence::end() const noexcept -> std::default_sentinel_t
+{
+    return std::default_sentinel;
+}
+
+void StepSequence::advance()
+{
+    if (!current_.has_value())
+    {
+        return;
+    }
+    if (!current_->has_value() || current_->value().status == RunStatus::completed)
+    {
+        current_.reset();
+        return;
+    }
+    current_.emplace(vm_->resume());
+}
+
+auto offload_native(Executor& executor, std::move_only_function<Result<Value>()> work) -> PendingValue
+{
+    PendingValue pending = PendingValue::create();
+    executor.execute([pending, work = std::move(work)]() mutable { pending.complete(work()); });
+    return pending;
+}
+} // namespace stella::vm
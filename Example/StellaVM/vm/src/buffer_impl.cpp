@@ -0,0 +1,291 @@
+module;
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+module vm;
+
+namespace stella::vm
+{
+using error_detail::make_unexpected;
+
+namespace
+{
+[[nodiscard]] auto buffer_opcode_name(const OpCode opcode) noexcept -> std::string_view
+{
+    switch (opcode)
+    {
+        case OpCode::buffer_len:
+            return "buffer_len";
+        case OpCode::buffer_slice:
+            return "buffer_slice";
+        case OpCode::buffer_load_u8:
+            return "buffer_load_u8";
+        case OpCode::buffer_load_u32:
+            return "buffer_load_u32";
+        case OpCode::buffer_load_u64:
+            return "buffer_load_u64";
+        case OpCode::buffer_hash:
+            return "buffer_hash";
+        case OpCode::buffer_find_byte:
+            return "buffer_find_byte";
+        default:
+            return "buffer_xor_const";
+    }
+}
+
+// Reflected Castagnoli polynomial, the variant SSE4.2 and ARMv8 compute in hardware.
+constexpr std::uint32_t crc32c_polynomial = 0x82F63B78U;
+
+constexpr auto crc32c_table = [] {
+    std::array<std::uint32_t, 256> table {};
+    for (std::uint32_t i = 0; i < table.size(); ++i)
+    {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc >> 1U) ^ ((crc & 1U) != 0 ? crc32c_polynomial : 0U);
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+[[nodiscard]] auto crc32c(const std::span<const std::byte> bytes) noexcept -> std::uint32_t
+{
+    std::uint32_t crc = 0xFFFFFFFFU;
+    std::size_t i = 0;
+#if defined(__SSE4_2__) && defined(__x86_64__)
+    std::uint64_t wide = crc;
+    for (; i + 8 <= bytes.size(); i += 8)
+    {
+        std::uint64_t chunk = 0;
+        std::memcpy(&chunk, bytes.data() + i, sizeof(chunk));
+        wide = _mm_crc32_u64(wide, chunk);
+    }
+    crc = static_cast<std::uint32_t>(wide);
+#elif defined(__ARM_FEATURE_CRC32) && defined(__aarch64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; i + 8 <= bytes.size(); i += 8)
+    {
+        std::uint64_t chunk = 0;
+        std::memcpy(&chunk, bytes.data() + i, sizeof(chunk));
+        crc = __crc32cd(crc, chunk);
+    }
+#endif
+    for (; i < bytes.size(); ++i)
+    {
+        crc = crc32c_table[(crc ^ std::to_integer<std::uint32_t>(bytes[i])) & 0xFFU] ^ (crc >> 8U);
+    }
+    return ~crc;
+}
+
+[[nodiscard]] auto find_byte(const std::span<const std::byte> bytes, const std::uint8_t needle) noexcept
+    -> std::int64_t
+{
+    const auto* data = reinterpret_cast<const unsigned char*>(bytes.data());
+    const std::size_t size = bytes.size();
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i pattern = _mm256_set1_epi8(static_cast<char>(needle));
+    for (; i + 32 <= size; i += 32)
+    {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const auto matches = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, pattern)));
+        if (matches != 0)
+        {
+            return static_cast<std::int64_t>(i + static_cast<std::size_t>(std::countr_zero(matches)));
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t pattern = vdupq_n_u8(needle);
+    for (; i + 16 <= size; i += 16)
+    {
+        // NEON has no movemask; stop at the first block holding a match and let the tail scan pinpoint it.
+        if (vmaxvq_u8(vceqq_u8(vld1q_u8(data + i), pattern)) != 0)
+        {
+            break;
+        }
+    }
+#endif
+    if (i == size)
+    {
+        return -1;
+    }
+    const void* found = std::memchr(data + i, needle, size - i);
+    return found == nullptr ? -1 : static_cast<std::int64_t>(static_cast<const unsigned char*>(found) - data);
+}
+
+void xor_bytes(const std::span<std::byte> bytes, const std::uint8_t key) noexcept
+{
+    auto* data = reinterpret_cast<unsigned char*>(bytes.data());
+    const std::size_t size = bytes.size();
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i pattern = _mm256_set1_epi8(static_cast<char>(key));
+    for (; i + 32 <= size; i += 32)
+    {
+        auto* lane = reinterpret_cast<__m256i*>(data + i);
+        _mm256_storeu_si256(lane, _mm256_xor_si256(_mm256_loadu_si256(lane), pattern));
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t pattern = vdupq_n_u8(key);
+    for (; i + 16 <= size; i += 16)
+    {
+        vst1q_u8(data + i, veorq_u8(vld1q_u8(data + i), pattern));
+    }
+#endif
+    for (; i < size; ++i)
+    {
+        data[i] = static_cast<unsigned char>(data[i] ^ key);
+    }
+}
+
+[[nodiscard]] auto load_le(const std::span<const std::byte> bytes) noexcept -> std::uint64_t
+{
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < bytes.size(); ++i)
+    {
+        value |= std::to_integer<std::uint64_t>(bytes[i]) << (8U * i);
+    }
+    return value;
+}
+
+[[nodiscard]] auto in_bounds(const std::size_t size, const std::int64_t offset, const std::int64_t length) noexcept
+    -> bool
+{
+    return offset >= 0 && length >= 0 && static_cast<std::uint64_t>(offset) <= size &&
+        static_cast<std::uint64_t>(length) <= size - static_cast<std::uint64_t>(offset);
+}
+
+[[nodiscard]] auto load_width(const OpCode opcode) noexcept -> std::int64_t
+{
+    switch (opcode)
+    {
+        case OpCode::buffer_load_u8:
+            return 1;
+        case OpCode::buffer_load_u32:
+            return 4;
+        default:
+            return 8;
+    }
+}
+} // namespace
+
+auto VM::execute_buffer_opcode(const Instruction& instruction) -> Result<Value>
+{
+    const OpCode opcode = instruction.opcode;
+    const std::string_view name = buffer_opcode_name(opcode);
+    const auto pop_i64 = [&](const std::string_view role) -> Result<std::int64_t> {
+        Result<Value> popped = pop_value();
+        if (!popped.has_value())
+        {
+            return std::unexpected(popped.error());
+        }
+        return popped->expect_i64(std::string(name) + " " + std::string(role));
+    };
+
+    std::int64_t length = 0;
+    std::int64_t offset = 0;
+    if (opcode == OpCode::buffer_slice)
+    {
+        const Result<std::int64_t> popped_length = pop_i64("length");
+        if (!popped_length.has_value())
+        {
+            return std::unexpected(popped_length.error());
+        }
+        length = popped_length.value();
+    }
+    if (opcode == OpCode::buffer_slice || opcode == OpCode::buffer_load_u8 || opcode == OpCode::buffer_load_u32 ||
+        opcode == OpCode::buffer_load_u64)
+    {
+        const Result<std::int64_t> popped_offset = pop_i64("offset");
+        if (!popped_offset.has_value())
+        {
+            return std::unexpected(popped_offset.error());
+        }
+        offset = popped_offset.value();
+    }
+
+    Result<Value> popped = pop_value();
+    if (!popped.has_value())
+    {
+        return std::unexpected(popped.error());
+    }
+    Value buffer = std::move(popped).value();
+    const Result<std::span<const std::byte>> bytes = buffer.expect_bytes(name);
+    if (!bytes.has_value())
+    {
+        return std::unexpected(bytes.error());
+    }
+
+    switch (opcode)
+    {
+        case OpCode::buffer_len:
+            return Value::i64(static_cast<std::int64_t>(bytes->size()));
+        case OpCode::buffer_hash:
+            return Value::i64(static_cast<std::int64_t>(crc32c(bytes.value())));
+        case OpCode::buffer_find_byte:
+            return Value::i64(find_byte(bytes.value(), static_cast<std::uint8_t>(instruction.operand)));
+        case OpCode::buffer_load_u8:
+        case OpCode::buffer_load_u32:
+        case OpCode::buffer_load_u64:
+        {
+            const std::int64_t width = load_width(opcode);
+            if (!in_bounds(bytes->size(), offset, width))
+            {
+                return make_unexpected(ErrorCode::invalid_buffer_access, std::string(name) + " reads past the buffer.");
+            }
+            const std::span<const std::byte> field =
+                bytes->subspan(static_cast<std::size_t>(offset), static_cast<std::size_t>(width));
+            return Value::i64(static_cast<std::int64_t>(load_le(field)));
+        }
+        case OpCode::buffer_slice:
+        {
+            if (!in_bounds(bytes->size(), offset, length))
+            {
+                return make_unexpected(ErrorCode::invalid_buffer_access, "buffer_slice range exceeds the buffer.");
+            }
+            const auto begin = static_cast<std::size_t>(offset);
+            const auto count = static_cast<std::size_t>(length);
+            if (buffer.is_borrowed_buffer())
+            {
+                return Value::borrowed_buffer(bytes->subspan(begin, count));
+            }
+
+            // Owned payloads move into a refcounted one, so the slice shares them instead of copying.
+            const Result<SharedBuffer> shared = buffer.share_buffer();
+            if (!shared.has_value())
+            {
+                return std::unexpected(shared.error());
+            }
+            return Value::shared_buffer(shared->slice(begin, count));
+        }
+        default:
+        {
+            // take_buffer steals owned and uniquely shared payloads; views and shared payloads are copied first.
+            Result<MoveBuffer> owned = buffer.take_buffer();
+            if (!owned.has_value())
+            {
+                return std::unexpected(owned.error());
+            }
+            xor_bytes(owned->bytes(), static_cast<std::uint8_t>(instruction.operand));
+            return Value::owned_buffer(std::move(owned).value());
+        }
+    }
+}
+} // namespace stella::vm
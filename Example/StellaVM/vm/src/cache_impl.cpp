@@ -0,0 +1,515 @@
+module;
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+module vm;
+
+namespace stella::vm
+{
+namespace
+{
+inline constexpr std::uint32_t cache_entry_magic = 0x43564D53U; // "SMVC" little-endian
+inline constexpr std::uint16_t cache_entry_version = 1;
+inline constexpr std::size_t cache_header_bytes = 4 + 2 + 2 + 8 + 32;
+inline constexpr std::string_view cache_entry_extension = ".svmc";
+inline constexpr std::string_view cache_temp_marker = ".tmp.";
+inline constexpr std::string_view verify_only_pipeline = "verify";
+inline constexpr auto stale_temp_age = std::chrono::minutes(10);
+
+using Digest = std::array<std::uint8_t, 32>;
+
+class Sha256 final
+{
+public:
+    void update(std::span<const std::byte> bytes)
+    {
+        for (const std::byte byte : bytes)
+        {
+            block_[block_size_++] = std::to_integer<std::uint8_t>(byte);
+            if (block_size_ == block_.size())
+            {
+                compress();
+                block_size_ = 0;
+            }
+        }
+        total_bytes_ += bytes.size();
+    }
+
+    void update_u64(const std::uint64_t value)
+    {
+        std::array<std::byte, 8> encoded {};
+        for (std::size_t i = 0; i < encoded.size(); ++i)
+        {
+            encoded[i] = std::byte {static_cast<std::uint8_t>((value >> (i * 8U)) & 0xFFU)};
+        }
+        update(encoded);
+    }
+
+    void update_text(const std::string_view text)
+    {
+        update_u64(text.size());
+        update(std::as_bytes(std::span<const char>(text.data(), text.size())));
+    }
+
+    [[nodiscard]] auto finish() -> Digest
+    {
+        const std::uint64_t bit_length = total_bytes_ * 8U;
+        block_[block_size_++] = 0x80U;
+        if (block_size_ > 56)
+        {
+            std::fill(block_.begin() + static_cast<std::ptrdiff_t>(block_size_), block_.end(), 0);
+            compress();
+            block_size_ = 0;
+        }
+        std::fill(block_.begin() + static_cast<std::ptrdiff_t>(block_size_), block_.begin() + 56, 0);
+        for (std::size_t i = 0; i < 8; ++i)
+        {
+            block_[63 - i] = static_cast<std::uint8_t>((bit_length >> (i * 8U)) & 0xFFU);
+        }
+        compress();
+
+        Digest digest {};
+        for (std::size_t i = 0; i < state_.size(); ++i)
+        {
+            digest[(i * 4) + 0] = static_cast<std::uint8_t>(state_[i] >> 24U);
+            digest[(i * 4) + 1] = static_cast<std::uint8_t>(state_[i] >> 16U);
+            digest[(i * 4) + 2] = static_cast<std::uint8_t>(state_[i] >> 8U);
+            digest[(i * 4) + 3] = static_cast<std::uint8_t>(state_[i]);
+        }
+        return digest;
+    }
+
+private:
+    void compress()
+    {
+        static constexpr std::array<std::uint32_t, 64> round_constants {
+            0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U, 0x3956c25bU, 0x59f111f1U, 0x923f82a4U, 0xab1c5ed5U,
+            0xd807aa98U, 0x12835b01U, 0x243185beU, 0x550c7dc3U, 0x72be5d74U, 0x80deb1feU, 0x9bdc06a7U, 0xc19bf174U,
+            0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU, 0x2de92c6fU, 0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU,
+            0x983e5152U, 0xa831c66dU, 0xb00327c8U, 0xbf597fc7U, 0xc6e00bf3U, 0xd5a79147U, 0x06ca6351U, 0x14292967U,
+            0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU, 0x53380d13U, 0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U,
+            0xa2bfe8a1U, 0xa81a664bU, 0xc24b8b70U, 0xc76c51a3U, 0xd192e819U, 0xd6990624U, 0xf40e3585U, 0x106aa070U,
+            0x19a4c116U, 0x1e376c08U, 0x2748774cU, 0x34b0bcb5U, 0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU, 0x682e6ff3U,
+            0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U, 0x90befffaU, 0xa4506cebU, 0xbef9a3f7U, 0xc67178f2U,
+        };
+
+        std::array<std::uint32_t, 64> schedule {};
+        for (std::size_t i = 0; i < 16; ++i)
+        {
+            schedule[i] = (static_cast<std::uint32_t>(block_[(i * 4) + 0]) << 24U) |
+                          (static_cast<std::uint32_t>(block_[(i * 4) + 1]) << 16U) |
+                          (static_cast<std::uint32_t>(block_[(i * 4) + 2]) << 8U) |
+                          static_cast<std::uint32_t>(block_[(i * 4) + 3]);
+        }
+        for (std::size_t i = 16; i < 64; ++i)
+        {
+            const std::uint32_t s0 =
+                std::rotr(schedule[i - 15], 7) ^ std::rotr(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3U);
+            const std::uint32_t s1 =
+                std::rotr(schedule[i - 2], 17) ^ std::rotr(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10U);
+            schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+        }
+
+        std::array<std::uint32_t, 8> work = state_;
+        for (std::size_t i = 0; i < 64; ++i)
+        {
+            const std::uint32_t sigma1 = std::rotr(work[4], 6) ^ std::rotr(work[4], 11) ^ std::rotr(work[4], 25);
+            const std::uint32_t choice = (work[4] & work[5]) ^ (~work[4] & work[6]);
+            const std::uint32_t t1 = work[7] + sigma1 + choice + round_constants[i] + schedule[i];
+            const std::uint32_t sigma0 = std::rotr(work[0], 2) ^ std::rotr(work[0], 13) ^ std::rotr(work[0], 22);
+            const std::uint32_t majority = (work[0] & work[1]) ^ (work[0] & work[2]) ^ (work[1] & work[2]);
+            const std::uint32_t t2 = sigma0 + majority;
+
+            work[7] = work[6];
+            work[6] = work[5];
+            work[5] = work[4];
+            work[4] = work[3] + t1;
+            work[3] = work[2];
+            work[2] = work[1];
+            work[1] = work[0];
+            work[0] = t1 + t2;
+        }
+
+        for (std::size_t i = 0; i < state_.size(); ++i)
+        {
+            state_[i] += work[i];
+        }
+    }
+
+    std::array<std::uint32_t, 8> state_ {
+        0x6a09e667U, 0xbb67ae85U, 0x3c6ef372U, 0xa54ff53aU, 0x510e527fU, 0x9b05688cU, 0x1f83d9abU, 0x5be0cd19U,
+    };
+    std::array<std::uint8_t, 64> block_ {};
+    std::size_t block_size_ = 0;
+    std::uint64_t total_bytes_ = 0;
+};
+
+[[nodiscard]] auto to_hex(const Digest& digest) -> std::string
+{
+    static constexpr std::string_view digits = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(digest.size() * 2);
+    for (const std::uint8_t byte : digest)
+    {
+        hex.push_back(digits[byte >> 4U]);
+        hex.push_back(digits[byte & 0x0FU]);
+    }
+    return hex;
+}
+
+[[nodiscard]] auto cache_key(
+    const std::span<const std::byte> bytecode,
+    const VM& vm,
+    const std::size_t available_inputs,
+    const std::string_view pipeline_tag) -> std::string
+{
+    Sha256 hasher;
+    hasher.update_text("stella.vm.program-cache");
+    hasher.update_u64(bytecode_version);
+    hasher.update_text(pipeline_tag);
+    hasher.update_u64(available_inputs);
+
+    const std::vector<NativeSignature> signatures = vm.native_signatures();
+    hasher.update_u64(signatures.size());
+    for (const NativeSignature& signature : signatures)
+    {
+        hasher.update_text(signature.name);
+        hasher.update_u64(signature.arity);
+    }
+
+    // Field types decide which load_field opcodes verify, so the bound layouts are part of the key.
+    const std::span<const RecordBinding> records = vm.record_bindings();
+    hasher.update_u64(records.size());
+    for (const RecordBinding& record : records)
+    {
+        const std::span<const RecordField> fields = record.schema->fields();
+        hasher.update_u64(fields.size());
+        for (const RecordField& field : fields)
+        {
+            hasher.update_text(field.name);
+            hasher.update_u64(static_cast<std::uint64_t>(field.type));
+        }
+    }
+
+    hasher.update_u64(bytecode.size());
+    hasher.update(bytecode);
+    return to_hex(hasher.finish());
+}
+
+[[nodiscard]] auto payload_digest(const std::span<const std::byte> payload) -> Digest
+{
+    Sha256 hasher;
+    hasher.update(payload);
+    return hasher.finish();
+}
+
+[[nodiscard]] auto is_temp_file(const std::filesystem::path& path) -> bool
+{
+    return path.filename().string().find(cache_temp_marker) != std::string::npos;
+}
+
+[[nodiscard]] auto unique_temp_suffix() -> std::string
+{
+    static std::atomic<std::uint64_t> counter {0};
+    thread_local std::mt19937_64 generator {std::random_device {}()};
+    const std::uint64_t salt = generator() ^ std::hash<std::thread::id> {}(std::this_thread::get_id());
+    return std::string(cache_temp_marker) + std::to_string(salt) + "." +
+           std::to_string(counter.fetch_add(1, std::memory_order_relaxed));
+}
+} // namespace
+
+ProgramCache::ProgramCache(std::filesystem::path directory, const std::uint64_t capacity_bytes)
+    : directory_(std::move(directory))
+    , capacity_bytes_(capacity_bytes)
+{
+    std::error_code ignored;
+    std::filesystem::create_directories(directory_, ignored);
+    evict_to_capacity();
+}
+
+auto ProgramCache::load(const std::span<const std::byte> bytecode, const VM& vm, const std::size_t available_inputs)
+    -> Result<Program>
+{
+    return load(bytecode, vm, available_inputs, verify_only_pipeline, [](Program program) -> Result<Program> {
+        return program;
+    });
+}
+
+auto ProgramCache::load(
+    const std::span<const std::byte> bytecode,
+    const VM& vm,
+    const std::size_t available_inputs,
+    const std::string_view pipeline_tag,
+    PrepareFunction prepare) -> Result<Program>
+{
+    const std::filesystem::path path = entry_path(cache_key(bytecode, vm, available_inputs, pipeline_tag));
+
+    std::optional<Program> cached = read_entry(path);
+    if (cached.has_value())
+    {
+        ++stats_.hits;
+        return std::move(cached).value();
+    }
+    ++stats_.misses;
+
+    Result<Program> decoded = deserialize_program(bytecode);
+    if (!decoded.has_value())
+    {
+        return std::unexpected(decoded.error());
+    }
+
+    Result<Program> prepared = prepare(std::move(decoded).value());
+    if (!prepared.has_value())
+    {
+        return std::unexpected(prepared.error());
+    }
+
+    const VoidResult verified = vm.verify(prepared.value(), available_inputs);
+    if (!verified.has_value())
+    {
+        return std::unexpected(verified.error());
+    }
+
+    Result<MoveBuffer> artifact = serialize_program(prepared.value());
+    if (artifact.has_value())
+    {
+        write_entry(path, artifact.value());
+    }
+    else
+    {
+        ++stats_.store_failures;
+    }
+
+    return prepared;
+}
+
+auto ProgramCache::evict_to_capacity() -> std::size_t
+{
+    struct Entry final
+    {
+        std::filesystem::path path;
+        std::filesystem::file_time_type last_used {};
+        std::uint64_t bytes = 0;
+    };
+
+    std::vector<Entry> entries;
+    std::uint64_t total_bytes = 0;
+    std::size_t removed = 0;
+    const auto now = std::filesystem::file_time_type::clock::now();
+
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(directory_, error);
+         !error && it != std::filesystem::recursive_directory_iterator();
+         it.increment(error))
+    {
+        std::error_code entry_error;
+        if (!it->is_regular_file(entry_error) || entry_error)
+        {
+            continue;
+        }
+
+        const auto last_used = it->last_write_time(entry_error);
+        const auto bytes = it->file_size(entry_error);
+        if (entry_error)
+        {
+            continue;
+        }
+
+        // Temp files belong to in-flight writers in other processes unless they are old enough to be orphans.
+        if (is_temp_file(it->path()))
+        {
+            if (now - last_used > stale_temp_age && std::filesystem::remove(it->path(), entry_error))
+            {
+                ++removed;
+            }
+            continue;
+        }
+        if (it->path().extension() != cache_entry_extension)
+        {
+            continue;
+        }
+
+        entries.push_back({it->path(), last_used, bytes});
+        total_bytes += bytes;
+    }
+
+    if (total_bytes > capacity_bytes_)
+    {
+        std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+            return lhs.last_used < rhs.last_used;
+        });
+
+        // Evicting below the cap leaves headroom so consecutive stores do not each trigger a directory scan.
+        const std::uint64_t target_bytes = capacity_bytes_ - (capacity_bytes_ / 8U);
+        for (const Entry& entry : entries)
+        {
+            if (total_bytes <= target_bytes)
+            {
+                break;
+            }
+
+            std::error_code remove_error;
+            if (std::filesystem::remove(entry.path, remove_error))
+            {
+                ++removed;
+                ++stats_.evictions;
+            }
+            // Another process may have evicted it first or still hold it open; either way it no longer counts.
+            total_bytes -= entry.bytes;
+        }
+    }
+
+    estimated_bytes_ = total_bytes;
+    return removed;
+}
+
+auto ProgramCache::directory() const noexcept -> const std::filesystem::path&
+{
+    return directory_;
+}
+
+auto ProgramCache::stats() const noexcept -> const ProgramCacheStats&
+{
+    return stats_;
+}
+
+auto ProgramCache::entry_path(const std::string_view key) const -> std::filesystem::path
+{
+    return directory_ / std::string(key.substr(0, 2)) / (std::string(key.substr(2)) + std::string(cache_entry_extension));
+}
+
+auto ProgramCache::read_entry(const std::filesystem::path& path) -> std::optional<Program>
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return std::nullopt;
+    }
+
+    const auto file_size = static_cast<std::uint64_t>(file.tellg());
+    const auto discard_corrupt = [&]() -> std::optional<Program> {
+        ++stats_.corrupt_entries;
+        file.close();
+        std::error_code ignored;
+        std::filesystem::remove(path, ignored);
+        return std::nullopt;
+    };
+
+    if (file_size < cache_header_bytes)
+    {
+        return discard_corrupt();
+    }
+
+    MoveBuffer contents = MoveBuffer::uninitialized(static_cast<std::size_t>(file_size));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(contents.data_ptr()), static_cast<std::streamsize>(file_size)))
+    {
+        return discard_corrupt();
+    }
+
+    const auto bytes = contents.bytes();
+    const auto read_le = [&](const std::size_t offset, const std::size_t width) {
+        std::uint64_t value = 0;
+        for (std::size_t i = 0; i < width; ++i)
+        {
+            value |= static_cast<std::uint64_t>(std::to_integer<std::uint8_t>(bytes[offset + i])) << (i * 8U);
+        }
+        return value;
+    };
+
+    const std::uint64_t payload_size = read_le(8, 8);
+    if (read_le(0, 4) != cache_entry_magic || read_le(4, 2) != cache_entry_version || read_le(6, 2) != 0 ||
+        payload_size != file_size - cache_header_bytes)
+    {
+        return discard_corrupt();
+    }
+
+    const auto payload = bytes.subspan(cache_header_bytes);
+    const Digest expected = payload_digest(payload);
+    if (std::memcmp(expected.data(), bytes.data() + 16, expected.size()) != 0)
+    {
+        return discard_corrupt();
+    }
+
+    Result<Program> program = deserialize_program(payload);
+    if (!program.has_value())
+    {
+        return discard_corrupt();
+    }
+
+    // Refreshing the modification time is the LRU clock shared with every other process using the directory.
+    std::error_code ignored;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ignored);
+    return std::move(program).value();
+}
+
+void ProgramCache::write_entry(const std::filesystem::path& path, const MoveBuffer& artifact)
+{
+    std::array<std::byte, cache_header_bytes> header {};
+    const auto write_le = [&](const std::size_t offset, const std::size_t width, const std::uint64_t value) {
+        for (std::size_t i = 0; i < width; ++i)
+        {
+            header[offset + i] = std::byte {static_cast<std::uint8_t>((value >> (i * 8U)) & 0xFFU)};
+        }
+    };
+    write_le(0, 4, cache_entry_magic);
+    write_le(4, 2, cache_entry_version);
+    write_le(6, 2, 0);
+    write_le(8, 8, artifact.size);
+    const Digest digest = payload_digest(artifact.bytes());
+    std::memcpy(header.data() + 16, digest.data(), digest.size());
+
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    // Writers never touch the final name until the bytes are complete, so concurrent readers in other processes
+    // observe either no entry or a whole one. Racing writers produce identical content, so the last rename wins.
+    std::filesystem::path temp_path = path;
+    temp_path += unique_temp_suffix();
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+        file.write(reinterpret_cast<const char*>(artifact.data_ptr()), static_cast<std::streamsize>(artifact.size));
+        if (!file.flush())
+        {
+            file.close();
+            std::filesystem::remove(temp_path, error);
+            ++stats_.store_failures;
+            return;
+        }
+    }
+
+    std::filesystem::rename(temp_path, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temp_path, error);
+        ++stats_.store_failures;
+        return;
+    }
+
+    ++stats_.stores;
+    estimated_bytes_ += header.size() + artifact.size;
+    if (estimated_bytes_ > capacity_bytes_)
+    {
+        evict_to_capacity();
+    }
+}
+} // namespace stella::vm
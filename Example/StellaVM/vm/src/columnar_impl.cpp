@@ -0,0 +1,563 @@
+module;
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+module vm;
+
+namespace stella::vm
+{
+using error_detail::make_unexpected;
+
+namespace
+{
+constexpr std::uint32_t columnar_unvisited_depth = 0xFFFFFFFFU;
+
+using RowIndex = std::uint16_t;
+static_assert(column_vector_rows - 1 <= 0xFFFFU, "Row indices must fit RowIndex.");
+
+[[nodiscard]] auto is_binary_i64(const OpCode opcode) noexcept -> bool
+{
+    switch (opcode)
+    {
+        case OpCode::add_i64:
+        case OpCode::sub_i64:
+        case OpCode::mul_i64:
+        case OpCode::mod_i64:
+        case OpCode::cmp_eq_i64:
+        case OpCode::cmp_lt_i64:
+        case OpCode::and_i64:
+        case OpCode::or_i64:
+        case OpCode::xor_i64:
+        case OpCode::shl_i64:
+        case OpCode::shr_i64:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// A dense selection covers rows [0, n) in order; iterating it by position lets the kernel vectorize.
+template <typename Kernel>
+void for_each_row(const std::span<const RowIndex> selection, const bool dense, Kernel&& kernel)
+{
+    if (dense)
+    {
+        const std::size_t rows = selection.size();
+        for (std::size_t row = 0; row < rows; ++row)
+        {
+            kernel(row);
+        }
+        return;
+    }
+
+    for (const RowIndex row : selection)
+    {
+        kernel(static_cast<std::size_t>(row));
+    }
+}
+
+using CheckedBinary = Result<std::int64_t> (*)(OpCode, std::int64_t, std::int64_t);
+
+// lhs doubles as the destination register. add/sub/mul and the pure bitwise and comparison kernels run branch-free
+// with an accumulated overflow flag; the remaining opcodes fall back to the interpreter's checked scalar helpers.
+[[nodiscard]] auto apply_binary_column(
+    const OpCode opcode,
+    std::int64_t* lhs,
+    const std::int64_t* rhs,
+    const std::span<const RowIndex> selection,
+    const bool dense,
+    const CheckedBinary checked) -> VoidResult
+{
+    switch (opcode)
+    {
+        case OpCode::add_i64:
+        {
+            std::uint64_t overflow_bits = 0;
+            for_each_row(selection, dense, [&](const std::size_t row) {
+                const auto a = static_cast<std::uint64_t>(lhs[row]);
+                const auto b = static_cast<std::uint64_t>(rhs[row]);
+                const std::uint64_t sum = a + b;
+                overflow_bits |= (a ^ sum) & (b ^ sum);
+                lhs[row] = static_cast<std::int64_t>(sum);
+            });
+            if ((overflow_bits >> 63U) != 0)
+            {
+                return make_unexpected(ErrorCode::arithmetic_overflow, "add_i64 overflow.");
+            }
+            return {};
+        }
+        case OpCode::sub_i64:
+        {
+            std::uint64_t overflow_bits = 0;
+            for_each_row(selection, dense, [&](const std::size_t row) {
+                const auto a = static_cast<std::uint64_t>(lhs[row]);
+                const auto b = static_cast<std::uint64_t>(rhs[row]);
+                const std::uint64_t difference = a - b;
+                overflow_bits |= (a ^ b) & (a ^ difference);
+                lhs[row] = static_cast<std::int64_t>(difference);
+            });
+            if ((overflow_bits >> 63U) != 0)
+            {
+                return make_unexpected(ErrorCode::arithmetic_overflow, "sub_i64 overflow.");
+            }
+            return {};
+        }
+#if defined(__clang__) || defined(__GNUC__)
+        case OpCode::mul_i64:
+        {
+            bool overflow = false;
+            for_each_row(selection, dense, [&](const std::size_t row) {
+                std::int64_t product = 0;
+                overflow |= __builtin_mul_overflow(lhs[row], rhs[row], &product);
+                lhs[row] = product;
+            });
+            if (overflow)
+            {
+                return make_unexpected(ErrorCode::arithmetic_overflow, "mul_i64 overflow.");
+            }
+            return {};
+        }
+#endif
+        case OpCode::cmp_eq_i64:
+            for_each_row(selection, dense, [&](const std::size_t row) {
+                lhs[row] = lhs[row] == rhs[row] ? 1 : 0;
+            });
+            return {};
+        case OpCode::cmp_lt_i64:
+            for_each_row(selection, dense, [&](const std::size_t row) {
+                lhs[row] = lhs[row] < rhs[row] ? 1 : 0;
+            });
+            return {};
+        case OpCode::and_i64:
+            for_each_row(selection, dense, [&](const std::size_t row) { lhs[row] &= rhs[row]; });
+            return {};
+        case OpCode::or_i64:
+            for_each_row(selection, dense, [&](const std::size_t row) { lhs[row] |= rhs[row]; });
+            return {};
+        case OpCode::xor_i64:
+            for_each_row(selection, dense, [&](const std::size_t row) { lhs[row] ^= rhs[row]; });
+            return {};
+        default:
+            break;
+    }
+
+    for (std::size_t i = 0; i < selection.size(); ++i)
+    {
+        const std::size_t row = dense ? i : static_cast<std::size_t>(selection[i]);
+        Result<std::int64_t> value = checked(opcode, lhs[row], rhs[row]);
+        if (!value.has_value())
+        {
+            return std::unexpected(value.error());
+        }
+        lhs[row] = value.value();
+    }
+    return {};
+}
+} // namespace
+
+auto ColumnarProgram::input_columns() const noexcept -> std::size_t
+{
+    return input_columns_;
+}
+
+auto ColumnarProgram::max_stack_depth() const noexcept -> std::size_t
+{
+    return max_stack_depth_;
+}
+
+auto VM::compile_columnar(const Program& program, const std::size_t input_columns) const -> Result<ColumnarProgram>
+{
+    const VoidResult verified = verify(program, input_columns);
+    if (!verified.has_value())
+    {
+        return std::unexpected(verified.error());
+    }
+
+    ColumnarProgram lowered;
+    lowered.code_ = program.code;
+    lowered.input_columns_ = input_columns;
+    lowered.constants_.reserve(program.constants.size());
+    for (const Value& constant : program.constants)
+    {
+        lowered.constants_.push_back(constant.is_i64() ? constant.as_i64() : 0);
+    }
+
+    for (const Instruction& instruction : program.code)
+    {
+        switch (instruction.opcode)
+        {
+            case OpCode::push_constant:
+                if (!program.constants[instruction.operand].is_i64())
+                {
+                    return make_unexpected(
+                        ErrorCode::unsupported_operation,
+                        "Columnar programs only support i64 constants.");
+                }
+                break;
+            case OpCode::push_input:
+            case OpCode::call_native:
+            case OpCode::halt:
+            case OpCode::jump:
+            case OpCode::jump_if_true:
+            case OpCode::dup:
+            case OpCode::pop:
+            case OpCode::yield:
+                break;
+            default:
+                if (!is_binary_i64(instruction.opcode))
+                {
+                    return make_unexpected(
+                        ErrorCode::unsupported_operation,
+                        "Opcode " + std::to_string(static_cast<int>(instruction.opcode)) +
+                            " is not supported by the columnar engine.");
+                }
+                break;
+        }
+    }
+
+    // The verifier already proved every merge agrees on depth, so one forward propagation assigns each reachable pc
+    // its register index.
+    std::vector<std::uint32_t>& depth_at_pc = lowered.depth_at_pc_;
+    depth_at_pc.assign(program.code.size(), columnar_unvisited_depth);
+    std::vector<std::size_t> worklist;
+    const auto enqueue = [&](const std::size_t pc, const std::size_t depth) {
+        if (pc < depth_at_pc.size() && depth_at_pc[pc] == columnar_unvisited_depth)
+        {
+            depth_at_pc[pc] = static_cast<std::uint32_t>(depth);
+            worklist.push_back(pc);
+        }
+    };
+    if (!program.code.empty())
+    {
+        enqueue(0, 0);
+    }
+
+    while (!worklist.empty())
+    {
+        const std::size_t pc = worklist.back();
+        worklist.pop_back();
+
+        const Instruction& instruction = program.code[pc];
+        const std::size_t depth = depth_at_pc[pc];
+        std::size_t next_depth = depth;
+        switch (instruction.opcode)
+        {
+            case OpCode::push_constant:
+            case OpCode::push_input:
+            case OpCode::dup:
+                next_depth = depth + 1;
+                break;
+            case OpCode::pop:
+                next_depth = depth - 1;
+                break;
+            case OpCode::call_native:
+                next_depth = depth - native_bindings_[instruction.operand].arity + 1;
+                break;
+            case OpCode::jump:
+                enqueue(instruction.operand, depth);
+                continue;
+            case OpCode::jump_if_true:
+                next_depth = depth - 1;
+                enqueue(instruction.operand, next_depth);
+                break;
+            case OpCode::yield:
+                break;
+            case OpCode::halt:
+                continue;
+            default:
+                next_depth = depth - 1;
+                break;
+        }
+
+        lowered.max_stack_depth_ = (std::max)(lowered.max_stack_depth_, next_depth);
+        enqueue(pc + 1, next_depth);
+    }
+
+    return lowered;
+}
+
+auto VM::run_columns(
+    const ColumnarProgram& program,
+    const std::span<const std::span<const std::int64_t>> columns,
+    const std::span<std::int64_t> results) -> VoidResult
+{
+    const std::size_t rows = results.size();
+    if (columns.size() < program.input_columns_)
+    {
+        return make_unexpected(ErrorCode::invalid_input_index, "run_columns received fewer columns than compiled.");
+    }
+    for (std::size_t i = 0; i < program.input_columns_; ++i)
+    {
+        if (columns[i].size() < rows)
+        {
+            return make_unexpected(ErrorCode::invalid_input_index, "run_columns input column is shorter than results.");
+        }
+    }
+
+    const std::vector<Instruction>& code = program.code_;
+    std::vector<std::int64_t> registers(program.max_stack_depth_ * column_vector_rows);
+    const auto column = [&](const std::size_t depth) { return registers.data() + depth * column_vector_rows; };
+
+    std::vector<std::vector<RowIndex>> pending(code.size());
+    std::vector<bool> queued(code.size(), false);
+    std::priority_queue<std::size_t, std::vector<std::size_t>, std::greater<>> ready;
+    std::vector<RowIndex> selection;
+    std::vector<RowIndex> taken;
+    std::vector<RowIndex> remaining;
+    std::vector<std::size_t> row_steps;
+    std::vector<std::span<const std::int64_t>> batch_args;
+    std::vector<std::vector<std::int64_t>> batch_scratch;
+    std::vector<std::int64_t> batch_results;
+
+    const auto deposit = [&](const std::size_t pc, const std::span<const RowIndex> incoming) {
+        if (incoming.empty())
+        {
+            return;
+        }
+        pending[pc].insert(pending[pc].end(), incoming.begin(), incoming.end());
+        if (!queued[pc])
+        {
+            queued[pc] = true;
+            ready.push(pc);
+        }
+    };
+
+    struct StackGuard final
+    {
+        VM& vm;
+
+        ~StackGuard()
+        {
+            vm.clear_stack();
+        }
+    };
+    StackGuard stack_guard {*this};
+    clear_stack();
+
+    for (std::size_t chunk_begin = 0; chunk_begin < rows; chunk_begin += column_vector_rows)
+    {
+        const std::size_t chunk_rows = (std::min)(column_vector_rows, rows - chunk_begin);
+        selection.resize(chunk_rows);
+        std::iota(selection.begin(), selection.end(), RowIndex {0});
+        if (step_budget_ != 0)
+        {
+            row_steps.assign(chunk_rows, 0);
+        }
+        if (code.empty())
+        {
+            return make_unexpected(ErrorCode::type_mismatch, "Columnar program halted without an i64 result.");
+        }
+        deposit(0, selection);
+
+        while (!ready.empty())
+        {
+            std::size_t pc = ready.top();
+            ready.pop();
+            queued[pc] = false;
+            selection.swap(pending[pc]);
+            pending[pc].clear();
+            if (!std::is_sorted(selection.begin(), selection.end()))
+            {
+                std::sort(selection.begin(), selection.end());
+            }
+
+            while (!selection.empty())
+            {
+                if (pc >= code.size())
+                {
+                    return make_unexpected(ErrorCode::type_mismatch, "Columnar program halted without an i64 result.");
+                }
+
+                const bool dense = selection.size() == chunk_rows;
+                if (step_budget_ != 0)
+                {
+                    bool exhausted = false;
+                    for_each_row(selection, dense, [&](const std::size_t row) {
+                        exhausted |= ++row_steps[row] > step_budget_;
+                    });
+                    if (exhausted)
+                    {
+                        return make_unexpected(
+                            ErrorCode::step_budget_exceeded,
+                            "VM step budget exhausted before termination.");
+                    }
+                }
+
+                const Instruction& instruction = code[pc];
+                const std::size_t depth = program.depth_at_pc_[pc];
+                bool block_ends = false;
+
+                switch (instruction.opcode)
+                {
+                    case OpCode::push_constant:
+                    {
+                        std::int64_t* out = column(depth);
+                        const std::int64_t constant = program.constants_[instruction.operand];
+                        for_each_row(selection, dense, [&](const std::size_t row) { out[row] = constant; });
+                        break;
+                    }
+                    case OpCode::push_input:
+                    {
+                        std::int64_t* out = column(depth);
+                        const std::int64_t* in = columns[instruction.operand].data() + chunk_begin;
+                        for_each_row(selection, dense, [&](const std::size_t row) { out[row] = in[row]; });
+                        break;
+                    }
+                    case OpCode::dup:
+                    {
+                        std::int64_t* out = column(depth);
+                        const std::int64_t* in = column(depth - 1);
+                        for_each_row(selection, dense, [&](const std::size_t row) { out[row] = in[row]; });
+                        break;
+                    }
+                    case OpCode::pop:
+                    case OpCode::yield:
+                        break;
+                    case OpCode::jump:
+                    {
+                        deposit(instruction.operand, selection);
+                        selection.clear();
+                        block_ends = true;
+                        break;
+                    }
+                    case OpCode::jump_if_true:
+                    {
+                        const std::int64_t* condition = column(depth - 1);
+                        taken.clear();
+                        remaining.clear();
+                        for (const RowIndex row : selection)
+                        {
+                            (condition[row] != 0 ? taken : remaining).push_back(row);
+                        }
+                        deposit(instruction.operand, taken);
+                        selection.swap(remaining);
+                        break;
+                    }
+                    case OpCode::call_native:
+                    {
+                        if (instruction.operand >= native_bindings_.size())
+                        {
+                            return make_unexpected(
+                                ErrorCode::invalid_native_index,
+                                "call_native operand out of range.");
+                        }
+                        const std::size_t arity = native_bindings_[instruction.operand].arity;
+                        const std::size_t base = depth - arity;
+                        if (native_bindings_[instruction.operand].batch_function)
+                        {
+                            // One crossing per row group: dense selections hand over register columns directly,
+                            // sparse ones gather into scratch first.
+                            const std::size_t count = selection.size();
+                            batch_args.resize(arity);
+                            batch_scratch.resize(arity);
+                            batch_results.resize(count);
+                            for (std::size_t arg = 0; arg < arity; ++arg)
+                            {
+                                const std::int64_t* source = column(base + arg);
+                                if (dense)
+                                {
+                                    batch_args[arg] = std::span<const std::int64_t>(source, count);
+                                    continue;
+                                }
+                                batch_scratch[arg].resize(count);
+                                for (std::size_t i = 0; i < count; ++i)
+                                {
+                                    batch_scratch[arg][i] = source[selection[i]];
+                                }
+                                batch_args[arg] = batch_scratch[arg];
+                            }
+
+                            const VoidResult called =
+                                execute_batch_native(instruction.operand, batch_args, batch_results);
+                            if (!called.has_value())
+                            {
+                                return std::unexpected(called.error());
+                            }
+                            std::int64_t* out = column(base);
+                            for (std::size_t i = 0; i < count; ++i)
+                            {
+                                out[dense ? i : static_cast<std::size_t>(selection[i])] = batch_results[i];
+                            }
+                            break;
+                        }
+                        for (const RowIndex row : selection)
+                        {
+                            clear_stack();
+                            for (std::size_t arg = 0; arg < arity; ++arg)
+                            {
+                                stack_.push_back(Value::i64(column(base + arg)[row]));
+                            }
+
+                            Result<Value> returned = execute_call_native(instruction.operand);
+                            if (!returned.has_value())
+                            {
+                                return std::unexpected(returned.error());
+                            }
+                            const Result<std::int64_t> value = returned->expect_i64("columnar call_native result");
+                            if (!value.has_value())
+                            {
+                                return std::unexpected(value.error());
+                            }
+                            column(base)[row] = value.value();
+                        }
+                        break;
+                    }
+                    case OpCode::halt:
+                    {
+                        if (depth == 0)
+                        {
+                            return make_unexpected(
+                                ErrorCode::type_mismatch,
+                                "Columnar program halted without an i64 result.");
+                        }
+                        const std::int64_t* top = column(depth - 1);
+                        std::int64_t* out = results.data() + chunk_begin;
+                        for_each_row(selection, dense, [&](const std::size_t row) { out[row] = top[row]; });
+                        selection.clear();
+                        block_ends = true;
+                        break;
+                    }
+                    default:
+                    {
+                        const VoidResult applied = apply_binary_column(
+                            instruction.opcode,
+                            column(depth - 2),
+                            column(depth - 1),
+                            selection,
+                            dense,
+                            &VM::apply_binary_i64);
+                        if (!applied.has_value())
+                        {
+                            return std::unexpected(applied.error());
+                        }
+                        break;
+                    }
+                }
+
+                if (block_ends)
+                {
+                    break;
+                }
+
+                // Rows from another path are waiting at the next pc; merge there so the two groups run as one vector.
+                ++pc;
+                if (pc < code.size() && queued[pc])
+                {
+                    deposit(pc, selection);
+                    selection.clear();
+                }
+            }
+        }
+    }
+
+    return {};
+}
+} // namespace stella::vm
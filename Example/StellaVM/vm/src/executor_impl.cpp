@@ -0,0 +1,102 @@
+module;
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+module vm;
+
+namespace stella::vm
+{
+ThreadPool::ThreadPool(std::size_t thread_count)
+{
+    thread_count = (std::max)(thread_count, std::size_t {1});
+    workers_.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        workers_.emplace_back([this](std::stop_token stop) { worker_loop(std::move(stop)); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    for (std::jthread& worker : workers_)
+    {
+        worker.request_stop();
+    }
+    tasks_available_.notify_all();
+    workers_.clear();
+}
+
+void ThreadPool::execute(std::move_only_function<void()> task)
+{
+    {
+        const std::scoped_lock lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    tasks_available_.notify_one();
+}
+
+auto ThreadPool::concurrency() const noexcept -> std::size_t
+{
+    return workers_.size();
+}
+
+void ManualExecutor::execute(std::move_only_function<void()> task)
+{
+    const std::scoped_lock lock(mutex_);
+    tasks_.push_back(std::move(task));
+}
+
+auto ManualExecutor::concurrency() const noexcept -> std::size_t
+{
+    return 1;
+}
+
+auto ManualExecutor::run_pending() -> std::size_t
+{
+    std::size_t ran = 0;
+    while (true)
+    {
+        std::move_only_function<void()> task;
+        {
+            const std::scoped_lock lock(mutex_);
+            if (tasks_.empty())
+            {
+                return ran;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        // Executor::execute rules out throwing tasks; one that throws anyway surfaces here on the caller's thread.
+        task();
+        ++ran;
+    }
+}
+
+void ThreadPool::worker_loop(std::stop_token stop)
+{
+    while (true)
+    {
+        std::move_only_function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            // Pending tasks are drained before honoring a stop request so callers waiting on them never hang.
+            tasks_available_.wait(lock, stop, [this] { return !tasks_.empty(); });
+            if (tasks_.empty())
+            {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        // Tasks must not throw (see Executor::execute); swallowing an exception here would strand whoever waits on the
+        // task, so it terminates like any exception escaping a std::jthread.
+        task();
+    }
+}
+} // namespace stella::vm
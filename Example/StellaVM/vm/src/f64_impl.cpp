@@ -0,0 +1,141 @@
+module;
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+module vm;
+
+namespace stella::vm
+{
+namespace
+{
+// Hardware propagates whichever NaN payload it likes; folding them to one keeps results, hashes and serialized
+// snapshots identical across platforms.
+[[nodiscard]] auto canonical(const double value) noexcept -> double
+{
+    return std::isnan(value) ? std::numeric_limits<double>::quiet_NaN() : value;
+}
+
+[[nodiscard]] auto f64_opcode_name(const OpCode opcode) noexcept -> std::string_view
+{
+    switch (opcode)
+    {
+        case OpCode::add_f64:
+            return "add_f64";
+        case OpCode::sub_f64:
+            return "sub_f64";
+        case OpCode::mul_f64:
+            return "mul_f64";
+        case OpCode::div_f64:
+            return "div_f64";
+        case OpCode::fma_f64:
+            return "fma_f64";
+        case OpCode::neg_f64:
+            return "neg_f64";
+        case OpCode::cmp_eq_f64:
+            return "cmp_eq_f64";
+        case OpCode::cmp_lt_f64:
+            return "cmp_lt_f64";
+        case OpCode::i64_to_f64:
+            return "i64_to_f64";
+        default:
+            return "f64_to_i64";
+    }
+}
+
+[[nodiscard]] auto f64_operand_count(const OpCode opcode) noexcept -> std::size_t
+{
+    switch (opcode)
+    {
+        case OpCode::fma_f64:
+            return 3;
+        case OpCode::neg_f64:
+        case OpCode::i64_to_f64:
+        case OpCode::f64_to_i64:
+            return 1;
+        default:
+            return 2;
+    }
+}
+
+// 2^63 is exact in binary64, and no double lies strictly between -2^63 - 1 and -2^63, so [-2^63, 2^63) is precisely
+// the range that truncates to a representable i64.
+constexpr double i64_limit = 9223372036854775808.0;
+} // namespace
+
+auto VM::execute_f64_opcode(const Instruction& instruction) -> Result<Value>
+{
+    const OpCode opcode = instruction.opcode;
+    const std::string_view name = f64_opcode_name(opcode);
+    const std::size_t count = f64_operand_count(opcode);
+
+    std::array<Value, 3> operands {};
+    for (std::size_t i = count; i > 0; --i)
+    {
+        Result<Value> popped = pop_value();
+        if (!popped.has_value())
+        {
+            return std::unexpected(popped.error());
+        }
+        operands[i - 1] = std::move(popped).value();
+    }
+
+    if (opcode == OpCode::i64_to_f64)
+    {
+        const Result<std::int64_t> integer = operands[0].expect_i64(name);
+        if (!integer.has_value())
+        {
+            return std::unexpected(integer.error());
+        }
+        return Value::f64(static_cast<double>(integer.value()));
+    }
+
+    std::array<double, 3> x {};
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        // The context string is only built on the failure path; this loop runs on every f64 instruction.
+        if (!operands[i].is_f64())
+        {
+            return std::unexpected(
+                operands[i].expect_f64(std::string(name) + " operand " + std::to_string(i)).error());
+        }
+        x[i] = operands[i].as_f64();
+    }
+
+    switch (opcode)
+    {
+        case OpCode::add_f64:
+            return Value::f64(canonical(x[0] + x[1]));
+        case OpCode::sub_f64:
+            return Value::f64(canonical(x[0] - x[1]));
+        case OpCode::mul_f64:
+            return Value::f64(canonical(x[0] * x[1]));
+        case OpCode::div_f64:
+            return Value::f64(canonical(x[0] / x[1]));
+        case OpCode::fma_f64:
+            return Value::f64(canonical(std::fma(x[0], x[1], x[2])));
+        case OpCode::neg_f64:
+            return Value::f64(canonical(-x[0]));
+        case OpCode::cmp_eq_f64:
+            return Value::i64(x[0] == x[1] ? 1 : 0);
+        case OpCode::cmp_lt_f64:
+            return Value::i64(x[0] < x[1] ? 1 : 0);
+        default:
+        {
+            if (std::isnan(x[0]) || x[0] >= i64_limit || x[0] < -i64_limit)
+            {
+                return std::unexpected(Error {
+                    ErrorCode::arithmetic_overflow,
+                    "f64_to_i64 operand is NaN or outside the i64 range.",
+                });
+            }
+            return Value::i64(static_cast<std::int64_t>(std::trunc(x[0])));
+        }
+    }
+}
+} // namespace stella::vm
@@ -0,0 +1,178 @@
+module;
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+module vm;
+
+namespace stella::vm
+{
+namespace
+{
+// Constants outlive every run, so a folded result may not view native-owned or arena memory. add_constant freezes
+// the owning forms into refcounted ones.
+[[nodiscard]] auto detach_folded(Value value) -> Value
+{
+    if (value.is_string_view())
+    {
+        return Value::owned_string(std::string(value.as_string_view()));
+    }
+    if (value.is_borrowed_buffer())
+    {
+        return Value::shared_buffer(SharedBuffer::copy_of(value.as_borrowed_buffer()));
+    }
+    return value;
+}
+} // namespace
+
+auto VM::fold_pure_natives(Program program) -> Result<Program>
+{
+    if (native_dispatch_depth_ != 0)
+    {
+        return std::unexpected(Error {
+            ErrorCode::native_reentrancy,
+            "fold_pure_natives cannot run inside a native callback.",
+        });
+    }
+
+    const std::size_t code_size = program.code.size();
+
+    // A block leader can be entered with a stack built elsewhere, so a constant run never extends across one.
+    std::vector<bool> leaders(code_size, false);
+    for (const Instruction& instruction : program.code)
+    {
+        const bool branches = instruction.opcode == OpCode::jump || instruction.opcode == OpCode::jump_if_true;
+        if (branches && instruction.operand < code_size)
+        {
+            leaders[instruction.operand] = true;
+        }
+    }
+    for (const Program::Function& function : program.functions)
+    {
+        if (function.entry < code_size)
+        {
+            leaders[function.entry] = true;
+        }
+    }
+    for (const Program::StringSwitch& string_switch : program.string_switches)
+    {
+        for (const Program::StringSwitch::Case& string_case : string_switch.cases)
+        {
+            if (string_case.target < code_size)
+            {
+                leaders[string_case.target] = true;
+            }
+        }
+        if (string_switch.default_target < code_size)
+        {
+            leaders[string_switch.default_target] = true;
+        }
+    }
+
+    // Natives run against a private stack so folding leaves a suspended run's state untouched.
+    std::pmr::vector<Value> fold_stack(stack_.get_allocator());
+    stack_.swap(fold_stack);
+    const Arena::Marker fold_scope = arena_.mark();
+    struct StackRestore final
+    {
+        std::pmr::vector<Value>& live;
+        std::pmr::vector<Value>& saved;
+
+        ~StackRestore()
+        {
+            live.swap(saved);
+        }
+    };
+    const StackRestore restore {stack_, fold_stack};
+
+    std::vector<Instruction> folded;
+    folded.reserve(code_size);
+    std::vector<std::uint32_t> new_pc(code_size + 1, 0);
+    std::size_t constant_run = 0;
+
+    for (std::size_t pc = 0; pc < code_size; ++pc)
+    {
+        const Instruction& instruction = program.code[pc];
+        if (leaders[pc])
+        {
+            constant_run = 0;
+        }
+        new_pc[pc] = static_cast<std::uint32_t>(folded.size());
+
+        if (instruction.opcode == OpCode::push_constant && instruction.operand < program.constants.size())
+        {
+            folded.push_back(instruction);
+            ++constant_run;
+            continue;
+        }
+
+        const bool foldable_call = instruction.opcode == OpCode::call_native &&
+            instruction.operand < native_bindings_.size() && native_bindings_[instruction.operand].pure &&
+            !native_bindings_[instruction.operand].async_function &&
+            native_bindings_[instruction.operand].arity <= constant_run;
+        if (foldable_call)
+        {
+            const std::size_t arity = native_bindings_[instruction.operand].arity;
+            const std::size_t args_begin = folded.size() - arity;
+            stack_.clear();
+            for (std::size_t arg = args_begin; arg < folded.size(); ++arg)
+            {
+                stack_.push_back(program.constants[folded[arg].operand]);
+            }
+
+            // A failing call stays in the code so the error still surfaces, with its context, when the program runs.
+            Result<Value> result = execute_call_native(instruction.operand);
+            if (result.has_value())
+            {
+                const std::size_t constant = program.add_constant(detach_folded(std::move(result).value()));
+                folded.resize(args_begin);
+                new_pc[pc] = static_cast<std::uint32_t>(folded.size());
+                folded.push_back({OpCode::push_constant, static_cast<std::uint32_t>(constant)});
+                constant_run = constant_run - arity + 1;
+                continue;
+            }
+        }
+
+        folded.push_back(instruction);
+        constant_run = 0;
+    }
+    stack_.clear();
+    new_pc[code_size] = static_cast<std::uint32_t>(folded.size());
+
+    // Out-of-range targets keep their distance past the end so the verifier still rejects them.
+    const auto remap = [&](const std::uint32_t target) -> std::uint32_t {
+        if (target <= code_size)
+        {
+            return new_pc[target];
+        }
+        return static_cast<std::uint32_t>(target - code_size + folded.size());
+    };
+    for (Instruction& instruction : folded)
+    {
+        if (instruction.opcode == OpCode::jump || instruction.opcode == OpCode::jump_if_true)
+        {
+            instruction.operand = remap(instruction.operand);
+        }
+    }
+    for (Program::Function& function : program.functions)
+    {
+        function.entry = remap(function.entry);
+    }
+    for (Program::StringSwitch& string_switch : program.string_switches)
+    {
+        for (Program::StringSwitch::Case& string_case : string_switch.cases)
+        {
+            string_case.target = remap(string_case.target);
+        }
+        string_switch.default_target = remap(string_switch.default_target);
+    }
+
+    // Folded results join the constant pool, so the intern table is rebuilt to cover them.
+    program.code = std::move(folded);
+    program.intern_strings();
+    return program;
+}
+} // namespace stella::vm
@@ -0,0 +1,419 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+module vm;
+
+namespace stella::vm
+{
+namespace
+{
+enum class MemoKind : std::uint8_t
+{
+    empty = 0,
+    i64 = 1,
+    f64 = 2,
+    text = 3,
+    bytes = 4,
+    unsupported = 5
+};
+
+[[nodiscard]] auto memo_kind(const Value& value) noexcept -> MemoKind
+{
+    if (value.is_empty())
+    {
+        return MemoKind::empty;
+    }
+    if (value.is_i64())
+    {
+        return MemoKind::i64;
+    }
+    if (value.is_f64())
+    {
+        return MemoKind::f64;
+    }
+    if (value.is_string())
+    {
+        return MemoKind::text;
+    }
+    if (value.is_bytes())
+    {
+        return MemoKind::bytes;
+    }
+    return MemoKind::unsupported;
+}
+
+[[nodiscard]] auto memo_payload(const Value& value) -> std::span<const std::byte>
+{
+    if (value.is_string())
+    {
+        const std::string_view text = value.expect_string("result cache").value();
+        return std::as_bytes(std::span<const char>(text.data(), text.size()));
+    }
+    if (value.is_bytes())
+    {
+        return value.expect_bytes("result cache").value();
+    }
+    return {};
+}
+
+class MemoHasher final
+{
+public:
+    void mix(const std::uint64_t value) noexcept
+    {
+        for (std::uint32_t shift = 0; shift < 64; shift += 8)
+        {
+            mix_byte(static_cast<std::uint8_t>((value >> shift) & 0xFFU));
+        }
+    }
+
+    void mix(const std::span<const std::byte> bytes) noexcept
+    {
+        mix(bytes.size());
+        for (const std::byte byte : bytes)
+        {
+            mix_byte(std::to_integer<std::uint8_t>(byte));
+        }
+    }
+
+    [[nodiscard]] auto value() const noexcept -> std::uint64_t
+    {
+        return hash_;
+    }
+
+private:
+    void mix_byte(const std::uint8_t byte) noexcept
+    {
+        hash_ ^= byte;
+        hash_ *= 0x100000001B3ULL;
+    }
+
+    std::uint64_t hash_ = 0xCBF29CE484222325ULL;
+};
+
+// Strings hash and compare by content whatever their ownership, so a borrowed input hits an entry stored as shared.
+[[nodiscard]] auto memo_key_hash(const std::uint64_t program_id, const std::span<const Value> inputs) -> std::uint64_t
+{
+    MemoHasher hasher;
+    hasher.mix(program_id);
+    hasher.mix(inputs.size());
+    for (const Value& input : inputs)
+    {
+        const MemoKind kind = memo_kind(input);
+        hasher.mix(static_cast<std::uint64_t>(kind));
+        switch (kind)
+        {
+            case MemoKind::i64:
+                hasher.mix(static_cast<std::uint64_t>(input.as_i64()));
+                break;
+            case MemoKind::f64:
+                hasher.mix(std::bit_cast<std::uint64_t>(input.as_f64()));
+                break;
+            case MemoKind::text:
+            case MemoKind::bytes:
+                hasher.mix(memo_payload(input));
+                break;
+            default:
+                break;
+        }
+    }
+    return hasher.value();
+}
+
+[[nodiscard]] auto memo_equal(const Value& lhs, const Value& rhs) -> bool
+{
+    const MemoKind kind = memo_kind(lhs);
+    if (kind != memo_kind(rhs))
+    {
+        return false;
+    }
+
+    switch (kind)
+    {
+        case MemoKind::empty:
+            return true;
+        case MemoKind::i64:
+            return lhs.as_i64() == rhs.as_i64();
+        case MemoKind::f64:
+            return std::bit_cast<std::uint64_t>(lhs.as_f64()) == std::bit_cast<std::uint64_t>(rhs.as_f64());
+        case MemoKind::text:
+        case MemoKind::bytes:
+        {
+            const std::span<const std::byte> left = memo_payload(lhs);
+            const std::span<const std::byte> right = memo_payload(rhs);
+            return std::equal(left.begin(), left.end(), right.begin(), right.end());
+        }
+        default:
+            return false;
+    }
+}
+
+// A probe key for the input that views its payload instead of copying it; only valid while the input is.
+[[nodiscard]] auto memo_view(const Value& value) -> Value
+{
+    if (value.is_string() && !value.is_string_view())
+    {
+        return Value::borrowed_string(value.expect_string("result cache").value());
+    }
+    if (value.is_bytes() && !value.is_borrowed_buffer())
+    {
+        return Value::borrowed_buffer(memo_payload(value));
+    }
+    return value;
+}
+
+// Stored values must not borrow caller memory, and hits should hand out refcounted copies rather than deep ones.
+[[nodiscard]] auto memo_detach(const Value& value) -> Value
+{
+    if (value.is_shared_string() || value.is_shared_buffer())
+    {
+        return value;
+    }
+    if (value.is_string())
+    {
+        return Value::shared_string(SharedString(std::string(value.expect_string("result cache").value())));
+    }
+    if (value.is_bytes())
+    {
+        return Value::shared_buffer(SharedBuffer::copy_of(memo_payload(value)));
+    }
+    return value;
+}
+} // namespace
+
+ResultCache::ResultCache(
+    const std::size_t max_entries,
+    const std::size_t shard_count,
+    const std::size_t max_payload_bytes)
+    : shard_count_((std::max)(shard_count, std::size_t {1}))
+    , max_payload_bytes_(max_payload_bytes)
+{
+    shards_ = std::make_unique<Shard[]>(shard_count_);
+    const std::size_t per_shard = (std::max)((max_entries + shard_count_ - 1) / shard_count_, std::size_t {1});
+    for (std::size_t i = 0; i < shard_count_; ++i)
+    {
+        shards_[i].capacity = per_shard;
+        shards_[i].slots.reserve(per_shard);
+    }
+}
+
+auto ResultCache::lookup(const std::uint64_t program_id, const std::span<const Value> inputs) -> std::optional<Value>
+{
+    const std::uint64_t hash = memo_key_hash(program_id, inputs);
+    Shard& shard = shard_for(hash);
+    {
+        const std::scoped_lock lock(shard.mutex);
+        const auto found = shard.index.find(hash);
+        if (found != shard.index.end())
+        {
+            Entry& entry = shard.slots[found->second];
+            const bool matches = entry.program_id == program_id &&
+                std::equal(inputs.begin(), inputs.end(), entry.inputs.begin(), entry.inputs.end(), memo_equal);
+            if (matches)
+            {
+                entry.referenced = true;
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return entry.result;
+            }
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+auto ResultCache::insert(const std::uint64_t program_id, const std::span<const Value> inputs, const Value& result)
+    -> bool
+{
+    std::size_t payload_bytes = memo_payload(result).size();
+    bool cacheable = memo_kind(result) != MemoKind::unsupported;
+    for (const Value& input : inputs)
+    {
+        cacheable = cacheable && memo_kind(input) != MemoKind::unsupported;
+        payload_bytes += memo_payload(input).size();
+    }
+    if (!cacheable || payload_bytes > max_payload_bytes_)
+    {
+        return false;
+    }
+
+    Entry entry;
+    entry.hash = memo_key_hash(program_id, inputs);
+    entry.program_id = program_id;
+    entry.inputs.reserve(inputs.size());
+    for (const Value& input : inputs)
+    {
+        entry.inputs.push_back(memo_detach(input));
+    }
+    entry.result = memo_detach(result);
+
+    Shard& shard = shard_for(entry.hash);
+    const std::scoped_lock lock(shard.mutex);
+    insertions_.fetch_add(1, std::memory_order_relaxed);
+
+    // A colliding or stale entry under the same hash is simply replaced.
+    if (const auto found = shard.index.find(entry.hash); found != shard.index.end())
+    {
+        shard.slots[found->second] = std::move(entry);
+        return true;
+    }
+
+    if (shard.slots.size() < shard.capacity)
+    {
+        shard.index.emplace(entry.hash, shard.slots.size());
+        shard.slots.push_back(std::move(entry));
+        return true;
+    }
+
+    while (shard.slots[shard.hand].referenced)
+    {
+        shard.slots[shard.hand].referenced = false;
+        shard.hand = (shard.hand + 1) % shard.slots.size();
+    }
+    Entry& victim = shard.slots[shard.hand];
+    shard.index.erase(victim.hash);
+    shard.index.emplace(entry.hash, shard.hand);
+    victim = std::move(entry);
+    shard.hand = (shard.hand + 1) % shard.slots.size();
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ResultCache::clear()
+{
+    for (std::size_t i = 0; i < shard_count_; ++i)
+    {
+        const std::scoped_lock lock(shards_[i].mutex);
+        shards_[i].slots.clear();
+        shards_[i].index.clear();
+        shards_[i].hand = 0;
+    }
+}
+
+auto ResultCache::size() const -> std::size_t
+{
+    std::size_t entries = 0;
+    for (std::size_t i = 0; i < shard_count_; ++i)
+    {
+        const std::scoped_lock lock(shards_[i].mutex);
+        entries += shards_[i].slots.size();
+    }
+    return entries;
+}
+
+auto ResultCache::stats() const noexcept -> ResultCacheStats
+{
+    return ResultCacheStats {
+        .hits = hits_.load(std::memory_order_relaxed),
+        .misses = misses_.load(std::memory_order_relaxed),
+        .insertions = insertions_.load(std::memory_order_relaxed),
+        .evictions = evictions_.load(std::memory_order_relaxed),
+    };
+}
+
+auto ResultCache::shard_for(const std::uint64_t hash) noexcept -> Shard&
+{
+    // The low bits pick the unordered_map bucket inside a shard, so shards use the high bits.
+    return shards_[(hash >> 32U) % shard_count_];
+}
+
+void VM::set_result_cache(ResultCache* cache) noexcept
+{
+    result_cache_ = cache;
+}
+
+auto VM::run_memoized(const Program& program, const std::uint64_t program_id) -> Result<Value>
+{
+    // Recomputed on every call: one linear scan is cheaper than trusting a verdict a program edit can invalidate.
+    const bool pure = std::none_of(program.code.begin(), program.code.end(), [this](const Instruction& op) {
+        switch (op.opcode)
+        {
+            case OpCode::call_native:
+                return op.operand >= native_bindings_.size() || !native_bindings_[op.operand].pure ||
+                    static_cast<bool>(native_bindings_[op.operand].async_function);
+            case OpCode::load_field_i64:
+            case OpCode::load_field_f64:
+            case OpCode::load_field_string:
+            case OpCode::load_field_bytes:
+                return true;
+            default:
+                return false;
+        }
+    });
+
+    if (result_cache_ == nullptr || !pure)
+    {
+        if (profiling_enabled_)
+        {
+            ++profile_stats_.result_cache_bypasses;
+        }
+        return run(program);
+    }
+
+    // The probe key views plain inputs in place, so a hit copies no payloads; bound views contribute what they read.
+    std::vector<Value> key;
+    key.reserve(inputs_.size());
+    for (std::size_t i = 0; i < inputs_.size(); ++i)
+    {
+        key.push_back(input_views_[i].bound() ? input_views_[i].read() : memo_view(inputs_[i]));
+    }
+
+    // push_input moves plain inputs out as the run reads them. Every plain slot is emptied after both a hit and a miss,
+    // so the VM is left the same whether or not the cache answered.
+    const auto consume_plain_inputs = [this] {
+        for (std::size_t i = 0; i < inputs_.size(); ++i)
+        {
+            if (!input_views_[i].bound())
+            {
+                inputs_[i] = Value {};
+            }
+        }
+    };
+
+    if (std::optional<Value> cached = result_cache_->lookup(program_id, key))
+    {
+        consume_plain_inputs();
+        if (profiling_enabled_)
+        {
+            ++profile_stats_.result_cache_hits;
+        }
+        return std::move(cached).value();
+    }
+
+    // The run consumes plain inputs, so on a miss the key holds refcounted copies instead. Owned payloads move into
+    // shared form rather than being copied, and insert stores shared values as they are.
+    for (std::size_t i = 0; i < inputs_.size(); ++i)
+    {
+        if (!input_views_[i].bound())
+        {
+            key[i] = inputs_[i].share();
+        }
+    }
+
+    Result<Value> result = run(program);
+    consume_plain_inputs();
+    if (result.has_value() && !result_cache_->insert(program_id, key, result.value()))
+    {
+        if (profiling_enabled_)
+        {
+            ++profile_stats_.result_cache_bypasses;
+        }
+        return result;
+    }
+    if (profiling_enabled_)
+    {
+        ++profile_stats_.result_cache_misses;
+    }
+    return result;
+}
+} // namespace stella::vm
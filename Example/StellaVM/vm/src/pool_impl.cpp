@@ -0,0 +1,189 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+module vm;
+
+namespace stella::vm
+{
+namespace
+{
+constexpr std::size_t vm_pool_max_shard_idle = 4;
+} // namespace
+
+VMPool::Lease::Lease(VMPool* pool, std::unique_ptr<VM> vm) noexcept
+    : pool_(pool)
+    , vm_(std::move(vm))
+{
+}
+
+VMPool::Lease::~Lease()
+{
+    release();
+}
+
+VMPool::Lease::Lease(Lease&& other) noexcept
+    : pool_(std::exchange(other.pool_, nullptr))
+    , vm_(std::move(other.vm_))
+{
+}
+
+auto VMPool::Lease::operator=(Lease&& other) noexcept -> Lease&
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+
+    release();
+    pool_ = std::exchange(other.pool_, nullptr);
+    vm_ = std::move(other.vm_);
+    return *this;
+}
+
+VMPool::Lease::operator bool() const noexcept
+{
+    return vm_ != nullptr;
+}
+
+auto VMPool::Lease::vm() const noexcept -> VM&
+{
+    return *vm_;
+}
+
+auto VMPool::Lease::operator*() const noexcept -> VM&
+{
+    return *vm_;
+}
+
+auto VMPool::Lease::operator->() const noexcept -> VM*
+{
+    return vm_.get();
+}
+
+void VMPool::Lease::release() noexcept
+{
+    if (pool_ != nullptr && vm_ != nullptr)
+    {
+        pool_->recycle(std::move(vm_));
+    }
+    pool_ = nullptr;
+    vm_.reset();
+}
+
+VMPool::VMPool(ConfigureFunction configure, std::size_t max_idle, std::size_t stack_reserve, std::size_t arena_bytes)
+    : configure_(std::move(configure))
+    , stack_reserve_(stack_reserve)
+    , arena_bytes_(arena_bytes)
+    , shard_count_((std::max)(std::size_t {1}, static_cast<std::size_t>(std::thread::hardware_concurrency())))
+{
+    shard_capacity_ = (std::min)(vm_pool_max_shard_idle, max_idle / shard_count_);
+    shared_capacity_ = max_idle - shard_capacity_ * shard_count_;
+
+    // Capacity is reserved up front so recycling a VM never allocates.
+    shards_ = std::make_unique<Shard[]>(shard_count_);
+    for (std::size_t i = 0; i < shard_count_; ++i)
+    {
+        shards_[i].idle.reserve(shard_capacity_);
+    }
+    shared_idle_.reserve(shared_capacity_);
+}
+
+VMPool::~VMPool() = default;
+
+auto VMPool::acquire() -> Lease
+{
+    Shard& shard = local_shard();
+    {
+        std::scoped_lock lock(shard.mutex);
+        if (!shard.idle.empty())
+        {
+            std::unique_ptr<VM> vm = std::move(shard.idle.back());
+            shard.idle.pop_back();
+            local_hits_.fetch_add(1, std::memory_order_relaxed);
+            return Lease(this, std::move(vm));
+        }
+    }
+    {
+        std::scoped_lock lock(shared_mutex_);
+        if (!shared_idle_.empty())
+        {
+            std::unique_ptr<VM> vm = std::move(shared_idle_.back());
+            shared_idle_.pop_back();
+            shared_hits_.fetch_add(1, std::memory_order_relaxed);
+            return Lease(this, std::move(vm));
+        }
+    }
+
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    auto vm = std::make_unique<VM>(stack_reserve_, arena_bytes_);
+    if (configure_)
+    {
+        configure_(*vm);
+    }
+    return Lease(this, std::move(vm));
+}
+
+auto VMPool::idle() const -> std::size_t
+{
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < shard_count_; ++i)
+    {
+        std::scoped_lock lock(shards_[i].mutex);
+        total += shards_[i].idle.size();
+    }
+
+    std::scoped_lock lock(shared_mutex_);
+    return total + shared_idle_.size();
+}
+
+auto VMPool::stats() const noexcept -> VMPoolStats
+{
+    return VMPoolStats {
+        .local_hits = local_hits_.load(std::memory_order_relaxed),
+        .shared_hits = shared_hits_.load(std::memory_order_relaxed),
+        .misses = misses_.load(std::memory_order_relaxed),
+        .releases = releases_.load(std::memory_order_relaxed),
+        .discarded = discarded_.load(std::memory_order_relaxed),
+    };
+}
+
+void VMPool::recycle(std::unique_ptr<VM> vm) noexcept
+{
+    releases_.fetch_add(1, std::memory_order_relaxed);
+    vm->reset();
+
+    Shard& shard = local_shard();
+    {
+        std::scoped_lock lock(shard.mutex);
+        if (shard.idle.size() < shard_capacity_)
+        {
+            shard.idle.push_back(std::move(vm));
+            return;
+        }
+    }
+    {
+        std::scoped_lock lock(shared_mutex_);
+        if (shared_idle_.size() < shared_capacity_)
+        {
+            shared_idle_.push_back(std::move(vm));
+            return;
+        }
+    }
+
+    discarded_.fetch_add(1, std::memory_order_relaxed);
+}
+
+auto VMPool::local_shard() noexcept -> Shard&
+{
+    const std::size_t hash = std::hash<std::thread::id> {}(std::this_thread::get_id());
+    return shards_[hash % shard_count_];
+}
+} // namespace stella::vm
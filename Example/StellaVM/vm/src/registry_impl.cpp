@@ -0,0 +1,249 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+module vm;
+
+namespace stella::vm
+{
+ProgramRegistry::Snapshot::Snapshot(ReaderSlot* slot, const Version* version) noexcept
+    : slot_(slot)
+    , version_(version)
+{
+}
+
+ProgramRegistry::Snapshot::~Snapshot()
+{
+    release();
+}
+
+ProgramRegistry::Snapshot::Snapshot(Snapshot&& other) noexcept
+    : slot_(std::exchange(other.slot_, nullptr))
+    , version_(std::exchange(other.version_, nullptr))
+{
+}
+
+auto ProgramRegistry::Snapshot::operator=(Snapshot&& other) noexcept -> Snapshot&
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+
+    release();
+    slot_ = std::exchange(other.slot_, nullptr);
+    version_ = std::exchange(other.version_, nullptr);
+    return *this;
+}
+
+ProgramRegistry::Snapshot::operator bool() const noexcept
+{
+    return version_ != nullptr;
+}
+
+auto ProgramRegistry::Snapshot::program() const noexcept -> const Program&
+{
+    return version_->program;
+}
+
+auto ProgramRegistry::Snapshot::version() const noexcept -> std::uint64_t
+{
+    return version_ == nullptr ? 0 : version_->number;
+}
+
+void ProgramRegistry::Snapshot::release() noexcept
+{
+    if (slot_ == nullptr)
+    {
+        return;
+    }
+
+    if (--slot_->depth == 0)
+    {
+        slot_->active_epoch.store(idle_epoch, std::memory_order_release);
+    }
+    slot_ = nullptr;
+    version_ = nullptr;
+}
+
+ProgramRegistry::Reader::Reader(ProgramRegistry* registry, ReaderSlot* slot) noexcept
+    : registry_(registry)
+    , slot_(slot)
+{
+}
+
+ProgramRegistry::Reader::~Reader()
+{
+    if (registry_ != nullptr)
+    {
+        registry_->release_reader(slot_);
+    }
+}
+
+ProgramRegistry::Reader::Reader(Reader&& other) noexcept
+    : registry_(std::exchange(other.registry_, nullptr))
+    , slot_(std::exchange(other.slot_, nullptr))
+{
+}
+
+auto ProgramRegistry::Reader::operator=(Reader&& other) noexcept -> Reader&
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+
+    if (registry_ != nullptr)
+    {
+        registry_->release_reader(slot_);
+    }
+    registry_ = std::exchange(other.registry_, nullptr);
+    slot_ = std::exchange(other.slot_, nullptr);
+    return *this;
+}
+
+auto ProgramRegistry::Reader::acquire() noexcept -> Snapshot
+{
+    // Announcing the epoch before loading the version guarantees a concurrent publisher sees this reader when it
+    // decides whether the version it just replaced can be freed. Nested snapshots keep the oldest announcement,
+    // which also protects every newer version.
+    if (slot_->depth++ == 0)
+    {
+        slot_->active_epoch.store(registry_->epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+
+    const Version* version = registry_->current_.load(std::memory_order_seq_cst);
+    return Snapshot(slot_, version);
+}
+
+ProgramRegistry::ProgramRegistry() = default;
+
+ProgramRegistry::~ProgramRegistry()
+{
+    delete current_.load(std::memory_order_acquire);
+}
+
+auto ProgramRegistry::publish(Program program, const VM& verifier, const std::size_t available_inputs)
+    -> Result<std::uint64_t>
+{
+    const VoidResult verified = verifier.verify(program, available_inputs);
+    if (!verified.has_value())
+    {
+        return std::unexpected(verified.error());
+    }
+
+    return install(std::move(program));
+}
+
+auto ProgramRegistry::publish(
+    Program program,
+    const VM& verifier,
+    const std::size_t available_inputs,
+    Executor& executor) -> Result<std::uint64_t>
+{
+    const VoidResult verified = verifier.verify_parallel(program, available_inputs, executor);
+    if (!verified.has_value())
+    {
+        return std::unexpected(verified.error());
+    }
+
+    return install(std::move(program));
+}
+
+auto ProgramRegistry::reader() -> Reader
+{
+    const std::scoped_lock lock(writer_mutex_);
+    ReaderSlot* slot = nullptr;
+    if (!free_slots_.empty())
+    {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    else
+    {
+        slot = &reader_slots_.emplace_back();
+    }
+    return Reader(this, slot);
+}
+
+auto ProgramRegistry::collect() -> std::size_t
+{
+    std::vector<std::unique_ptr<Version>> reclaimed;
+    {
+        const std::scoped_lock lock(writer_mutex_);
+        reclaimed = collect_locked();
+    }
+    return reclaimed.size();
+}
+
+auto ProgramRegistry::current_version() const noexcept -> std::uint64_t
+{
+    const Version* version = current_.load(std::memory_order_acquire);
+    return version == nullptr ? 0 : version->number;
+}
+
+auto ProgramRegistry::retired_versions() const -> std::size_t
+{
+    const std::scoped_lock lock(writer_mutex_);
+    return retired_.size();
+}
+
+auto ProgramRegistry::install(Program program) -> std::uint64_t
+{
+    auto version = std::make_unique<Version>();
+    version->program = std::move(program);
+
+    // Retired programs are destroyed after the lock is dropped so large frees never extend the writer critical
+    // section that reader registration shares.
+    std::vector<std::unique_ptr<Version>> reclaimed;
+    std::uint64_t number = 0;
+    {
+        const std::scoped_lock lock(writer_mutex_);
+        number = ++last_version_;
+        version->number = number;
+
+        Version* previous = current_.exchange(version.release(), std::memory_order_seq_cst);
+        const std::uint64_t retire_epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+        if (previous != nullptr)
+        {
+            retired_.push_back({std::unique_ptr<Version>(previous), retire_epoch});
+        }
+        reclaimed = collect_locked();
+    }
+    return number;
+}
+
+auto ProgramRegistry::collect_locked() -> std::vector<std::unique_ptr<Version>>
+{
+    std::uint64_t oldest_active = idle_epoch;
+    for (const ReaderSlot& slot : reader_slots_)
+    {
+        oldest_active = (std::min)(oldest_active, slot.active_epoch.load(std::memory_order_seq_cst));
+    }
+
+    std::vector<std::unique_ptr<Version>> reclaimed;
+    const auto still_visible = std::stable_partition(retired_.begin(), retired_.end(), [&](const RetiredVersion& r) {
+        return r.retire_epoch >= oldest_active;
+    });
+    for (auto it = still_visible; it != retired_.end(); ++it)
+    {
+        reclaimed.push_back(std::move(it->version));
+    }
+    retired_.erase(still_visible, retired_.end());
+    return reclaimed;
+}
+
+void ProgramRegistry::release_reader(ReaderSlot* slot) noexcept
+{
+    const std::scoped_lock lock(writer_mutex_);
+    slot->depth = 0;
+    slot->active_epoch.store(idle_epoch, std::memory_order_release);
+    free_slots_.push_back(slot);
+}
+} // namespace stella::vm
@@ -0,0 +1,248 @@
+module;
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+module vm;
+
+namespace stella::vm
+{
+namespace
+{
+template <typename Fiber>
+[[nodiscard]] auto runs_later(const std::unique_ptr<Fiber>& lhs, const std::unique_ptr<Fiber>& rhs) noexcept -> bool
+{
+    if (lhs->options.priority != rhs->options.priority)
+    {
+        return lhs->options.priority < rhs->options.priority;
+    }
+    return lhs->sequence > rhs->sequence;
+}
+
+template <typename Fiber>
+[[nodiscard]] auto slice_budget(const Fiber& fiber) noexcept -> std::size_t
+{
+    const std::size_t slice = (std::max)(fiber.options.slice_steps, std::size_t {1});
+    if (fiber.options.step_limit == 0)
+    {
+        return slice;
+    }
+    return (std::min)(slice, fiber.options.step_limit - fiber.steps_used);
+}
+} // namespace
+
+Scheduler::Scheduler(VMPool& pool, std::size_t worker_count, const SchedulingPolicy policy)
+    : pool_(pool)
+    , policy_(policy)
+{
+    worker_count_ = (std::max)(worker_count, std::size_t {1});
+    workers_state_ = std::make_unique<Worker[]>(worker_count_);
+    workers_.reserve(worker_count_);
+    for (std::size_t i = 0; i < worker_count_; ++i)
+    {
+        workers_.emplace_back([this, i](std::stop_token stop) { worker_loop(i, std::move(stop)); });
+    }
+}
+
+Scheduler::~Scheduler()
+{
+    wait_idle();
+    for (std::jthread& worker : workers_)
+    {
+        worker.request_stop();
+    }
+    work_available_.notify_all();
+    workers_.clear();
+}
+
+void Scheduler::spawn(const Program& program, FiberSetup setup, Completion on_complete, FiberOptions options)
+{
+    auto fiber = std::make_unique<Fiber>();
+    fiber->program = &program;
+    fiber->setup = std::move(setup);
+    fiber->on_complete = std::move(on_complete);
+    fiber->options = options;
+    if (policy_ == SchedulingPolicy::round_robin)
+    {
+        fiber->options.priority = 0;
+    }
+
+    active_.fetch_add(1, std::memory_order_relaxed);
+    spawned_.fetch_add(1, std::memory_order_relaxed);
+    enqueue(next_worker_.fetch_add(1, std::memory_order_relaxed) % worker_count_, std::move(fiber));
+}
+
+void Scheduler::wait_idle()
+{
+    std::unique_lock lock(idle_mutex_);
+    fibers_finished_.wait(lock, [this] { return active_.load(std::memory_order_acquire) == 0; });
+}
+
+auto Scheduler::active_fibers() const noexcept -> std::size_t
+{
+    return active_.load(std::memory_order_relaxed);
+}
+
+auto Scheduler::worker_count() const noexcept -> std::size_t
+{
+    return worker_count_;
+}
+
+auto Scheduler::stats() const noexcept -> SchedulerStats
+{
+    return SchedulerStats {
+        .spawned = spawned_.load(std::memory_order_relaxed),
+        .completed = completed_.load(std::memory_order_relaxed),
+        .slices = slices_.load(std::memory_order_relaxed),
+        .steals = steals_.load(std::memory_order_relaxed),
+    };
+}
+
+void Scheduler::enqueue(const std::size_t worker, std::unique_ptr<Fiber> fiber)
+{
+    // A fresh sequence on every enqueue sends a fiber that just used its slice behind its equal-priority peers.
+    fiber->sequence = next_sequence_.fetch_add(1, std::memory_order_relaxed);
+    {
+        Worker& state = workers_state_[worker];
+        const std::scoped_lock lock(state.mutex);
+        state.ready.push_back(std::move(fiber));
+        std::push_heap(state.ready.begin(), state.ready.end(), runs_later<Fiber>);
+    }
+    {
+        const std::scoped_lock lock(idle_mutex_);
+        runnable_.fetch_add(1, std::memory_order_relaxed);
+    }
+    work_available_.notify_one();
+}
+
+auto Scheduler::pop_ready(Worker& worker) -> std::unique_ptr<Fiber>
+{
+    const std::scoped_lock lock(worker.mutex);
+    if (worker.ready.empty())
+    {
+        return nullptr;
+    }
+
+    std::pop_heap(worker.ready.begin(), worker.ready.end(), runs_later<Fiber>);
+    std::unique_ptr<Fiber> fiber = std::move(worker.ready.back());
+    worker.ready.pop_back();
+    runnable_.fetch_sub(1, std::memory_order_relaxed);
+    return fiber;
+}
+
+auto Scheduler::take(const std::size_t worker) -> std::unique_ptr<Fiber>
+{
+    if (std::unique_ptr<Fiber> fiber = pop_ready(workers_state_[worker]))
+    {
+        return fiber;
+    }
+
+    for (std::size_t offset = 1; offset < worker_count_; ++offset)
+    {
+        if (std::unique_ptr<Fiber> fiber = pop_ready(workers_state_[(worker + offset) % worker_count_]))
+        {
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return fiber;
+        }
+    }
+    return nullptr;
+}
+
+void Scheduler::run_slice(const std::size_t worker, std::unique_ptr<Fiber> fiber)
+{
+    const std::size_t budget = slice_budget(*fiber);
+    Result<RunSlice> slice;
+    if (!fiber->lease)
+    {
+        fiber->lease = pool_.acquire();
+        fiber->previous_budget = fiber->lease->step_budget();
+        if (fiber->setup)
+        {
+            fiber->setup(*fiber->lease);
+            fiber->setup = nullptr;
+        }
+        fiber->lease->set_step_budget(budget);
+        slice = fiber->lease->run_resumable(*fiber->program);
+    }
+    else
+    {
+        fiber->lease->set_step_budget(budget);
+        slice = fiber->lease->resume();
+    }
+    slices_.fetch_add(1, std::memory_order_relaxed);
+
+    if (slice.has_value() && slice->status == RunStatus::awaiting_native)
+    {
+        // Parked fibers hold no queue slot; completion of the async native makes the fiber runnable again.
+        const PendingValue pending = std::move(slice->pending);
+        pending.on_ready([this, worker, parked = std::move(fiber)]() mutable { enqueue(worker, std::move(parked)); });
+        return;
+    }
+
+    Result<Value> result = Value {};
+    if (slice.has_value() && (slice->status == RunStatus::suspended || slice->status == RunStatus::yielded))
+    {
+        // A yielding fiber hands its worker back early, so it is charged only for the steps it actually ran.
+        fiber->steps_used += slice->steps;
+        if (fiber->options.step_limit == 0 || fiber->steps_used < fiber->options.step_limit)
+        {
+            enqueue(worker, std::move(fiber));
+            return;
+        }
+        result = std::unexpected(Error {
+            ErrorCode::step_budget_exceeded,
+            "Fiber step limit exhausted before termination.",
+        });
+    }
+    else if (slice.has_value())
+    {
+        result = std::move(slice->value);
+    }
+    else
+    {
+        result = std::unexpected(slice.error());
+    }
+
+    fiber->lease->set_step_budget(fiber->previous_budget);
+    fiber->lease.release();
+    if (fiber->on_complete)
+    {
+        fiber->on_complete(std::move(result));
+    }
+    fiber.reset();
+
+    completed_.fetch_add(1, std::memory_order_relaxed);
+    if (active_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        const std::scoped_lock lock(idle_mutex_);
+        fibers_finished_.notify_all();
+    }
+}
+
+void Scheduler::worker_loop(const std::size_t worker, std::stop_token stop)
+{
+    while (true)
+    {
+        if (std::unique_ptr<Fiber> fiber = take(worker))
+        {
+            run_slice(worker, std::move(fiber));
+            continue;
+        }
+
+        std::unique_lock lock(idle_mutex_);
+        work_available_.wait(lock, stop, [this] { return runnable_.load(std::memory_order_relaxed) != 0; });
+        if (runnable_.load(std::memory_order_relaxed) == 0)
+        {
+            return;
+        }
+    }
+}
+} // namespace stella::vm
@@ -0,0 +1,473 @@
+module;
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+module vm;
+
+namespace stella::vm
+{
+using error_detail::make_unexpected;
+
+namespace
+{
+[[nodiscard]] auto string_opcode_name(const OpCode opcode) noexcept -> std::string_view
+{
+    switch (opcode)
+    {
+        case OpCode::str_len:
+            return "str_len";
+        case OpCode::str_eq:
+            return "str_eq";
+        case OpCode::str_prefix:
+            return "str_prefix";
+        case OpCode::str_slice:
+            return "str_slice";
+        case OpCode::str_hash:
+            return "str_hash";
+        case OpCode::str_find:
+            return "str_find";
+        default:
+            return "str_concat";
+    }
+}
+
+// str_slice's offset and length are integers and are popped separately.
+[[nodiscard]] auto string_operand_count(const OpCode opcode) noexcept -> std::size_t
+{
+    switch (opcode)
+    {
+        case OpCode::str_len:
+        case OpCode::str_hash:
+        case OpCode::str_slice:
+            return 1;
+        default:
+            return 2;
+    }
+}
+
+// FNV-1a, so rule tables can precompute keys offline without linking the VM.
+[[nodiscard]] auto fnv1a(const std::string_view text) noexcept -> std::uint64_t
+{
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    for (const char c : text)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// Covers everything intern_strings reads: which constants are strings, their bytes, and every switch table.
+[[nodiscard]] auto intern_source_fingerprint(const Program& program) noexcept -> std::uint64_t
+{
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    const auto mix = [&hash](const std::uint64_t value) {
+        hash ^= value;
+        hash *= 0x100000001B3ULL;
+    };
+
+    mix(program.constants.size());
+    for (const Value& constant : program.constants)
+    {
+        mix(constant.is_string() ? fnv1a(constant.expect_string("intern_strings").value()) : 0);
+    }
+    mix(program.string_switches.size());
+    for (const Program::StringSwitch& string_switch : program.string_switches)
+    {
+        mix(string_switch.default_target);
+        mix(string_switch.cases.size());
+        for (const Program::StringSwitch::Case& string_case : string_switch.cases)
+        {
+            mix((static_cast<std::uint64_t>(string_case.constant) << 32U) | string_case.target);
+        }
+    }
+    return hash;
+}
+
+[[nodiscard]] auto find_substring(const std::string_view haystack, const std::string_view needle) noexcept
+    -> std::int64_t
+{
+    if (needle.size() > haystack.size())
+    {
+        return -1;
+    }
+    if (needle.empty())
+    {
+        return 0;
+    }
+
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    // Test the needle's first and last bytes at 32 candidate positions per step; only positions matching both get a
+    // full compare, which keeps common-first-byte haystacks off the slow path.
+    const std::size_t last = needle.size() - 1;
+    const __m256i first_byte = _mm256_set1_epi8(needle.front());
+    const __m256i last_byte = _mm256_set1_epi8(needle.back());
+    for (; i + last + 32 <= haystack.size(); i += 32)
+    {
+        const auto* head = reinterpret_cast<const __m256i*>(haystack.data() + i);
+        const auto* tail = reinterpret_cast<const __m256i*>(haystack.data() + i + last);
+        const __m256i both = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(head), first_byte),
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(tail), last_byte));
+        auto candidates = static_cast<std::uint32_t>(_mm256_movemask_epi8(both));
+        while (candidates != 0)
+        {
+            const std::size_t at = i + static_cast<std::size_t>(std::countr_zero(candidates));
+            if (std::memcmp(haystack.data() + at, needle.data(), needle.size()) == 0)
+            {
+                return static_cast<std::int64_t>(at);
+            }
+            candidates &= candidates - 1;
+        }
+    }
+#endif
+    const std::size_t found = haystack.find(needle, i);
+    return found == std::string_view::npos ? -1 : static_cast<std::int64_t>(found);
+}
+
+[[nodiscard]] auto stale_table_error(const std::string_view name) -> std::unexpected<Error>
+{
+    return make_unexpected(
+        ErrorCode::stale_intern_table,
+        std::string(name) + " needs Program::intern_strings after the last constant or switch table edit.");
+}
+
+// Interned ids pass through unchanged; strings are looked up, which costs one hash and usually one compare.
+[[nodiscard]] auto resolve_intern_id(const InternTable& table, const Value& value, const std::string_view name)
+    -> Result<std::int64_t>
+{
+    if (value.is_i64())
+    {
+        return value.as_i64();
+    }
+    const Result<std::string_view> text = value.expect_string(name);
+    if (!text.has_value())
+    {
+        return std::unexpected(text.error());
+    }
+    return table.find(text.value());
+}
+
+[[nodiscard]] auto in_bounds(const std::size_t size, const std::int64_t offset, const std::int64_t length) noexcept
+    -> bool
+{
+    return offset >= 0 && length >= 0 && static_cast<std::uint64_t>(offset) <= size &&
+        static_cast<std::uint64_t>(length) <= size - static_cast<std::uint64_t>(offset);
+}
+} // namespace
+
+auto VM::execute_string_opcode(const Instruction& instruction) -> Result<Value>
+{
+    const OpCode opcode = instruction.opcode;
+    const std::string_view name = string_opcode_name(opcode);
+
+    const auto pop_i64 = [&](const std::string_view role) -> Result<std::int64_t> {
+        Result<Value> popped = pop_value();
+        if (!popped.has_value())
+        {
+            return std::unexpected(popped.error());
+        }
+        return popped->expect_i64(std::string(name) + " " + std::string(role));
+    };
+
+    std::int64_t length = 0;
+    std::int64_t offset = 0;
+    if (opcode == OpCode::str_slice)
+    {
+        const Result<std::int64_t> popped_length = pop_i64("length");
+        if (!popped_length.has_value())
+        {
+            return std::unexpected(popped_length.error());
+        }
+        const Result<std::int64_t> popped_offset = pop_i64("offset");
+        if (!popped_offset.has_value())
+        {
+            return std::unexpected(popped_offset.error());
+        }
+        length = popped_length.value();
+        offset = popped_offset.value();
+    }
+
+    // The operands stay alive in this frame, so every view below points at their payloads without copying.
+    const std::size_t count = string_operand_count(opcode);
+    std::array<Value, 2> operands {};
+    std::array<std::string_view, 2> text {};
+    for (std::size_t i = count; i > 0; --i)
+    {
+        Result<Value> popped = pop_value();
+        if (!popped.has_value())
+        {
+            return std::unexpected(popped.error());
+        }
+        operands[i - 1] = std::move(popped).value();
+        const Result<std::string_view> view = operands[i - 1].expect_string(name);
+        if (!view.has_value())
+        {
+            return std::unexpected(view.error());
+        }
+        text[i - 1] = view.value();
+    }
+
+    switch (opcode)
+    {
+        case OpCode::str_len:
+            return Value::i64(static_cast<std::int64_t>(text[0].size()));
+        case OpCode::str_hash:
+            return Value::i64(static_cast<std::int64_t>(fnv1a(text[0])));
+        case OpCode::str_eq:
+            return Value::i64(text[0] == text[1] ? 1 : 0);
+        case OpCode::str_prefix:
+            return Value::i64(text[0].starts_with(text[1]) ? 1 : 0);
+        case OpCode::str_find:
+            return Value::i64(find_substring(text[0], text[1]));
+        case OpCode::str_slice:
+        {
+            if (!in_bounds(text[0].size(), offset, length))
+            {
+                return make_unexpected(ErrorCode::invalid_string_access, "str_slice range exceeds the string.");
+            }
+            const auto begin = static_cast<std::size_t>(offset);
+            const auto size = static_cast<std::size_t>(length);
+            Value& source = operands[0];
+            if (source.is_string_view())
+            {
+                return Value::borrowed_string(text[0].substr(begin, size));
+            }
+            if (source.is_shared_string())
+            {
+                return Value::shared_string(source.as_shared_string().slice(begin, size));
+            }
+
+            // An owned payload moves into a refcounted one, so the slice shares it instead of copying.
+            return Value::shared_string(SharedString(std::move(source.as_owned_string())).slice(begin, size));
+        }
+        default:
+        {
+            const std::size_t total = text[0].size() + text[1].size();
+            if (arena_payloads_enabled_)
+            {
+                // The run rewinds the arena on exit and promote_arena_result copies out a result that still views it.
+                char* joined = arena_.allocate<char>((std::max)(total, std::size_t {1}));
+                std::copy(text[1].begin(), text[1].end(), std::copy(text[0].begin(), text[0].end(), joined));
+                return Value::borrowed_string(std::string_view(joined, total));
+            }
+            std::string joined;
+            joined.reserve(total);
+            joined.append(text[0]).append(text[1]);
+            return Value::owned_string(std::move(joined));
+        }
+    }
+}
+
+auto InternTable::find(const std::string_view text) const noexcept -> std::int64_t
+{
+    if (slots_.empty())
+    {
+        return -1;
+    }
+    const std::uint32_t entry = slots_[locate(text, fnv1a(text))];
+    return entry == 0 ? -1 : static_cast<std::int64_t>(entry - 1);
+}
+
+auto InternTable::constant_id(const std::size_t constant) const noexcept -> std::int64_t
+{
+    return constant < constant_ids_.size() ? constant_ids_[constant] : -1;
+}
+
+auto InternTable::switch_target(const std::size_t table, const std::int64_t id) const noexcept -> std::uint32_t
+{
+    const std::size_t row = table * (strings_.size() + 1);
+    if (id < 0 || static_cast<std::uint64_t>(id) >= strings_.size())
+    {
+        return switch_targets_[row + strings_.size()];
+    }
+    return switch_targets_[row + static_cast<std::size_t>(id)];
+}
+
+auto InternTable::size() const noexcept -> std::size_t
+{
+    return strings_.size();
+}
+
+auto InternTable::current_for(const Program& program) const noexcept -> bool
+{
+    return current_source(program).has_value();
+}
+
+auto InternTable::current_source(const Program& program) const noexcept -> std::optional<std::uint64_t>
+{
+    if (!indexes(program) || source_fingerprint_ != intern_source_fingerprint(program))
+    {
+        return std::nullopt;
+    }
+    return source_fingerprint_;
+}
+
+auto InternTable::indexes(const Program& program) const noexcept -> bool
+{
+    return constant_ids_.size() == program.constants.size() && switch_count_ == program.string_switches.size();
+}
+
+auto InternTable::locate(const std::string_view text, const std::uint64_t hash) const noexcept -> std::size_t
+{
+    // The table is at most half full, so probing always reaches an empty slot.
+    const std::size_t mask = slots_.size() - 1;
+    for (std::size_t slot = static_cast<std::size_t>(hash) & mask;; slot = (slot + 1) & mask)
+    {
+        const std::uint32_t entry = slots_[slot];
+        if (entry == 0 || (hashes_[entry - 1] == hash && strings_[entry - 1].view() == text))
+        {
+            return slot;
+        }
+    }
+}
+
+auto Program::add_string_switch(StringSwitch table) -> std::size_t
+{
+    string_switches.push_back(std::move(table));
+    return string_switches.size() - 1;
+}
+
+auto Program::intern_strings() -> std::size_t
+{
+    const auto string_count = static_cast<std::size_t>(
+        std::count_if(constants.begin(), constants.end(), [](const Value& constant) { return constant.is_string(); }));
+
+    InternTable table;
+    table.slots_.assign(std::bit_ceil((std::max)(string_count * 2, std::size_t {8})), 0);
+    table.constant_ids_.assign(constants.size(), -1);
+    for (std::size_t i = 0; i < constants.size(); ++i)
+    {
+        if (!constants[i].is_string())
+        {
+            continue;
+        }
+
+        const std::string_view text = constants[i].expect_string("intern_strings").value();
+        const std::uint64_t hash = fnv1a(text);
+        const std::size_t slot = table.locate(text, hash);
+        if (table.slots_[slot] == 0)
+        {
+            table.strings_.push_back(
+                constants[i].is_shared_string() ? constants[i].as_shared_string() : SharedString(std::string(text)));
+            table.hashes_.push_back(hash);
+            table.slots_[slot] = static_cast<std::uint32_t>(table.strings_.size());
+        }
+        const std::uint32_t id = table.slots_[slot] - 1;
+        table.constant_ids_[i] = id;
+        constants[i] = Value::shared_string(table.strings_[id]);
+    }
+
+    // Cases are applied last to first so the first case listing a string wins, as in a chain of str_eq tests.
+    const std::size_t row_size = table.strings_.size() + 1;
+    table.switch_targets_.reserve(string_switches.size() * row_size);
+    for (const StringSwitch& string_switch : string_switches)
+    {
+        const std::size_t row = table.switch_targets_.size();
+        table.switch_targets_.resize(row + row_size, string_switch.default_target);
+        for (auto it = string_switch.cases.rbegin(); it != string_switch.cases.rend(); ++it)
+        {
+            const std::int64_t id = table.constant_id(it->constant);
+            if (id >= 0)
+            {
+                table.switch_targets_[row + static_cast<std::size_t>(id)] = it->target;
+            }
+        }
+    }
+    table.switch_count_ = string_switches.size();
+    table.source_fingerprint_ = intern_source_fingerprint(*this);
+
+    interned = std::move(table);
+    return interned.size();
+}
+
+auto VM::execute_intern_opcode(const Program& program, const Instruction& instruction) -> Result<Value>
+{
+    const std::string_view name = instruction.opcode == OpCode::str_intern ? "str_intern" : "str_eq_interned";
+    if (!program.interned.indexes(program))
+    {
+        return stale_table_error(name);
+    }
+
+    Result<Value> popped = pop_value();
+    if (!popped.has_value())
+    {
+        return std::unexpected(popped.error());
+    }
+
+    if (instruction.opcode == OpCode::str_intern)
+    {
+        const Result<std::string_view> text = popped->expect_string(name);
+        if (!text.has_value())
+        {
+            return std::unexpected(text.error());
+        }
+        return Value::i64(program.interned.find(text.value()));
+    }
+
+    const std::int64_t expected = program.interned.constant_id(instruction.operand);
+    if (expected < 0)
+    {
+        return make_unexpected(ErrorCode::type_mismatch, "str_eq_interned operand is not a string constant.");
+    }
+    if (popped->is_i64())
+    {
+        return Value::i64(popped->as_i64() == expected ? 1 : 0);
+    }
+
+    // An uninterned string compares bytes directly; that is cheaper than hashing it to find its id.
+    const Result<std::string_view> text = popped->expect_string(name);
+    if (!text.has_value())
+    {
+        return std::unexpected(text.error());
+    }
+    const Result<std::string_view> constant = program.constants[instruction.operand].expect_string(name);
+    if (!constant.has_value())
+    {
+        return std::unexpected(constant.error());
+    }
+    return Value::i64(text.value() == constant.value() ? 1 : 0);
+}
+
+auto VM::execute_str_switch(const Program& program, const Instruction& instruction) -> Result<std::size_t>
+{
+    if (!program.interned.indexes(program))
+    {
+        return stale_table_error("str_switch");
+    }
+    if (instruction.operand >= program.string_switches.size())
+    {
+        return make_unexpected(ErrorCode::verification_failed, "str_switch table index out of range.");
+    }
+
+    Result<Value> popped = pop_value();
+    if (!popped.has_value())
+    {
+        return std::unexpected(popped.error());
+    }
+    const Result<std::int64_t> id = resolve_intern_id(program.interned, popped.value(), "str_switch");
+    if (!id.has_value())
+    {
+        return std::unexpected(id.error());
+    }
+
+    const std::uint32_t target = program.interned.switch_target(instruction.operand, id.value());
+    if (target >= program.code.size())
+    {
+        return make_unexpected(ErrorCode::invalid_jump_target, "str_switch target out of range.");
+    }
+    return static_cast<std::size_t>(target);
+}
+} // namespace stella::vm
@@ -1,19 +1,29 @@
 module;
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <expected>
+#include <filesystem>
 #include <functional>
+#include <iterator>
+#include <limits>
 #include <memory>
 #include <memory_resource>
 #include <array>
+#include <condition_variable>
+#include <coroutine>
 #include <deque>
+#include <mutex>
+#include <new>
 #include <optional>
 #include <span>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -47,7 +57,53 @@ enum class OpCode : std::uint8_t
     or_i64 = 19,
     xor_i64 = 20,
     shl_i64 = 21,
-    shr_i64 = 22
+    shr_i64 = 22,
+    load_field_i64 = 23,
+    load_field_f64 = 24,
+    load_field_string = 25,
+    load_field_bytes = 26,
+    yield = 27,
+    // Buffer opcodes pop their operands in reverse push order with the buffer pushed first. Offsets and lengths are
+    // i64 and must lie within the buffer; find_byte and xor_const take their byte in the instruction operand.
+    buffer_len = 28,
+    buffer_slice = 29,
+    buffer_load_u8 = 30,
+    buffer_load_u32 = 31,
+    buffer_load_u64 = 32,
+    buffer_hash = 33,
+    buffer_find_byte = 34,
+    buffer_xor_const = 35,
+    // f64 opcodes follow IEEE 754 binary64 with round-to-nearest: overflow yields infinity and division by zero
+    // yields a signed infinity. Every NaN result is the canonical quiet NaN, and comparisons involving NaN push 0.
+    // fma_f64 pops c, b, a and pushes a * b + c rounded once; f64_to_i64 truncates and rejects NaN and out-of-range
+    // values with arithmetic_overflow.
+    add_f64 = 36,
+    sub_f64 = 37,
+    mul_f64 = 38,
+    div_f64 = 39,
+    fma_f64 = 40,
+    neg_f64 = 41,
+    cmp_eq_f64 = 42,
+    cmp_lt_f64 = 43,
+    i64_to_f64 = 44,
+    f64_to_i64 = 45,
+    // String opcodes work on UTF-8 bytes. str_slice views its source (borrowed strings stay borrowed, owned and shared
+    // ones share one refcounted payload); str_concat writes into the arena when arena payloads are enabled. str_eq,
+    // str_prefix and str_find push 1/0 or a byte index (-1 when absent) and never allocate.
+    str_len = 46,
+    str_eq = 47,
+    str_prefix = 48,
+    str_slice = 49,
+    str_hash = 50,
+    str_find = 51,
+    str_concat = 52,
+    // Interned-string opcodes use the dense ids Program::intern_strings assigns to distinct string constants.
+    // str_intern pops a string and pushes its id (-1 when no constant equals it). str_eq_interned compares the popped
+    // id or string against constant `operand`. str_switch pops an id or string and jumps through string switch table
+    // `operand`.
+    str_intern = 53,
+    str_eq_interned = 54,
+    str_switch = 55
 };
 
 struct Instruction final
@@ -81,7 +137,14 @@ enum class ErrorCode : std::uint8_t
     malformed_bytecode = 20,
     arithmetic_overflow = 21,
     native_reentrancy = 22,
-    bytecode_limit_exceeded = 23
+    bytecode_limit_exceeded = 23,
+    invalid_record_index = 24,
+    invalid_field_index = 25,
+    unsupported_operation = 26,
+    not_suspended = 27,
+    snapshot_mismatch = 28,
+    invalid_string_access = 29,
+    stale_intern_table = 30
 };
 
 struct Error final
@@ -95,15 +158,32 @@ using Result = std::expected<T, Error>;
 
 using VoidResult = std::expected<void, Error>;
 
+inline constexpr std::size_t buffer_pool_min_bytes = 64;
+inline constexpr std::size_t buffer_pool_max_bytes = 64 * 1024;
+
+// Blocks from the size-class pool go back to the freeing thread's cache; other blocks are plain delete[].
+struct BufferDeleter final
+{
+    static constexpr std::uint8_t unpooled = 0xFF;
+
+    std::uint8_t size_class = unpooled;
+
+    void operator()(std::byte* bytes) const noexcept;
+};
+
 struct MoveBuffer final
 {
-    std::unique_ptr<std::byte[]> data {};
+    std::unique_ptr<std::byte[], BufferDeleter> data {};
     std::size_t size = 0;
 
     MoveBuffer() = default;
+    // Zero-filled; prefer uninitialized() when every byte is about to be overwritten.
     explicit MoveBuffer(std::size_t byte_count);
     MoveBuffer(std::unique_ptr<std::byte[]> bytes, std::size_t byte_count) noexcept;
 
+    // Payloads up to buffer_pool_max_bytes are served from a thread-local size-class pool.
+    [[nodiscard]] static auto uninitialized(std::size_t byte_count) -> MoveBuffer;
+
     MoveBuffer(MoveBuffer&&) noexcept = default;
     auto operator=(MoveBuffer&&) noexcept -> MoveBuffer& = default;
 
@@ -116,6 +196,47 @@ struct MoveBuffer final
     [[nodiscard]] auto data_ptr() const noexcept -> const std::byte*;
 };
 
+// Immutable, atomically refcounted byte blob. Copies share the payload; mutation requires promoting to a
+// MoveBuffer, which steals the bytes when this is the last reference and copies them otherwise.
+class SharedBuffer final
+{
+public:
+    SharedBuffer() = default;
+    explicit SharedBuffer(MoveBuffer buffer);
+
+    [[nodiscard]] static auto copy_of(std::span<const std::byte> bytes) -> SharedBuffer;
+
+    // A view of [offset, offset + length) that shares this payload; the caller checks the range.
+    [[nodiscard]] auto slice(std::size_t offset, std::size_t length) const -> SharedBuffer;
+    [[nodiscard]] auto bytes() const noexcept -> std::span<const std::byte>;
+    [[nodiscard]] auto size() const noexcept -> std::size_t;
+    [[nodiscard]] auto use_count() const noexcept -> long;
+    [[nodiscard]] auto into_move_buffer() && -> MoveBuffer;
+
+private:
+    std::shared_ptr<MoveBuffer> payload_ {};
+    std::size_t offset_ = 0;
+    std::size_t length_ = 0;
+};
+
+// Immutable, atomically refcounted string; copying one is a refcount bump.
+class SharedString final
+{
+public:
+    SharedString() = default;
+    explicit SharedString(std::string text);
+
+    // A view of [offset, offset + length) that shares this payload; the caller checks the range.
+    [[nodiscard]] auto slice(std::size_t offset, std::size_t length) const -> SharedString;
+    [[nodiscard]] auto view() const noexcept -> std::string_view;
+    [[nodiscard]] auto use_count() const noexcept -> long;
+
+private:
+    std::shared_ptr<const std::string> text_ {};
+    std::size_t offset_ = 0;
+    std::size_t length_ = 0;
+};
+
 class Value final
 {
 public:
@@ -126,10 +247,23 @@ public:
         f64 = 2,
         borrowed_string = 3,
         owned_string = 4,
-        buffer = 5
+        buffer = 5,
+        shared_string = 6,
+        shared_buffer = 7,
+        borrowed_buffer = 8
     };
 
-    using Storage = std::variant<std::monostate, std::int64_t, double, std::string_view, std::string, MoveBuffer>;
+    // Alternative order mirrors Kind so kind() is a plain index lookup.
+    using Storage = std::variant<
+        std::monostate,
+        std::int64_t,
+        double,
+        std::string_view,
+        std::string,
+        MoveBuffer,
+        SharedString,
+        SharedBuffer,
+        std::span<const std::byte>>;
 
     Value() = default;
     explicit Value(std::int64_t integer) noexcept;
@@ -137,6 +271,9 @@ public:
     explicit Value(std::string_view borrowed_text) noexcept;
     explicit Value(std::string owned_text) noexcept;
     explicit Value(MoveBuffer buffer) noexcept;
+    explicit Value(SharedString text) noexcept;
+    explicit Value(SharedBuffer buffer) noexcept;
+    explicit Value(std::span<const std::byte> borrowed_bytes) noexcept;
 
     Value(Value&&) noexcept = default;
     auto operator=(Value&&) noexcept -> Value& = default;
@@ -148,6 +285,9 @@ public:
     [[nodiscard]] static auto borrowed_string(std::string_view borrowed_text) noexcept -> Value;
     [[nodiscard]] static auto owned_string(std::string owned_text) noexcept -> Value;
     [[nodiscard]] static auto owned_buffer(MoveBuffer buffer) noexcept -> Value;
+    [[nodiscard]] static auto shared_string(SharedString text) noexcept -> Value;
+    [[nodiscard]] static auto shared_buffer(SharedBuffer buffer) noexcept -> Value;
+    [[nodiscard]] static auto borrowed_buffer(std::span<const std::byte> borrowed_bytes) noexcept -> Value;
 
     [[nodiscard]] auto kind() const noexcept -> Kind;
     [[nodiscard]] static auto kind_name(Kind kind) noexcept -> std::string_view;
@@ -159,6 +299,10 @@ public:
     [[nodiscard]] auto is_owned_string() const noexcept -> bool;
     [[nodiscard]] auto is_string() const noexcept -> bool;
     [[nodiscard]] auto is_buffer() const noexcept -> bool;
+    [[nodiscard]] auto is_shared_string() const noexcept -> bool;
+    [[nodiscard]] auto is_shared_buffer() const noexcept -> bool;
+    [[nodiscard]] auto is_borrowed_buffer() const noexcept -> bool;
+    [[nodiscard]] auto is_bytes() const noexcept -> bool;
 
     [[nodiscard]] auto as_i64() -> std::int64_t&;
     [[nodiscard]] auto as_i64() const -> const std::int64_t&;
@@ -170,10 +314,19 @@ public:
     [[nodiscard]] auto as_owned_string() const -> const std::string&;
     [[nodiscard]] auto as_buffer() -> MoveBuffer&;
     [[nodiscard]] auto as_buffer() const -> const MoveBuffer&;
+    [[nodiscard]] auto as_shared_string() const -> const SharedString&;
+    [[nodiscard]] auto as_shared_buffer() const -> const SharedBuffer&;
+    [[nodiscard]] auto as_borrowed_buffer() const -> const std::span<const std::byte>&;
 
     [[nodiscard]] auto expect_i64(std::string_view context) const -> Result<std::int64_t>;
+    [[nodiscard]] auto expect_f64(std::string_view context) const -> Result<double>;
     [[nodiscard]] auto expect_string(std::string_view context) const -> Result<std::string_view>;
+    [[nodiscard]] auto expect_bytes(std::string_view context) const -> Result<std::span<const std::byte>>;
     [[nodiscard]] auto take_buffer() -> Result<MoveBuffer>;
+    [[nodiscard]] auto share_buffer() -> Result<SharedBuffer>;
+    // Moves an owned string or MoveBuffer into its refcounted form in place and returns a copy sharing it; every other
+    // kind is returned as a plain copy.
+    [[nodiscard]] auto share() -> Value;
 
 private:
     Storage storage_ {};
@@ -181,6 +334,15 @@ private:
 
 class Arena final
 {
+    struct DestructorRecord;
+
+    // Bump position: the block being carved and the offset of its first free byte.
+    struct Position final
+    {
+        std::size_t block = 0;
+        std::size_t offset = 0;
+    };
+
 public:
     class Marker final
     {
@@ -198,13 +360,16 @@ public:
 
     private:
         friend class Arena;
-        Marker(Arena* arena, std::size_t rewind_to) noexcept;
+        Marker(Arena* arena, DestructorRecord* rewind_to, Position position) noexcept;
 
         Arena* arena_ = nullptr;
-        std::size_t rewind_to_ = 0;
+        DestructorRecord* rewind_to_ = nullptr;
+        Position position_ {};
     };
 
-    explicit Arena(std::size_t initial_bytes = 4096);
+    explicit Arena(
+        std::size_t initial_bytes = 4096,
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
     ~Arena();
 
     Arena(const Arena&) = delete;
@@ -212,37 +377,155 @@ public:
     Arena(Arena&&) = delete;
     auto operator=(Arena&&) -> Arena& = delete;
 
+    // Rewinding a marker destroys what was created after it and hands its memory to later allocations, whatever the
+    // arena held when the marker was taken. reset() also returns every block past the initial one upstream.
     [[nodiscard]] auto mark() noexcept -> Marker;
     void reset() noexcept;
+    // Counts objects still awaiting destruction; trivially destructible allocations are never tracked.
     [[nodiscard]] auto live_allocations() const noexcept -> std::size_t;
 
+    [[nodiscard]] auto copy_string(std::string_view text) -> std::string_view;
+    [[nodiscard]] auto copy_bytes(std::span<const std::byte> bytes) -> std::span<std::byte>;
+    [[nodiscard]] auto contains(const void* address) const noexcept -> bool;
+
+    // Uninitialized storage for count objects; the arena never runs destructors on it.
+    template <typename T>
+    [[nodiscard]] auto allocate(std::size_t count) -> T*
+    {
+        if (count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(allocate_bytes(count * sizeof(T), alignof(T)));
+    }
+
     template <typename T, typename... Args>
     auto emplace(Args&&... args) -> T*
     {
-        void* memory = allocate_bytes(sizeof(T), alignof(T));
-        T* object = new (memory) T(std::forward<Args>(args)...);
-        register_destructor(object, [](void* ptr) noexcept {
-            auto* typed = static_cast<T*>(ptr);
-            typed->~T();
-        });
-        return object;
+        if constexpr (std::is_trivially_destructible_v<T>)
+        {
+            return new (allocate<T>(1)) T(std::forward<Args>(args)...);
+        }
+        else
+        {
+            // The record is carved before the object so registration itself cannot fail after construction.
+            DestructorRecord* record = allocate_destructor_record();
+            T* object = new (allocate<T>(1)) T(std::forward<Args>(args)...);
+            register_destructor(record, object, 1, &destroy_objects<T>);
+            return object;
+        }
+    }
+
+    // Value-initializes count objects, destroyed together (in reverse order) when the arena rewinds past them.
+    template <typename T>
+    auto emplace_array(std::size_t count) -> std::span<T>
+    {
+        if (count == 0)
+        {
+            return {};
+        }
+
+        DestructorRecord* record = std::is_trivially_destructible_v<T> ? nullptr : allocate_destructor_record();
+        T* objects = allocate<T>(count);
+        std::size_t constructed = 0;
+        try
+        {
+            for (; constructed < count; ++constructed)
+            {
+                new (objects + constructed) T();
+            }
+        }
+        catch (...)
+        {
+            destroy_objects<T>(objects, constructed);
+            throw;
+        }
+
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            register_destructor(record, objects, count, &destroy_objects<T>);
+        }
+        return {objects, count};
     }
 
 private:
-    void* allocate_bytes(std::size_t size, std::size_t alignment);
-    void register_destructor(void* object, void (*destroy)(void*) noexcept);
-    void rewind(std::size_t index) noexcept;
+    using DestroyFunction = void (*)(void* objects, std::size_t count) noexcept;
 
-    struct TrackedAllocation final
+    template <typename T>
+    static void destroy_objects(void* objects, std::size_t count) noexcept
+    {
+        auto* typed = static_cast<T*>(objects);
+        for (std::size_t i = count; i > 0; --i)
+        {
+            typed[i - 1].~T();
+        }
+    }
+
+    void* allocate_bytes(std::size_t size, std::size_t alignment);
+    void grow(std::size_t min_bytes);
+    void release_blocks(std::size_t keep) noexcept;
+    [[nodiscard]] auto allocate_destructor_record() -> DestructorRecord*;
+    void register_destructor(DestructorRecord* record, void* objects, std::size_t count, DestroyFunction destroy)
+        noexcept;
+    void rewind(DestructorRecord* target) noexcept;
+    void rewind(DestructorRecord* target, Position position) noexcept;
+
+    // Lives in arena memory; records form a newest-first list that rewinding pops back to a marker.
+    struct DestructorRecord final
     {
-        void* object = nullptr;
-        void (*destroy)(void*) noexcept = nullptr;
-        bool alive = false;
+        void* objects = nullptr;
+        std::size_t count = 0;
+        DestroyFunction destroy = nullptr;
+        DestructorRecord* previous = nullptr;
     };
 
-    std::vector<std::byte> initial_buffer_;
-    std::pmr::monotonic_buffer_resource resource_;
-    std::vector<TrackedAllocation> tracked_allocations_;
+    std::pmr::memory_resource* upstream_ = nullptr;
+    std::size_t initial_bytes_ = 0;
+    std::size_t next_block_bytes_ = 0;
+    // Blocks past top_ are kept after a rewind and reused before anything new is requested upstream.
+    std::vector<std::span<std::byte>> blocks_;
+    Position top_ {};
+    DestructorRecord* destructors_ = nullptr;
+    std::size_t live_objects_ = 0;
+};
+
+class Program;
+
+// Dense ids for a program's distinct string constants, so a string interned once (by the host when binding an input,
+// or by str_intern) compares against constants with one integer compare and str_switch resolves with one array
+// index. Rebuilt by Program::intern_strings; edits to the constant pool or switch tables leave it stale.
+class InternTable final
+{
+public:
+    // Returns -1 when no string constant equals `text`.
+    [[nodiscard]] auto find(std::string_view text) const noexcept -> std::int64_t;
+    // Returns -1 when the constant is not a string.
+    [[nodiscard]] auto constant_id(std::size_t constant) const noexcept -> std::int64_t;
+    [[nodiscard]] auto switch_target(std::size_t table, std::int64_t id) const noexcept -> std::uint32_t;
+    [[nodiscard]] auto size() const noexcept -> std::size_t;
+    // Compares a fingerprint of the string constants and switch tables the table was built from, so any edit to them
+    // since the last Program::intern_strings is caught. It reads every constant; the verifier checks it once per pass.
+    [[nodiscard]] auto current_for(const Program& program) const noexcept -> bool;
+    // The fingerprint of what the table was built from, or nullopt when the program no longer matches it.
+    [[nodiscard]] auto current_source(const Program& program) const noexcept -> std::optional<std::uint64_t>;
+
+private:
+    friend class Program;
+    friend class VM;
+
+    [[nodiscard]] auto locate(std::string_view text, std::uint64_t hash) const noexcept -> std::size_t;
+    // The constant and switch counts the lookups index by; the interpreter re-checks only these per instruction.
+    [[nodiscard]] auto indexes(const Program& program) const noexcept -> bool;
+
+    std::vector<SharedString> strings_;
+    std::vector<std::uint64_t> hashes_;
+    // Open addressing over a power-of-two table; entries hold id + 1 so zero marks an empty slot.
+    std::vector<std::uint32_t> slots_;
+    std::vector<std::int64_t> constant_ids_;
+    // One row of size() targets per switch table, followed by its default target.
+    std::vector<std::uint32_t> switch_targets_;
+    std::size_t switch_count_ = 0;
+    std::uint64_t source_fingerprint_ = 0;
 };
 
 class Program final
@@ -252,6 +535,27 @@ public:
     [[nodiscard]] auto add_function(std::uint32_t entry, std::uint32_t arity, std::uint32_t local_count)
         -> std::size_t;
 
+    struct StringSwitch final
+    {
+        struct Case final
+        {
+            std::uint32_t constant = 0;
+            std::uint32_t target = 0;
+
+            auto operator==(const Case&) const -> bool = default;
+        };
+
+        std::vector<Case> cases;
+        std::uint32_t default_target = 0;
+
+        auto operator==(const StringSwitch&) const -> bool = default;
+    };
+
+    [[nodiscard]] auto add_string_switch(StringSwitch table) -> std::size_t;
+    // Assigns intern ids, points equal string constants at one shared payload and builds the switch dispatch rows.
+    // deserialize_program calls it; hand-built programs call it once their constants and switches are final.
+    auto intern_strings() -> std::size_t;
+
     std::vector<Instruction> code;
     std::vector<Value> constants;
 
@@ -263,14 +567,117 @@ public:
     };
 
     std::vector<Function> functions;
+    std::vector<StringSwitch> string_switches;
+    InternTable interned;
 };
 
 inline constexpr std::uint32_t bytecode_magic = 0x5354564DU;
-inline constexpr std::uint16_t bytecode_version = 1;
+// Version 2 appends the string switch tables; version 1 payloads still load.
+inline constexpr std::uint16_t bytecode_version = 2;
 
 [[nodiscard]] auto serialize_program(const Program& program) -> Result<MoveBuffer>;
 [[nodiscard]] auto deserialize_program(std::span<const std::byte> bytes) -> Result<Program>;
 
+struct CodeRange final
+{
+    std::size_t begin = 0;
+    std::size_t end = 0;
+};
+
+// Edits applied to a previously verified program: whole function bodies and/or raw instruction ranges.
+struct ProgramChanges final
+{
+    std::vector<std::uint32_t> functions {};
+    std::vector<CodeRange> code_ranges {};
+};
+
+class RecordSchema;
+
+// What a successful verification established about a program, kept so a patched version can be re-verified
+// region by region instead of from scratch.
+class VerificationState final
+{
+public:
+    [[nodiscard]] auto reverified_regions() const noexcept -> std::size_t;
+
+private:
+    friend class VM;
+
+    std::size_t available_inputs_ = 0;
+    std::size_t code_size_ = 0;
+    std::size_t constant_count_ = 0;
+    std::vector<std::size_t> native_arities_;
+    std::vector<const RecordSchema*> record_schemas_;
+    std::vector<Program::Function> functions_;
+    std::vector<Program::StringSwitch> string_switches_;
+    std::vector<bool> top_level_reach_;
+    // What the intern table was built from when it was current; untouched regions' interned opcodes rely on it.
+    std::optional<std::uint64_t> interned_source_;
+    // Index 0 is top-level code and index i + 1 is function i; each list holds the sorted distinct callees.
+    std::vector<std::vector<std::uint32_t>> callees_;
+    // Per function whose control flow leaves its region, every pc its walk reached as sorted disjoint ranges.
+    std::vector<std::vector<CodeRange>> escaped_reach_;
+    std::size_t reverified_regions_ = 0;
+};
+
+class Executor
+{
+public:
+    virtual ~Executor() = default;
+
+    // Tasks must not throw; they report failure through the state they complete, as the VM's own tasks do. A task
+    // that throws anyway ends the process on a ThreadPool worker and propagates out of ManualExecutor::run_pending.
+    virtual void execute(std::move_only_function<void()> task) = 0;
+    [[nodiscard]] virtual auto concurrency() const noexcept -> std::size_t = 0;
+};
+
+class ThreadPool final : public Executor
+{
+public:
+    explicit ThreadPool(std::size_t thread_count = std::thread::hardware_concurrency());
+    ~ThreadPool() override;
+
+    ThreadPool(const ThreadPool&) = delete;
+    auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    auto operator=(ThreadPool&&) -> ThreadPool& = delete;
+
+    void execute(std::move_only_function<void()> task) override;
+    [[nodiscard]] auto concurrency() const noexcept -> std::size_t override;
+
+private:
+    void worker_loop(std::stop_token stop);
+
+    std::mutex mutex_;
+    std::condition_variable_any tasks_available_;
+    std::deque<std::move_only_function<void()>> tasks_;
+    std::vector<std::jthread> workers_;
+};
+
+// Queues tasks until the owning thread drains them, so a single-threaded host loop can drive run_async and async
+// native completions. execute() may be called from any thread.
+class ManualExecutor final : public Executor
+{
+public:
+    ManualExecutor() = default;
+
+    ManualExecutor(const ManualExecutor&) = delete;
+    auto operator=(const ManualExecutor&) -> ManualExecutor& = delete;
+    ManualExecutor(ManualExecutor&&) = delete;
+    auto operator=(ManualExecutor&&) -> ManualExecutor& = delete;
+
+    void execute(std::move_only_function<void()> task) override;
+    [[nodiscard]] auto concurrency() const noexcept -> std::size_t override;
+
+    // Runs queued tasks, including ones they enqueue, until the queue is empty; returns how many ran. A throwing task
+    // is dropped from the queue and its exception propagates to the caller, leaving later tasks queued.
+    auto run_pending() -> std::size_t;
+
+private:
+    std::mutex mutex_;
+    std::deque<std::move_only_function<void()>> tasks_;
+};
+
 struct TraceEvent final
 {
     std::size_t pc = 0;
@@ -279,6 +686,71 @@ struct TraceEvent final
     std::size_t call_depth = 0;
 };
 
+class PendingValueAwaiter;
+
+// The eventual result of an async native call. Copies share one completion; the producer calls complete() once from
+// any thread, and consumers poll, block, register a continuation or co_await it.
+class PendingValue final
+{
+public:
+    PendingValue() = default;
+
+    [[nodiscard]] static auto create() -> PendingValue;
+    [[nodiscard]] static auto completed(Result<Value> result) -> PendingValue;
+
+    // Later completions of an already completed handle are ignored.
+    void complete(Result<Value> result) const;
+    [[nodiscard]] explicit operator bool() const noexcept;
+    [[nodiscard]] auto ready() const -> bool;
+    void wait() const;
+    // Moves the result out of a completed handle; a second take sees a moved-from value.
+    [[nodiscard]] auto take() const -> Result<Value>;
+    // At most one continuation; it runs on the completing thread, or immediately if the handle is already complete.
+    void on_ready(std::move_only_function<void()> continuation) const;
+    [[nodiscard]] auto operator co_await() const noexcept -> PendingValueAwaiter;
+
+private:
+    struct State;
+
+    std::shared_ptr<State> state_;
+};
+
+class PendingValueAwaiter final
+{
+public:
+    explicit PendingValueAwaiter(PendingValue pending) noexcept;
+
+    [[nodiscard]] auto await_ready() const -> bool;
+    void await_suspend(std::coroutine_handle<> continuation) const;
+    [[nodiscard]] auto await_resume() const -> Result<Value>;
+
+private:
+    PendingValue pending_;
+};
+
+// Runs blocking work on the executor and completes the returned handle with its result. Like a native, `work` reports
+// failure through its Result; it runs as an executor task and must not throw.
+[[nodiscard]] auto offload_native(Executor& executor, std::move_only_function<Result<Value>()> work) -> PendingValue;
+
+enum class RunStatus : std::uint8_t
+{
+    completed = 0,
+    suspended = 1,
+    awaiting_native = 2,
+    yielded = 3
+};
+
+// Only a completed slice carries a value; an awaiting slice carries the async native call it is parked on. Either way
+// the VM keeps its pc, stack and call frames until resume() or the next run.
+struct RunSlice final
+{
+    RunStatus status = RunStatus::completed;
+    Value value;
+    PendingValue pending;
+    // Steps the slice executed; a yield can end it well before the budget.
+    std::size_t steps = 0;
+};
+
 struct ProfileStats final
 {
     std::uint64_t runs = 0;
@@ -286,10 +758,22 @@ struct ProfileStats final
     std::uint64_t total_run_nanoseconds = 0;
     std::array<std::uint64_t, 256> opcode_counts {};
     std::array<std::uint64_t, 256> opcode_nanoseconds {};
+    std::uint64_t result_cache_hits = 0;
+    std::uint64_t result_cache_misses = 0;
+    // run_memoized calls that skipped the cache: impure program, no cache attached or uncacheable values.
+    std::uint64_t result_cache_bypasses = 0;
 };
 
 class VM;
+class ResultCache;
+class RunAwaitable;
+class StepSequence;
 using NativeFunction = std::move_only_function<Result<Value>(VM&, std::span<Value>)>;
+// Arguments are only valid during the call; anything the pending work needs must be copied out first.
+using AsyncNativeFunction = std::move_only_function<PendingValue(VM&, std::span<Value>)>;
+// args[i] holds argument i for every row of the batch; results has one slot per row.
+using BatchNativeFunction =
+    std::move_only_function<VoidResult(std::span<const std::span<const std::int64_t>>, std::span<std::int64_t>)>;
 
 namespace native_detail
 {
@@ -371,14 +855,7 @@ auto decode_arg(Value& value, std::string_view context) -> Result<std::remove_cv
     }
     else if constexpr (std::is_same_v<T, double>)
     {
-        if (!value.is_f64())
-        {
-            return std::unexpected(Error {
-                ErrorCode::type_mismatch,
-                std::string(context) + " expected f64 but got " + std::string(Value::kind_name(value.kind())) + ".",
-            });
-        }
-        return value.as_f64();
+        return value.expect_f64(context);
     }
     else if constexpr (std::is_same_v<T, std::string_view>)
     {
@@ -397,6 +874,14 @@ auto decode_arg(Value& value, std::string_view context) -> Result<std::remove_cv
     {
         return value.take_buffer();
     }
+    else if constexpr (std::is_same_v<T, SharedBuffer>)
+    {
+        return value.share_buffer();
+    }
+    else if constexpr (std::is_same_v<T, std::span<const std::byte>>)
+    {
+        return value.expect_bytes(context);
+    }
     else if constexpr (std::is_same_v<T, Value>)
     {
         return value;
@@ -439,6 +924,14 @@ auto encode_return(Ret&& value) -> Result<Value>
     {
         return Value::owned_buffer(std::move(value));
     }
+    else if constexpr (std::is_same_v<T, SharedBuffer>)
+    {
+        return Value::shared_buffer(std::move(value));
+    }
+    else if constexpr (std::is_same_v<T, SharedString>)
+    {
+        return Value::shared_string(std::move(value));
+    }
     else if constexpr (std::is_void_v<T>)
     {
         return Value {};
@@ -455,6 +948,185 @@ struct NativeBinding final
     std::string name;
     std::size_t arity = 0;
     NativeFunction function;
+    // Pure natives depend only on their arguments and have no side effects, so results of programs calling only
+    // pure natives may be memoized.
+    bool pure = false;
+    // Set for async bindings; function then blocks on the pending result for callers that cannot park.
+    AsyncNativeFunction async_function;
+    // Set for batch bindings; function then runs the batch form over a single row.
+    BatchNativeFunction batch_function;
+};
+
+struct NativeSignature final
+{
+    std::string_view name;
+    std::size_t arity = 0;
+};
+
+// Host memory an input slot reads on every push_input instead of a Value moved in ahead of the run. Views are not
+// consumed, so repeated runs over the same (possibly mutated) record need no re-binding. The referenced storage must
+// outlive every run that reads it.
+class InputView final
+{
+public:
+    InputView() = default;
+    explicit InputView(const std::int64_t& integer) noexcept;
+    explicit InputView(const double& floating_point) noexcept;
+    explicit InputView(const std::string_view& text) noexcept;
+    explicit InputView(const std::string& text) noexcept;
+    explicit InputView(const std::span<const std::byte>& bytes) noexcept;
+    template <typename T>
+    InputView(const T&&) = delete;
+
+    // Fixed byte range; unlike the span-reference overload, later reassignments of the host span are not observed.
+    [[nodiscard]] static auto bytes(std::span<const std::byte> bytes) noexcept -> InputView;
+
+    [[nodiscard]] auto bound() const noexcept -> bool;
+    [[nodiscard]] auto read() const noexcept -> Value;
+
+private:
+    using Source = std::variant<
+        std::monostate,
+        const std::int64_t*,
+        const double*,
+        const std::string_view*,
+        const std::string*,
+        const std::span<const std::byte>*,
+        std::span<const std::byte>>;
+
+    Source source_ {};
+};
+
+enum class FieldType : std::uint8_t
+{
+    i64 = 0,
+    f64 = 1,
+    string = 2,
+    bytes = 3
+};
+
+namespace record_detail
+{
+template <typename T>
+struct MemberPointerTraits;
+
+template <typename Record, typename Field>
+struct MemberPointerTraits<Field Record::*>
+{
+    using RecordType = Record;
+    using FieldType = Field;
+};
+
+// Only the address matters: it identifies the host record type a schema was declared for.
+template <typename Record>
+inline constexpr char record_type_tag = 0;
+
+template <typename Field>
+consteval auto field_type_of() -> FieldType
+{
+    if constexpr (std::is_same_v<Field, std::int64_t>)
+    {
+        return FieldType::i64;
+    }
+    else if constexpr (std::is_same_v<Field, double>)
+    {
+        return FieldType::f64;
+    }
+    else if constexpr (std::is_same_v<Field, std::string_view> || std::is_same_v<Field, std::string>)
+    {
+        return FieldType::string;
+    }
+    else
+    {
+        static_assert(std::is_same_v<Field, std::span<const std::byte>>, "Unsupported record field type.");
+        return FieldType::bytes;
+    }
+}
+} // namespace record_detail
+
+struct RecordField final
+{
+    std::string_view name;
+    FieldType type = FieldType::i64;
+    bool owned_string = false;
+    const void* record_tag = nullptr;
+    const void* (*address)(const void* record) noexcept = nullptr;
+};
+
+template <auto Member>
+[[nodiscard]] auto record_field(std::string_view name) noexcept -> RecordField
+{
+    using Traits = record_detail::MemberPointerTraits<decltype(Member)>;
+    using Record = typename Traits::RecordType;
+    using Field = typename Traits::FieldType;
+
+    return RecordField {
+        .name = name,
+        .type = record_detail::field_type_of<Field>(),
+        .owned_string = std::is_same_v<Field, std::string>,
+        .record_tag = &record_detail::record_type_tag<Record>,
+        .address = [](const void* record) noexcept -> const void* {
+            return &(static_cast<const Record*>(record)->*Member);
+        },
+    };
+}
+
+inline constexpr std::uint32_t record_field_operand_bits = 16;
+inline constexpr std::uint32_t max_record_fields = 1U << record_field_operand_bits;
+
+// load_field_* operands pack the bound record slot above the field index.
+[[nodiscard]] constexpr auto field_operand(std::uint32_t record_slot, std::uint32_t field_index) noexcept
+    -> std::uint32_t
+{
+    return (record_slot << record_field_operand_bits) | (field_index & (max_record_fields - 1U));
+}
+
+// Typed field layout of a host struct, declared once with record_field<&Record::member>("name") entries.
+class RecordSchema final
+{
+public:
+    template <typename Record>
+    [[nodiscard]] static auto of(std::vector<RecordField> fields) -> Result<RecordSchema>
+    {
+        return make(&record_detail::record_type_tag<Record>, std::move(fields));
+    }
+
+    [[nodiscard]] auto fields() const noexcept -> std::span<const RecordField>;
+    [[nodiscard]] auto find(std::string_view name) const noexcept -> std::optional<std::uint32_t>;
+    [[nodiscard]] auto record_tag() const noexcept -> const void*;
+
+private:
+    [[nodiscard]] static auto make(const void* record_tag, std::vector<RecordField> fields) -> Result<RecordSchema>;
+
+    const void* record_tag_ = nullptr;
+    std::vector<RecordField> fields_ {};
+};
+
+struct RecordBinding final
+{
+    const RecordSchema* schema = nullptr;
+    const void* record = nullptr;
+};
+
+inline constexpr std::size_t column_vector_rows = 1024;
+
+// A verified program lowered for vector-at-a-time evaluation over i64 input columns. Each stack slot becomes a column
+// register indexed by its verifier depth, so every opcode runs as one loop over up to column_vector_rows rows and
+// jump_if_true splits a selection vector instead of branching per row.
+class ColumnarProgram final
+{
+public:
+    [[nodiscard]] auto input_columns() const noexcept -> std::size_t;
+    [[nodiscard]] auto max_stack_depth() const noexcept -> std::size_t;
+
+private:
+    friend class VM;
+
+    std::vector<Instruction> code_ {};
+    std::vector<std::int64_t> constants_ {};
+    std::vector<std::uint32_t> depth_at_pc_ {};
+    std::size_t input_columns_ = 0;
+    std::size_t max_stack_depth_ = 0;
 };
 
 class NativeBindingBuilder;
@@ -462,21 +1134,100 @@ class NativeBindingBuilder;
 class VM final
 {
 public:
-    explicit VM(std::size_t stack_reserve = 64, std::size_t arena_bytes = 4096);
+    // The resource backs the value stack, inputs, call frames and the arena's blocks; buffer payloads use the pool.
+    explicit VM(
+        std::size_t stack_reserve = 64,
+        std::size_t arena_bytes = 4096,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
-    [[nodiscard]] auto bind_native(std::string name, std::size_t arity, NativeFunction function)
+    [[nodiscard]] auto bind_native(std::string name, std::size_t arity, NativeFunction function, bool pure = false)
         -> std::size_t;
     [[nodiscard]] auto native(std::string name) -> NativeBindingBuilder;
+    // Resumable runs park at call_native until the pending value completes; run and run_columns wait for it.
+    [[nodiscard]] auto bind_async_native(std::string name, std::size_t arity, AsyncNativeFunction function)
+        -> std::size_t;
+    // run_columns hands batch natives one call per selected row group; every other path calls them row by row.
+    [[nodiscard]] auto bind_batch_native(
+        std::string name,
+        std::size_t arity,
+        BatchNativeFunction function,
+        bool pure = false) -> std::size_t;
+    [[nodiscard]] auto native_signatures() const -> std::vector<NativeSignature>;
     [[nodiscard]] auto push_input(Value value) -> std::size_t;
+    [[nodiscard]] auto bind_input(InputView view) -> std::size_t;
+    // Binds one slot per element and returns the first slot index.
+    [[nodiscard]] auto bind_inputs(std::span<const std::int64_t> integers) -> std::size_t;
+    [[nodiscard]] auto rebind_input(std::size_t index, InputView view) -> VoidResult;
+
+    // The schema and the record are referenced, not copied; both must outlive every run that reads the slot.
+    template <typename Record>
+    [[nodiscard]] auto bind_record(const RecordSchema& schema, const Record& record) -> Result<std::size_t>
+    {
+        if (schema.record_tag() != &record_detail::record_type_tag<Record>)
+        {
+            return std::unexpected(Error {
+                ErrorCode::type_mismatch,
+                "bind_record schema was declared for another type.",
+            });
+        }
+        records_.push_back({&schema, &record});
+        return records_.size() - 1;
+    }
+
+    // Points an existing slot at another record of the same type, e.g. the next row of a batch.
+    template <typename Record>
+    [[nodiscard]] auto rebind_record(std::size_t slot, const Record& record) -> VoidResult
+    {
+        if (slot >= records_.size())
+        {
+            return std::unexpected(Error {ErrorCode::invalid_record_index, "rebind_record slot out of range."});
+        }
+        if (records_[slot].schema->record_tag() != &record_detail::record_type_tag<Record>)
+        {
+            return std::unexpected(Error {
+                ErrorCode::type_mismatch,
+                "rebind_record record type does not match schema.",
+            });
+        }
+        records_[slot].record = &record;
+        return {};
+    }
+
+    template <typename Record>
+    auto bind_record(const RecordSchema& schema, const Record&& record) -> Result<std::size_t> = delete;
+    template <typename Record>
+    auto rebind_record(std::size_t slot, const Record&& record) -> VoidResult = delete;
+
+    void clear_records();
+    [[nodiscard]] auto record_bindings() const noexcept -> std::span<const RecordBinding>;
+
+    // Binds the named members of a host record to consecutive slots and returns the first slot index.
+    template <typename Record, typename... Fields>
+    [[nodiscard]] auto bind_record_inputs(const Record& record, Fields Record::*... fields) -> std::size_t
+    {
+        const std::size_t first = inputs_.size();
+        ((void)bind_input(InputView(record.*fields)), ...);
+        return first;
+    }
 
     void clear_inputs();
     void clear_stack();
+    // Drops per-request state (stack, inputs, call frames, arena contents, profile) but keeps capacity, native
+    // bindings and configuration such as the step budget and trace sink.
+    void reset() noexcept;
 
     [[nodiscard]] auto stack() noexcept -> std::span<Value>;
     [[nodiscard]] auto stack() const noexcept -> std::span<const Value>;
     [[nodiscard]] auto arena() noexcept -> Arena&;
     [[nodiscard]] auto arena() const noexcept -> const Arena&;
+    // When enabled, transient_string/transient_buffer carve payloads from the arena, which each run rewinds on exit;
+    // a result that still points into the arena is promoted to an owned heap Value before it is returned.
+    void set_arena_payloads_enabled(bool enabled) noexcept;
+    [[nodiscard]] auto arena_payloads_enabled() const noexcept -> bool;
+    [[nodiscard]] auto transient_string(std::string_view text) -> Value;
+    [[nodiscard]] auto transient_buffer(std::span<const std::byte> bytes) -> Value;
     void set_step_budget(std::size_t max_steps) noexcept;
+    [[nodiscard]] auto step_budget() const noexcept -> std::size_t;
     void clear_step_budget() noexcept;
     void set_trace_sink(std::move_only_function<void(const TraceEvent&)> trace_sink);
     void clear_trace_sink();
@@ -486,10 +1237,69 @@ public:
     [[nodiscard]] auto profile() const noexcept -> const ProfileStats&;
 
     [[nodiscard]] auto verify(const Program& program, std::size_t available_inputs) const -> VoidResult;
+    [[nodiscard]] auto verify_parallel(const Program& program, std::size_t available_inputs, Executor& executor) const
+        -> VoidResult;
+    [[nodiscard]] auto verify_with_state(const Program& program, std::size_t available_inputs) const
+        -> Result<VerificationState>;
+    // Takes the base state by value so callers can move it in; pass a copy to keep it across a rejected patch.
+    [[nodiscard]] auto verify_incremental(
+        const Program& patched,
+        VerificationState base,
+        const ProgramChanges& changes) const -> Result<VerificationState>;
     [[nodiscard]] auto run(const Program& program) -> Result<Value>;
     [[nodiscard]] auto run_unchecked(const Program& program) -> Result<Value>;
+    // The cache must outlive its attachment; pass nullptr to detach.
+    void set_result_cache(ResultCache* cache) noexcept;
+    // Like run, but consults the attached result cache keyed by program_id and the current input values. Only
+    // programs whose natives are all pure and that read no host records are memoized; others simply run.
+    [[nodiscard]] auto run_memoized(const Program& program, std::uint64_t program_id) -> Result<Value>;
+    // Like run, but an exhausted step budget suspends instead of failing. The program must outlive the suspension;
+    // resume() continues it with a fresh budget, and any other run or reset() abandons it.
+    [[nodiscard]] auto run_resumable(const Program& program) -> Result<RunSlice>;
+    [[nodiscard]] auto resume() -> Result<RunSlice>;
+    [[nodiscard]] auto suspended() const noexcept -> bool;
+    // Coroutine surfaces over run_resumable/resume. The VM and program must outlive the returned object.
+    [[nodiscard]] auto run_async(const Program& program, Executor& executor) -> RunAwaitable;
+    [[nodiscard]] auto steps(const Program& program) -> StepSequence;
+    // Captures a suspended run (pc, stack, call frames and input values) as a self-contained, relocatable blob.
+    // Arena-backed and borrowed payloads are copied by content; input views are captured as the values they read.
+    [[nodiscard]] auto snapshot() const -> Result<MoveBuffer>;
+    // Rebuilds a suspended run from snapshot() output. The program and native signatures must match the ones the
+    // snapshot was taken with; resume() then continues it.
+    [[nodiscard]] auto restore(const Program& program, std::span<const std::byte> snapshot) -> VoidResult;
+    // Clones this suspended run into target, which must carry the same native signatures. Strings and buffers on the
+    // stack and in the inputs become shared, so both runs read one payload until either side takes ownership.
+    [[nodiscard]] auto fork(VM& target) -> VoidResult;
+
+    // Evaluates every call_native whose binding is pure and whose arguments are all pushed by push_constant in the
+    // same basic block, replacing the sequence with a push_constant of the result; jumps and function entries are
+    // remapped. The natives run on this VM, so its bindings must match the ones the program will run against. Shaped
+    // to serve as a ProgramCache PrepareFunction.
+    [[nodiscard]] auto fold_pure_natives(Program program) -> Result<Program>;
+
+    // Lowers top-level i64 code: constants, inputs, i64 arithmetic and comparisons, dup, pop, jumps, halt, yield (a
+    // no-op) and call_native (once per selected row, or once per row group for batch natives). Functions, locals,
+    // record fields and non-i64 constants are rejected.
+    [[nodiscard]] auto compile_columnar(const Program& program, std::size_t input_columns) const
+        -> Result<ColumnarProgram>;
+    // Evaluates results.size() rows; column i feeds push_input i and must hold at least that many rows.
+    [[nodiscard]] auto run_columns(
+        const ColumnarProgram& program,
+        std::span<const std::span<const std::int64_t>> columns,
+        std::span<std::int64_t> results) -> VoidResult;
 
 private:
+    [[nodiscard]] auto reverify_regions(
+        const Program& program,
+        VerificationState& state,
+        std::span<const std::size_t> ranks) const -> VoidResult;
+    [[nodiscard]] auto execute_program(const Program& program) -> Result<Value>;
+    [[nodiscard]] auto execute_from(const Program& program, std::size_t start_pc, bool suspend_on_budget)
+        -> Result<Value>;
+    [[nodiscard]] auto finish_slice(Result<Value> result) -> Result<RunSlice>;
+    [[nodiscard]] auto promote_arena_result(Result<Value> result) -> Result<Value>;
+    [[nodiscard]] static auto apply_binary_i64(OpCode opcode, std::int64_t lhs, std::int64_t rhs)
+        -> Result<std::int64_t>;
     [[nodiscard]] auto pop_value() -> Result<Value>;
     [[nodiscard]] auto execute_add_i64() -> Result<Value>;
     [[nodiscard]] auto execute_sub_i64() -> Result<Value>;
@@ -503,10 +1313,22 @@ private:
     [[nodiscard]] auto execute_shl_i64() -> Result<Value>;
     [[nodiscard]] auto execute_shr_i64() -> Result<Value>;
     [[nodiscard]] auto execute_call_native(std::size_t binding_index) -> Result<Value>;
+    [[nodiscard]] auto execute_buffer_opcode(const Instruction& instruction) -> Result<Value>;
+    [[nodiscard]] auto execute_f64_opcode(const Instruction& instruction) -> Result<Value>;
+    [[nodiscard]] auto execute_string_opcode(const Instruction& instruction) -> Result<Value>;
+    [[nodiscard]] auto execute_intern_opcode(const Program& program, const Instruction& instruction) -> Result<Value>;
+    [[nodiscard]] auto execute_str_switch(const Program& program, const Instruction& instruction)
+        -> Result<std::size_t>;
+    [[nodiscard]] auto execute_batch_native(
+        std::size_t binding_index,
+        std::span<const std::span<const std::int64_t>> args,
+        std::span<std::int64_t> results) -> VoidResult;
 
     Arena arena_;
-    std::vector<Value> stack_;
-    std::vector<Value> inputs_;
+    std::pmr::vector<Value> stack_;
+    std::pmr::vector<Value> inputs_;
+    std::pmr::vector<InputView> input_views_;
+    std::pmr::vector<RecordBinding> records_;
     std::deque<NativeBinding> native_bindings_;
 
     struct CallFrame final
@@ -516,13 +1338,93 @@ private:
         std::size_t local_count = 0;
     };
 
-    std::vector<CallFrame> call_frames_;
+    std::pmr::vector<CallFrame> call_frames_;
     std::size_t step_budget_ = 0;
     std::move_only_function<void(const TraceEvent&)> trace_sink_;
     std::uint64_t native_bindings_generation_ = 0;
     std::size_t native_dispatch_depth_ = 0;
     bool profiling_enabled_ = false;
+    bool arena_payloads_enabled_ = false;
     ProfileStats profile_stats_ {};
+    const Program* suspended_program_ = nullptr;
+    std::size_t suspended_pc_ = 0;
+    Arena::Marker suspended_scope_;
+    bool suspended_scope_active_ = false;
+    bool parking_enabled_ = false;
+    bool yielded_ = false;
+    std::size_t slice_steps_ = 0;
+    PendingValue awaiting_native_;
+    ResultCache* result_cache_ = nullptr;
+};
+
+// co_await vm.run_async(program, executor) runs the program one slice per executor task. Budget exhaustion and the
+// yield opcode post the next slice behind other queued work; an async native posts it once its value completes. The
+// awaiting coroutine resumes on the executor thread that finishes the run.
+class RunAwaitable final
+{
+public:
+    RunAwaitable(VM& vm, const Program& program, Executor& executor) noexcept;
+
+    RunAwaitable(const RunAwaitable&) = delete;
+    auto operator=(const RunAwaitable&) -> RunAwaitable& = delete;
+
+    [[nodiscard]] auto await_ready() const noexcept -> bool;
+    void await_suspend(std::coroutine_handle<> continuation);
+    [[nodiscard]] auto await_resume() -> Result<Value>;
+
+private:
+    void advance(Result<RunSlice> slice);
+
+    VM* vm_ = nullptr;
+    const Program* program_ = nullptr;
+    Executor* executor_ = nullptr;
+    std::coroutine_handle<> continuation_ {};
+    Result<Value> result_ = Value {};
+};
+
+// Cooperative stepping: each element is one slice of a resumable run, ending with the completed or failed slice.
+// Advancing past an awaiting_native slice before its pending value completes yields the same parked slice again.
+class StepSequence final
+{
+public:
+    class Iterator final
+    {
+    public:
+        using value_type = Result<RunSlice>;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+        explicit Iterator(StepSequence* sequence) noexcept;
+
+        [[nodiscard]] auto operator*() const -> Result<RunSlice>&;
+        auto operator++() -> Iterator&;
+        void operator++(int);
+        [[nodiscard]] friend auto operator==(const Iterator& iterator, std::default_sentinel_t) noexcept -> bool
+        {
+            return iterator.at_end();
+        }
+
+    private:
+        [[nodiscard]] auto at_end() const noexcept -> bool;
+
+        StepSequence* sequence_ = nullptr;
+    };
+
+    StepSequence(VM& vm, const Program& program) noexcept;
+
+    StepSequence(const StepSequence&) = delete;
+    auto operator=(const StepSequence&) -> StepSequence& = delete;
+
+    [[nodiscard]] auto begin() -> Iterator;
+    [[nodiscard]] auto end() const noexcept -> std::default_sentinel_t;
+
+private:
+    void advance();
+
+    VM* vm_ = nullptr;
+    const Program* program_ = nullptr;
+    std::optional<Result<RunSlice>> current_;
+    bool started_ = false;
 };
 
 class NativeBindingBuilder final
@@ -531,6 +1433,7 @@ public:
     NativeBindingBuilder(VM& vm, std::string name);
 
     auto arity(std::size_t expected_arity) -> NativeBindingBuilder&;
+    auto pure(bool is_pure = true) -> NativeBindingBuilder&;
 
     template <typename Fn>
     auto bind(Fn function) -> std::size_t
@@ -558,7 +1461,7 @@ public:
                         " but inferred " + std::to_string(inferred_arity) + ".",
                 });
             };
-            return vm_->bind_native(std::move(name_), declared_arity, std::move(mismatch));
+            return vm_->bind_native(std::move(name_), declared_arity, std::move(mismatch), pure_);
         }
 
         const std::size_t final_arity = explicit_arity_.value_or(script_arity);
@@ -623,12 +1526,480 @@ public:
             }
         };
 
-        return vm_->bind_native(std::move(name_), final_arity, std::move(wrapped));
+        return vm_->bind_native(std::move(name_), final_arity, std::move(wrapped), pure_);
+    }
+
+    // Fn takes one std::span<const std::int64_t> per script argument followed by the std::span<std::int64_t> of
+    // results, and returns void or VoidResult.
+    template <typename Fn>
+    auto bind_batch(Fn function) -> std::size_t
+    {
+        using Traits = native_detail::CallableTraits<Fn>;
+        using ArgsTuple = typename Traits::ArgsTuple;
+
+        static_assert(!Traits::has_vm_first, "Batch natives do not receive the VM.");
+        static_assert(Traits::arity >= 1, "Batch natives take a results span.");
+        constexpr std::size_t script_arity = Traits::arity - 1;
+        static_assert(
+            std::is_same_v<std::remove_cvref_t<std::tuple_element_t<script_arity, ArgsTuple>>, std::span<std::int64_t>>,
+            "The last batch native parameter must be std::span<std::int64_t>.");
+        static_assert(
+            []<std::size_t... I>(std::index_sequence<I...>) {
+                return (std::is_same_v<
+                            std::remove_cvref_t<std::tuple_element_t<I, ArgsTuple>>,
+                            std::span<const std::int64_t>> &&
+                        ...);
+            }(std::make_index_sequence<script_arity> {}),
+            "Batch native arguments must be std::span<const std::int64_t>.");
+
+        if (explicit_arity_.has_value() && explicit_arity_.value() != script_arity)
+        {
+            const std::size_t declared_arity = explicit_arity_.value();
+            BatchNativeFunction mismatch = [binding_name = name_, declared_arity, inferred_arity = script_arity](
+                                               std::span<const std::span<const std::int64_t>>,
+                                               std::span<std::int64_t>) -> VoidResult {
+                return std::unexpected(Error {
+                    ErrorCode::invalid_function_signature,
+                    "native binding '" + binding_name + "' declared arity " + std::to_string(declared_arity) +
+                        " but inferred " + std::to_string(inferred_arity) + ".",
+                });
+            };
+            return vm_->bind_batch_native(std::move(name_), declared_arity, std::move(mismatch), pure_);
+        }
+
+        BatchNativeFunction wrapped = [fn = std::move(function)](
+                                          std::span<const std::span<const std::int64_t>> args,
+                                          std::span<std::int64_t> results) mutable -> VoidResult {
+            return [&]<std::size_t... I>(std::index_sequence<I...>) -> VoidResult {
+                if constexpr (std::is_void_v<typename Traits::Return>)
+                {
+                    fn(args[I]..., results);
+                    return {};
+                }
+                else
+                {
+                    return fn(args[I]..., results);
+                }
+            }(std::make_index_sequence<Traits::arity - 1> {});
+        };
+        return vm_->bind_batch_native(std::move(name_), script_arity, std::move(wrapped), pure_);
     }
 
 private:
     VM* vm_ = nullptr;
     std::string name_ {};
     std::optional<std::size_t> explicit_arity_ {};
+    bool pure_ = false;
+};
+
+struct ResultCacheStats final
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t insertions = 0;
+    std::uint64_t evictions = 0;
+};
+
+// Bounded memo table from (program id, input values) to a program result, shared by any number of VMs. Entries are
+// spread over independently locked shards; a full shard evicts with the CLOCK second-chance policy. Only empty, i64,
+// f64, string and byte values are cached, and entries whose payloads exceed max_payload_bytes are never stored.
+class ResultCache final
+{
+public:
+    explicit ResultCache(
+        std::size_t max_entries = 4096,
+        std::size_t shard_count = 16,
+        std::size_t max_payload_bytes = 4096);
+
+    ResultCache(const ResultCache&) = delete;
+    auto operator=(const ResultCache&) -> ResultCache& = delete;
+    ResultCache(ResultCache&&) = delete;
+    auto operator=(ResultCache&&) -> ResultCache& = delete;
+
+    [[nodiscard]] auto lookup(std::uint64_t program_id, std::span<const Value> inputs) -> std::optional<Value>;
+    // Returns false when a value cannot be cached; the table is left unchanged.
+    auto insert(std::uint64_t program_id, std::span<const Value> inputs, const Value& result) -> bool;
+    void clear();
+    [[nodiscard]] auto size() const -> std::size_t;
+    [[nodiscard]] auto stats() const noexcept -> ResultCacheStats;
+
+private:
+    struct Entry final
+    {
+        std::uint64_t hash = 0;
+        std::uint64_t program_id = 0;
+        std::vector<Value> inputs;
+        Value result;
+        bool referenced = false;
+    };
+
+    struct Shard final
+    {
+        mutable std::mutex mutex;
+        std::vector<Entry> slots;
+        std::unordered_map<std::uint64_t, std::size_t> index;
+        std::size_t capacity = 0;
+        std::size_t hand = 0;
+    };
+
+    [[nodiscard]] auto shard_for(std::uint64_t hash) noexcept -> Shard&;
+
+    std::unique_ptr<Shard[]> shards_;
+    std::size_t shard_count_ = 0;
+    std::size_t max_payload_bytes_ = 0;
+    std::atomic<std::uint64_t> hits_ {0};
+    std::atomic<std::uint64_t> misses_ {0};
+    std::atomic<std::uint64_t> insertions_ {0};
+    std::atomic<std::uint64_t> evictions_ {0};
+};
+
+// Versioned store of verified programs. Readers pin the current version with two atomic loads and a store, never
+// blocking on writers; publishers swap versions atomically and reclaim retired ones once no reader can observe them.
+class ProgramRegistry final
+{
+    struct Version;
+    struct ReaderSlot;
+
+public:
+    class Snapshot final
+    {
+    public:
+        Snapshot() = default;
+        ~Snapshot();
+
+        Snapshot(Snapshot&& other) noexcept;
+        auto operator=(Snapshot&& other) noexcept -> Snapshot&;
+
+        Snapshot(const Snapshot&) = delete;
+        auto operator=(const Snapshot&) -> Snapshot& = delete;
+
+        [[nodiscard]] explicit operator bool() const noexcept;
+        [[nodiscard]] auto program() const noexcept -> const Program&;
+        [[nodiscard]] auto version() const noexcept -> std::uint64_t;
+
+        void release() noexcept;
+
+    private:
+        friend class ProgramRegistry;
+        Snapshot(ReaderSlot* slot, const Version* version) noexcept;
+
+        ReaderSlot* slot_ = nullptr;
+        const Version* version_ = nullptr;
+    };
+
+    // Per-thread handle; one reader must not be shared between threads that acquire concurrently.
+    class Reader final
+    {
+    public:
+        Reader() = default;
+        ~Reader();
+
+        Reader(Reader&& other) noexcept;
+        auto operator=(Reader&& other) noexcept -> Reader&;
+
+        Reader(const Reader&) = delete;
+        auto operator=(const Reader&) -> Reader& = delete;
+
+        [[nodiscard]] auto acquire() noexcept -> Snapshot;
+
+    private:
+        friend class ProgramRegistry;
+        Reader(ProgramRegistry* registry, ReaderSlot* slot) noexcept;
+
+        ProgramRegistry* registry_ = nullptr;
+        ReaderSlot* slot_ = nullptr;
+    };
+
+    ProgramRegistry();
+    ~ProgramRegistry();
+
+    ProgramRegistry(const ProgramRegistry&) = delete;
+    auto operator=(const ProgramRegistry&) -> ProgramRegistry& = delete;
+    ProgramRegistry(ProgramRegistry&&) = delete;
+    auto operator=(ProgramRegistry&&) -> ProgramRegistry& = delete;
+
+    [[nodiscard]] auto publish(Program program, const VM& verifier, std::size_t available_inputs)
+        -> Result<std::uint64_t>;
+    [[nodiscard]] auto publish(Program program, const VM& verifier, std::size_t available_inputs, Executor& executor)
+        -> Result<std::uint64_t>;
+    [[nodiscard]] auto reader() -> Reader;
+    auto collect() -> std::size_t;
+
+    [[nodiscard]] auto current_version() const noexcept -> std::uint64_t;
+    [[nodiscard]] auto retired_versions() const -> std::size_t;
+
+private:
+    struct Version final
+    {
+        Program program;
+        std::uint64_t number = 0;
+    };
+
+    struct ReaderSlot final
+    {
+        std::atomic<std::uint64_t> active_epoch {idle_epoch};
+        std::size_t depth = 0;
+    };
+
+    struct RetiredVersion final
+    {
+        std::unique_ptr<Version> version;
+        std::uint64_t retire_epoch = 0;
+    };
+
+    static constexpr std::uint64_t idle_epoch = ~std::uint64_t {0};
+
+    [[nodiscard]] auto install(Program program) -> std::uint64_t;
+    [[nodiscard]] auto collect_locked() -> std::vector<std::unique_ptr<Version>>;
+    void release_reader(ReaderSlot* slot) noexcept;
+
+    std::atomic<Version*> current_ {nullptr};
+    std::atomic<std::uint64_t> epoch_ {0};
+    std::uint64_t last_version_ = 0;
+    mutable std::mutex writer_mutex_;
+    std::deque<ReaderSlot> reader_slots_;
+    std::vector<ReaderSlot*> free_slots_;
+    std::vector<RetiredVersion> retired_;
+};
+
+struct ProgramCacheStats final
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t stores = 0;
+    std::uint64_t store_failures = 0;
+    std::uint64_t corrupt_entries = 0;
+    std::uint64_t evictions = 0;
+};
+
+// Content-addressed directory of prepared programs shared by every process on a host. Entries are keyed by SHA-256
+// over the input bytecode, the native signature table and the preparation pipeline, published with an atomic
+// rename, and evicted least-recently-used (by modification time) once the directory exceeds its byte budget.
+class ProgramCache final
+{
+public:
+    using PrepareFunction = std::move_only_function<Result<Program>(Program)>;
+
+    explicit ProgramCache(std::filesystem::path directory, std::uint64_t capacity_bytes = 256ULL * 1024ULL * 1024ULL);
+
+    // Hits return the stored artifact without re-running preparation or verification; misses do both, then store.
+    [[nodiscard]] auto load(std::span<const std::byte> bytecode, const VM& vm, std::size_t available_inputs)
+        -> Result<Program>;
+    [[nodiscard]] auto load(
+        std::span<const std::byte> bytecode,
+        const VM& vm,
+        std::size_t available_inputs,
+        std::string_view pipeline_tag,
+        PrepareFunction prepare) -> Result<Program>;
+
+    auto evict_to_capacity() -> std::size_t;
+
+    [[nodiscard]] auto directory() const noexcept -> const std::filesystem::path&;
+    [[nodiscard]] auto stats() const noexcept -> const ProgramCacheStats&;
+
+private:
+    [[nodiscard]] auto entry_path(std::string_view key) const -> std::filesystem::path;
+    [[nodiscard]] auto read_entry(const std::filesystem::path& path) -> std::optional<Program>;
+    void write_entry(const std::filesystem::path& path, const MoveBuffer& artifact);
+
+    std::filesystem::path directory_;
+    std::uint64_t capacity_bytes_ = 0;
+    std::uint64_t estimated_bytes_ = 0;
+    ProgramCacheStats stats_ {};
+};
+
+struct VMPoolStats final
+{
+    std::uint64_t local_hits = 0;
+    std::uint64_t shared_hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t releases = 0;
+    std::uint64_t discarded = 0;
+};
+
+// Recycles configured VMs for request-scoped execution. Idle VMs sit in small per-thread shards first and a shared
+// overflow list second; a lease returning to the pool is reset in place rather than destroyed and rebuilt.
+class VMPool final
+{
+public:
+    // Runs once per newly constructed VM, possibly on several acquiring threads at once.
+    using ConfigureFunction = std::move_only_function<void(VM&) const>;
+
+    class Lease final
+    {
+    public:
+        Lease() = default;
+        ~Lease();
+
+        Lease(Lease&& other) noexcept;
+        auto operator=(Lease&& other) noexcept -> Lease&;
+
+        Lease(const Lease&) = delete;
+        auto operator=(const Lease&) -> Lease& = delete;
+
+        [[nodiscard]] explicit operator bool() const noexcept;
+        [[nodiscard]] auto vm() const noexcept -> VM&;
+        [[nodiscard]] auto operator*() const noexcept -> VM&;
+        [[nodiscard]] auto operator->() const noexcept -> VM*;
+
+        void release() noexcept;
+
+    private:
+        friend class VMPool;
+        Lease(VMPool* pool, std::unique_ptr<VM> vm) noexcept;
+
+        VMPool* pool_ = nullptr;
+        std::unique_ptr<VM> vm_ {};
+    };
+
+    explicit VMPool(
+        ConfigureFunction configure,
+        std::size_t max_idle = 64,
+        std::size_t stack_reserve = 64,
+        std::size_t arena_bytes = 4096);
+    ~VMPool();
+
+    VMPool(const VMPool&) = delete;
+    auto operator=(const VMPool&) -> VMPool& = delete;
+    VMPool(VMPool&&) = delete;
+    auto operator=(VMPool&&) -> VMPool& = delete;
+
+    // Leases must be returned before the pool is destroyed.
+    [[nodiscard]] auto acquire() -> Lease;
+    [[nodiscard]] auto idle() const -> std::size_t;
+    [[nodiscard]] auto stats() const noexcept -> VMPoolStats;
+
+private:
+    struct Shard final
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<VM>> idle;
+    };
+
+    void recycle(std::unique_ptr<VM> vm) noexcept;
+    [[nodiscard]] auto local_shard() noexcept -> Shard&;
+
+    ConfigureFunction configure_;
+    std::size_t stack_reserve_ = 0;
+    std::size_t arena_bytes_ = 0;
+    std::size_t shard_capacity_ = 0;
+    std::size_t shared_capacity_ = 0;
+    std::unique_ptr<Shard[]> shards_;
+    std::size_t shard_count_ = 0;
+    mutable std::mutex shared_mutex_;
+    std::vector<std::unique_ptr<VM>> shared_idle_;
+    std::atomic<std::uint64_t> local_hits_ {0};
+    std::atomic<std::uint64_t> shared_hits_ {0};
+    std::atomic<std::uint64_t> misses_ {0};
+    std::atomic<std::uint64_t> releases_ {0};
+    std::atomic<std::uint64_t> discarded_ {0};
+};
+
+enum class SchedulingPolicy : std::uint8_t
+{
+    round_robin = 0,
+    priority = 1
+};
+
+struct FiberOptions final
+{
+    // Steps a fiber runs before yielding its worker to the next runnable fiber.
+    std::size_t slice_steps = 1024;
+    // Total steps across all slices before the fiber fails with step_budget_exceeded; 0 means unlimited.
+    std::size_t step_limit = 0;
+    // Under SchedulingPolicy::priority higher values run first; equal priorities take turns in spawn order.
+    std::uint8_t priority = 0;
+};
+
+struct SchedulerStats final
+{
+    std::uint64_t spawned = 0;
+    std::uint64_t completed = 0;
+    std::uint64_t slices = 0;
+    std::uint64_t steals = 0;
+};
+
+// Multiplexes resumable program executions (fibers) over a fixed set of worker threads. Each worker time-slices its
+// own run queue in VM steps and steals runnable fibers from its peers when that queue drains. A fiber leases a VM from
+// the pool only once it first runs, so queued fibers cost a few pointers each.
+class Scheduler final
+{
+public:
+    // Runs on the fiber's leased VM before its first slice, typically to push inputs.
+    using FiberSetup = std::move_only_function<void(VM&)>;
+    // Runs on a worker thread after the fiber's VM has been returned to the pool.
+    using Completion = std::move_only_function<void(Result<Value>)>;
+
+    // The pool must outlive the scheduler. Destruction waits for every spawned fiber to finish.
+    explicit Scheduler(
+        VMPool& pool,
+        std::size_t worker_count = std::thread::hardware_concurrency(),
+        SchedulingPolicy policy = SchedulingPolicy::round_robin);
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    auto operator=(const Scheduler&) -> Scheduler& = delete;
+    Scheduler(Scheduler&&) = delete;
+    auto operator=(Scheduler&&) -> Scheduler& = delete;
+
+    // The program must outlive the fiber.
+    void spawn(const Program& program, FiberSetup setup, Completion on_complete, FiberOptions options = {});
+    void wait_idle();
+    [[nodiscard]] auto active_fibers() const noexcept -> std::size_t;
+    [[nodiscard]] auto worker_count() const noexcept -> std::size_t;
+    [[nodiscard]] auto stats() const noexcept -> SchedulerStats;
+
+private:
+    struct Fiber final
+    {
+        const Program* program = nullptr;
+        FiberSetup setup;
+        Completion on_complete;
+        FiberOptions options {};
+        VMPool::Lease lease;
+        std::size_t previous_budget = 0;
+        std::size_t steps_used = 0;
+        std::uint64_t sequence = 0;
+    };
+
+    struct Worker final
+    {
+        std::mutex mutex;
+        // A heap ordered by (priority, sequence) so equal priorities rotate in arrival order.
+        std::vector<std::unique_ptr<Fiber>> ready;
+    };
+
+    void enqueue(std::size_t worker, std::unique_ptr<Fiber> fiber);
+    [[nodiscard]] auto take(std::size_t worker) -> std::unique_ptr<Fiber>;
+    [[nodiscard]] auto pop_ready(Worker& worker) -> std::unique_ptr<Fiber>;
+    void run_slice(std::size_t worker, std::unique_ptr<Fiber> fiber);
+    void worker_loop(std::size_t worker, std::stop_token stop);
+
+    VMPool& pool_;
+    SchedulingPolicy policy_ = SchedulingPolicy::round_robin;
+    std::unique_ptr<Worker[]> workers_state_;
+    std::size_t worker_count_ = 0;
+    std::mutex idle_mutex_;
+    std::condition_variable_any work_available_;
+    std::condition_variable_any fibers_finished_;
+    std::atomic<std::size_t> runnable_ {0};
+    std::atomic<std::size_t> active_ {0};
+    std::atomic<std::uint64_t> next_sequence_ {0};
+    std::atomic<std::size_t> next_worker_ {0};
+    std::atomic<std::uint64_t> spawned_ {0};
+    std::atomic<std::uint64_t> completed_ {0};
+    std::atomic<std::uint64_t> slices_ {0};
+    std::atomic<std::uint64_t> steals_ {0};
+    std::vector<std::jthread> workers_;
 };
 } // namespace stella::vm
+
+// Not exported: shared by the implementation units. It sits in a nested namespace so argument-dependent lookup on
+// ErrorCode never offers it to importers that declare a make_unexpected of their own.
+namespace stella::vm::error_detail
+{
+[[nodiscard]] inline auto make_unexpected(ErrorCode code, std::string message) -> std::unexpected<Error>
+{
+    return std::unexpected<Error> {Error {code, std::move(message)}};
+}
+} // namespace stella::vm::error_detail
@@ -1,12 +1,17 @@
 module;
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <bit>
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <exception>
 #include <expected>
 #include <functional>
+#include <latch>
 #include <limits>
 #include <memory>
 #include <memory_resource>
@@ -14,6 +19,7 @@ module;
 #include <span>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -21,6 +27,8 @@ module vm;
 
 namespace stella::vm
 {
+using error_detail::make_unexpected;
+
 namespace
 {
 template <typename... Ts>
@@ -32,10 +40,25 @@ struct Overload : Ts...
 template <typename... Ts>
 Overload(Ts...) -> Overload<Ts...>;
 
-[[nodiscard]] auto make_unexpected(ErrorCode code, std::string message) -> std::unexpected<Error>
+// Counts a native callback as in flight for as long as it runs, so fold_pure_natives can refuse to reenter the VM.
+struct NativeDispatchGuard final
 {
-    return std::unexpected<Error> {Error {code, std::move(message)}};
-}
+    explicit NativeDispatchGuard(std::size_t& dispatch_depth)
+        : depth(dispatch_depth)
+    {
+        ++depth;
+    }
+
+    ~NativeDispatchGuard()
+    {
+        --depth;
+    }
+
+    NativeDispatchGuard(const NativeDispatchGuard&) = delete;
+    auto operator=(const NativeDispatchGuard&) -> NativeDispatchGuard& = delete;
+
+    std::size_t& depth;
+};
 
 enum class ConstantTag : std::uint8_t
 {
@@ -49,9 +72,14 @@ enum class ConstantTag : std::uint8_t
 inline constexpr std::uint32_t bytecode_max_instruction_count = 1'000'000U;
 inline constexpr std::uint32_t bytecode_max_constant_count = 1'000'000U;
 inline constexpr std::uint32_t bytecode_max_function_count = 250'000U;
+inline constexpr std::uint32_t bytecode_max_switch_case_count = 1'000'000U;
 inline constexpr std::uint32_t bytecode_max_blob_bytes = 32U * 1024U * 1024U;
 inline constexpr std::uint64_t bytecode_max_total_bytes = 256ULL * 1024ULL * 1024ULL;
 
+// Arena blocks start at the initial size (or this floor) and double until the cap.
+inline constexpr std::size_t arena_min_block_bytes = 1024;
+inline constexpr std::size_t arena_max_block_bytes = 1024U * 1024U;
+
 class ByteWriter final
 {
 public:
@@ -99,7 +127,7 @@ public:
 
     [[nodiscard]] auto finish() -> MoveBuffer
     {
-        MoveBuffer buffer(bytes_.size());
+        MoveBuffer buffer = MoveBuffer::uninitialized(bytes_.size());
         if (!bytes_.empty())
         {
             std::copy(bytes_.begin(), bytes_.end(), buffer.bytes().begin());
@@ -380,1166 +408,3437 @@ private:
     out = lhs * rhs;
     return true;
 }
-} // namespace
 
-MoveBuffer::MoveBuffer(std::size_t byte_count)
-    : data(byte_count == 0 ? nullptr : std::make_unique<std::byte[]>(byte_count))
-    , size(byte_count)
-{
-}
+inline constexpr std::size_t verifier_unvisited_depth = (std::numeric_limits<std::size_t>::max)();
+inline constexpr std::size_t no_verify_failure = (std::numeric_limits<std::size_t>::max)();
+inline constexpr std::size_t parallel_verify_min_instructions = 64U * 1024U;
+inline constexpr std::size_t parallel_verify_min_chunk_instructions = 16U * 1024U;
 
-MoveBuffer::MoveBuffer(std::unique_ptr<std::byte[]> bytes, std::size_t byte_count) noexcept
-    : data(std::move(bytes))
-    , size(byte_count)
+// Half-open pc range a single verification context may reach. Function bodies are bounded by the next
+// function entry so that every instruction is analyzed by at most one region per frame shape; a function whose
+// control flow leaves its region is walked again over the whole bytecode by verify_escaped_functions.
+struct VerifierRegion final
 {
-}
+    std::size_t begin = 0;
+    std::size_t end = 0;
+};
 
-auto MoveBuffer::bytes() noexcept -> std::span<std::byte>
+// Buffers reused across regions so a whole-program verify allocates once instead of once per function.
+struct VerifierScratch final
 {
-    return {data.get(), size};
-}
+    std::vector<std::size_t> stack_depth_at_pc {};
+    std::vector<std::size_t> worklist {};
+    // Every pc the walks since the last reset first reached, so a failed walk over a shared table can be undone.
+    std::vector<std::size_t> reached {};
+    // Set when the last walk failed only because its control flow left the region.
+    bool left_region = false;
+    // InternTable::current_for hashes every constant, so one pass asks at most once.
+    std::optional<bool> interned_current {};
+};
 
-auto MoveBuffer::bytes() const noexcept -> std::span<const std::byte>
+struct VerifierFailure final
 {
-    return {data.get(), size};
-}
+    std::size_t function = no_verify_failure;
+    Error error {};
+};
 
-auto MoveBuffer::data_ptr() noexcept -> std::byte*
+[[nodiscard]] auto validate_function_table(const Program& program) -> VoidResult
 {
-    return data.get();
-}
+    if (program.code.empty())
+    {
+        return make_unexpected(ErrorCode::verification_failed, "Program has no instructions.");
+    }
 
-auto MoveBuffer::data_ptr() const noexcept -> const std::byte*
-{
-    return data.get();
-}
+    for (const auto& function : program.functions)
+    {
+        if (function.entry >= program.code.size())
+        {
+            return make_unexpected(
+                ErrorCode::invalid_function_index,
+                "Function entry points outside bytecode.");
+        }
+        if (function.local_count < function.arity)
+        {
+            return make_unexpected(
+                ErrorCode::invalid_function_signature,
+                "Function local_count must be >= arity.");
+        }
+    }
 
-Value::Value(std::int64_t integer) noexcept
-    : storage_(integer)
-{
+    return {};
 }
 
-Value::Value(double floating_point) noexcept
-    : storage_(floating_point)
+// Maps every function to [entry, next distinct entry). Requires validate_function_table to have passed.
+[[nodiscard]] auto partition_function_regions(const Program& program) -> std::vector<VerifierRegion>
 {
-}
+    std::vector<std::size_t> entries;
+    entries.reserve(program.functions.size());
+    for (const auto& function : program.functions)
+    {
+        entries.push_back(function.entry);
+    }
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
 
-Value::Value(std::string_view borrowed_text) noexcept
-    : storage_(borrowed_text)
-{
+    std::vector<VerifierRegion> regions;
+    regions.reserve(program.functions.size());
+    for (const auto& function : program.functions)
+    {
+        const auto next_entry = std::upper_bound(entries.begin(), entries.end(), function.entry);
+        regions.push_back({
+            .begin = function.entry,
+            .end = next_entry == entries.end() ? program.code.size() : *next_entry,
+        });
+    }
+    return regions;
 }
 
-Value::Value(std::string owned_text) noexcept
-    : storage_(std::move(owned_text))
+// Functions sharing entry and local_count analyze identically; only the lowest index of each group is
+// verified so the reported error is unchanged while duplicate bodies are not re-walked.
+[[nodiscard]] auto redundant_function_mask(const Program& program) -> std::vector<bool>
 {
-}
+    std::vector<std::size_t> order(program.functions.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](const std::size_t lhs, const std::size_t rhs) {
+        const auto& a = program.functions[lhs];
+        const auto& b = program.functions[rhs];
+        return std::tie(a.entry, a.local_count, lhs) < std::tie(b.entry, b.local_count, rhs);
+    });
 
-Value::Value(MoveBuffer buffer) noexcept
-    : storage_(std::move(buffer))
-{
+    std::vector<bool> redundant(program.functions.size(), false);
+    for (std::size_t i = 1; i < order.size(); ++i)
+    {
+        const auto& previous = program.functions[order[i - 1]];
+        const auto& current = program.functions[order[i]];
+        if (previous.entry == current.entry && previous.local_count == current.local_count)
+        {
+            redundant[order[i]] = true;
+        }
+    }
+    return redundant;
 }
 
-Value::Value(const Value& other)
-    : storage_(std::visit(
-          Overload {
-              [](std::monostate value) -> Storage { return value; },
-              [](std::int64_t value) -> Storage { return value; },
-              [](double value) -> Storage { return value; },
-              [](std::string_view value) -> Storage { return value; },
-              [](const std::string& value) -> Storage { return value; },
-              [](const MoveBuffer& value) -> Storage {
-                  MoveBuffer copied(value.size);
-                  if (value.size != 0)
-                  {
-                      std::copy(value.bytes().begin(), value.bytes().end(), copied.bytes().begin());
-                  }
-                  return Storage(std::move(copied));
-              }},
-          other.storage_))
-{
-}
+inline constexpr std::size_t empty_native_arity = (std::numeric_limits<std::size_t>::max)();
 
-auto Value::operator=(const Value& other) -> Value&
+[[nodiscard]] auto native_arity_table(const std::deque<NativeBinding>& native_bindings) -> std::vector<std::size_t>
 {
-    if (this == &other)
+    std::vector<std::size_t> arities;
+    arities.reserve(native_bindings.size());
+    for (const NativeBinding& binding : native_bindings)
     {
-        return *this;
+        arities.push_back(binding.function ? binding.arity : empty_native_arity);
     }
-
-    Value copy(other);
-    storage_ = std::move(copy.storage_);
-    return *this;
+    return arities;
 }
 
-auto Value::i64(std::int64_t integer) noexcept -> Value
+[[nodiscard]] auto record_schema_table(std::span<const RecordBinding> records) -> std::vector<const RecordSchema*>
 {
-    return Value(integer);
+    std::vector<const RecordSchema*> schemas;
+    schemas.reserve(records.size());
+    for (const RecordBinding& binding : records)
+    {
+        schemas.push_back(binding.schema);
+    }
+    return schemas;
 }
 
-auto Value::f64(double floating_point) noexcept -> Value
+// Programs without interned-string opcodes do not depend on the intern table, so editing their constants is harmless.
+[[nodiscard]] auto interned_source_of(const Program& program) noexcept -> std::optional<std::uint64_t>
 {
-    return Value(floating_point);
+    const auto is_interned = [](const Instruction& instruction) {
+        return instruction.opcode == OpCode::str_intern || instruction.opcode == OpCode::str_eq_interned ||
+            instruction.opcode == OpCode::str_switch;
+    };
+    const bool uses_interned = std::any_of(program.code.begin(), program.code.end(), is_interned);
+    return uses_interned ? program.interned.current_source(program) : std::nullopt;
 }
 
-auto Value::borrowed_string(std::string_view borrowed_text) noexcept -> Value
+// Reads back what verify_region left in the scratch depth table: which pcs were reached and whom they call.
+void record_region(
+    const Program& program,
+    const VerifierRegion region,
+    const VerifierScratch& scratch,
+    std::vector<std::uint32_t>& callees,
+    std::vector<bool>* reach)
 {
-    return Value(borrowed_text);
-}
+    callees.clear();
+    for (std::size_t offset = 0; offset < scratch.stack_depth_at_pc.size(); ++offset)
+    {
+        if (scratch.stack_depth_at_pc[offset] == verifier_unvisited_depth)
+        {
+            continue;
+        }
 
-auto Value::owned_string(std::string owned_text) noexcept -> Value
-{
-    return Value(std::move(owned_text));
-}
+        const Instruction& instruction = program.code[region.begin + offset];
+        if (instruction.opcode == OpCode::call)
+        {
+            callees.push_back(instruction.operand);
+        }
+        if (reach != nullptr)
+        {
+            (*reach)[region.begin + offset] = true;
+        }
+    }
 
-auto Value::owned_buffer(MoveBuffer buffer) noexcept -> Value
-{
-    return Value(std::move(buffer));
+    std::sort(callees.begin(), callees.end());
+    callees.erase(std::unique(callees.begin(), callees.end()), callees.end());
 }
 
-auto Value::kind() const noexcept -> Kind
+[[nodiscard]] auto load_field_type(const OpCode opcode) noexcept -> FieldType
 {
-    if (std::holds_alternative<std::monostate>(storage_))
-    {
-        return Kind::empty;
-    }
-    if (std::holds_alternative<std::int64_t>(storage_))
+    switch (opcode)
     {
-        return Kind::i64;
+        case OpCode::load_field_f64:
+            return FieldType::f64;
+        case OpCode::load_field_string:
+            return FieldType::string;
+        case OpCode::load_field_bytes:
+            return FieldType::bytes;
+        default:
+            return FieldType::i64;
     }
-    if (std::holds_alternative<double>(storage_))
+}
+
+// Shared by the verifier and the interpreter: checks slot, field index and the opcode's expected field type.
+[[nodiscard]] auto resolve_record_field(std::span<const RecordBinding> records, const Instruction& instruction)
+    -> Result<const RecordField*>
+{
+    const std::uint32_t slot = instruction.operand >> record_field_operand_bits;
+    const std::uint32_t field_index = instruction.operand & (max_record_fields - 1U);
+    if (slot >= records.size())
     {
-        return Kind::f64;
+        return make_unexpected(ErrorCode::invalid_record_index, "load_field record slot out of range.");
     }
-    if (std::holds_alternative<std::string_view>(storage_))
+
+    const std::span<const RecordField> fields = records[slot].schema->fields();
+    if (field_index >= fields.size())
     {
-        return Kind::borrowed_string;
+        return make_unexpected(ErrorCode::invalid_field_index, "load_field field index out of range.");
     }
-    if (std::holds_alternative<std::string>(storage_))
+
+    const RecordField& field = fields[field_index];
+    if (field.type != load_field_type(instruction.opcode))
     {
-        return Kind::owned_string;
+        std::string message = "load_field opcode does not match the type of field '";
+        message += field.name;
+        message += "'.";
+        return make_unexpected(ErrorCode::type_mismatch, std::move(message));
     }
-
-    return Kind::buffer;
+    return &field;
 }
 
-auto Value::kind_name(const Kind kind) noexcept -> std::string_view
+[[nodiscard]] auto read_record_field(const RecordField& field, const void* record) noexcept -> Value
 {
-    switch (kind)
-    {
-        case Kind::empty:
-            return "empty";
-        case Kind::i64:
-            return "i64";
-        case Kind::f64:
-            return "f64";
-        case Kind::borrowed_string:
-            return "borrowed_string";
-        case Kind::owned_string:
-            return "owned_string";
-        case Kind::buffer:
-            return "buffer";
+    const void* address = field.address(record);
+    switch (field.type)
+    {
+        case FieldType::i64:
+            return Value::i64(*static_cast<const std::int64_t*>(address));
+        case FieldType::f64:
+            return Value::f64(*static_cast<const double*>(address));
+        case FieldType::string:
+            if (field.owned_string)
+            {
+                return Value::borrowed_string(*static_cast<const std::string*>(address));
+            }
+            return Value::borrowed_string(*static_cast<const std::string_view*>(address));
+        case FieldType::bytes:
+            return Value::borrowed_buffer(*static_cast<const std::span<const std::byte>*>(address));
     }
-
-    return "unknown";
+    return Value {};
 }
 
-auto Value::is_empty() const noexcept -> bool
+// Walks from entry_pc on top of whatever scratch.stack_depth_at_pc already holds for the region; a pc some earlier
+// walk reached at the same depth is not walked again.
+[[nodiscard]] auto walk_region(
+    const Program& program,
+    const std::deque<NativeBinding>& native_bindings,
+    const std::span<const RecordBinding> records,
+    const std::size_t available_inputs,
+    const VerifierRegion region,
+    const std::size_t entry_pc,
+    const std::size_t initial_stack_depth,
+    const std::optional<std::size_t> frame_local_count,
+    VerifierScratch& scratch) -> VoidResult
 {
-    return std::holds_alternative<std::monostate>(storage_);
-}
+    std::vector<std::size_t>& stack_depth_at_pc = scratch.stack_depth_at_pc;
+    std::vector<std::size_t>& worklist = scratch.worklist;
+    worklist.clear();
+    scratch.left_region = false;
 
-auto Value::is_i64() const noexcept -> bool
-{
-    return std::holds_alternative<std::int64_t>(storage_);
-}
+    std::optional<std::size_t> stack_depth_at_end;
 
-auto Value::is_f64() const noexcept -> bool
-{
-    return std::holds_alternative<double>(storage_);
-}
+    const auto enqueue_successor =
+        [&](const std::size_t pc, const std::size_t depth, const bool is_fallthrough) -> VoidResult {
+        if (pc == program.code.size())
+        {
+            if (frame_local_count.has_value())
+            {
+                return make_unexpected(
+                    ErrorCode::missing_call_frame,
+                    "Function can fall through bytecode end without ret.");
+            }
 
-auto Value::is_string_view() const noexcept -> bool
-{
-    return std::holds_alternative<std::string_view>(storage_);
-}
+            if (!stack_depth_at_end.has_value())
+            {
+                stack_depth_at_end = depth;
+                return {};
+            }
 
-auto Value::is_owned_string() const noexcept -> bool
-{
-    return std::holds_alternative<std::string>(storage_);
-}
+            if (stack_depth_at_end.value() != depth)
+            {
+                return make_unexpected(
+                    ErrorCode::verification_failed,
+                    "Inconsistent stack depth at implicit program end.");
+            }
 
-auto Value::is_string() const noexcept -> bool
-{
-    return is_string_view() || is_owned_string();
-}
+            return {};
+        }
 
-auto Value::is_buffer() const noexcept -> bool
-{
-    return std::holds_alternative<MoveBuffer>(storage_);
-}
+        if (pc > program.code.size())
+        {
+            return make_unexpected(
+                ErrorCode::invalid_jump_target,
+                "Jump target points past end of bytecode.");
+        }
 
-auto Value::as_i64() -> std::int64_t&
-{
-    return std::get<std::int64_t>(storage_);
-}
+        if (pc == region.end && is_fallthrough)
+        {
+            scratch.left_region = true;
+            return make_unexpected(
+                ErrorCode::missing_call_frame,
+                "Function can fall through into the next function without ret.");
+        }
 
-auto Value::as_i64() const -> const std::int64_t&
-{
-    return std::get<std::int64_t>(storage_);
-}
+        if (pc < region.begin || pc >= region.end)
+        {
+            scratch.left_region = true;
+            return make_unexpected(
+                ErrorCode::invalid_jump_target,
+                "Jump target leaves the enclosing function during verification.");
+        }
 
-auto Value::as_f64() -> double&
-{
-    return std::get<double>(storage_);
-}
+        std::size_t& known_depth = stack_depth_at_pc[pc - region.begin];
+        if (known_depth == verifier_unvisited_depth)
+        {
+            known_depth = depth;
+            worklist.push_back(pc);
+            scratch.reached.push_back(pc);
+            return {};
+        }
 
-auto Value::as_f64() const -> const double&
-{
-    return std::get<double>(storage_);
-}
+        if (known_depth != depth)
+        {
+            return make_unexpected(
+                ErrorCode::verification_failed,
+                "Inconsistent stack depth across control-flow merge.");
+        }
 
-auto Value::as_string_view() -> std::string_view&
-{
-    return std::get<std::string_view>(storage_);
-}
+        return {};
+    };
 
-auto Value::as_string_view() const -> const std::string_view&
-{
-    return std::get<std::string_view>(storage_);
-}
+    {
+        const auto entry = enqueue_successor(entry_pc, initial_stack_depth, false);
+        if (!entry.has_value())
+        {
+            return std::unexpected(entry.error());
+        }
+    }
 
-auto Value::as_owned_string() -> std::string&
-{
-    return std::get<std::string>(storage_);
-}
+    while (!worklist.empty())
+    {
+        const std::size_t pc = worklist.back();
+        worklist.pop_back();
 
-auto Value::as_owned_string() const -> const std::string&
-{
-    return std::get<std::string>(storage_);
-}
+        const Instruction& instruction = program.code[pc];
+        const std::size_t stack_depth = stack_depth_at_pc[pc - region.begin];
 
-auto Value::as_buffer() -> MoveBuffer&
-{
+        std::size_t pops = 0;
+        std::size_t pushes = 0;
+        std::optional<std::size_t> explicit_target;
+        const Program::StringSwitch* switch_table = nullptr;
+        bool has_fallthrough = true;
+
+        switch (instruction.opcode)
+        {
+            case OpCode::push_constant:
+            {
+                if (instruction.operand >= program.constants.size())
+                {
+                    return make_unexpected(
+                        ErrorCode::invalid_constant_index,
+                        "push_constant operand out of range during verification.");
+                }
+                pushes = 1;
+                break;
+            }
+            case OpCode::push_input:
+            {
+                if (instruction.operand >= available_inputs)
+                {
+                    return make_unexpected(
+                        ErrorCode::invalid_input_index,
+                        "push_input operand out of range during verification.");
+                }
+                pushes = 1;
+                break;
+            }
+            case OpCode::add_i64:
+            case OpCode::sub_i64:
+            case OpCode::mul_i64:
+            case OpCode::mod_i64:
+            case OpCode::cmp_eq_i64:
+            case OpCode::cmp_lt_i64:
+            case OpCode::and_i64:
+            case OpCode::or_i64:
+            case OpCode::xor_i64:
+            case OpCode::shl_i64:
+            case OpCode::shr_i64:
+            {
+                pops = 2;
+                pushes = 1;
+                break;
+            }
+            case OpCode::load_field_i64:
+            case OpCode::load_field_f64:
+            case OpCode::load_field_string:
+            case OpCode::load_field_bytes:
+            {
+                const auto field = resolve_record_field(records, instruction);
+                if (!field.has_value())
+                {
+                    return std::unexpected(field.error());
+                }
+                pushes = 1;
+                break;
+            }
+            case OpCode::call_native:
+            {
+                if (instruction.operand >= native_bindings.size())
+                {
+                    return make_unexpected(
+                        ErrorCode::invalid_native_index,
+                        "call_native operand out of range during verification.");
+                }
+                if (!native_bindings[instruction.operand].function)
+                {
+                    return make_unexpected(
+                        ErrorCode::empty_native_binding,
+                        "call_native resolved to empty native binding during verification.");
+                }
+                pops = native_bindings[instruction.operand].arity;
+                pushes = 1;
+                break;
+            }
+            case OpCode::jump:
+            {
+                explicit_target = static_cast<std::size_t>(instruction.operand);
+                has_fallthrough = false;
+                break;
+            }
+            case OpCode::jump_if_true:
+            {
+                pops = 1;
+                explicit_target = static_cast<std::size_t>(instruction.operand);
+                has_fallthrough = true;
+                break;
+            }
+            case OpCode::dup:
+            {
+                if (stack_depth == 0)
+                {
+                    return make_unexpected(
+                        ErrorCode::stack_underflow,
+                        "dup requires at least one value on stack.");
+                }
+                pushes = 1;
+                break;
+            }
+            case OpCode::pop:
+            {
+                pops = 1;
+                break;
+            }
+            case OpCode::yield:
+            {
+                break;
+            }
+            case OpCode::buffer_len:
+            case OpCode::buffer_hash:
+            {
+                pops = 1;
+                pushes = 1;
+                break;
+            }
+            case OpCode::buffer_find_byte:
+            case OpCode::buffer_xor_const:
+            {
+                if (instruction.operand > 0xFFU)
+                {
+                    return make_unexpected(
+                        ErrorCode::verification_failed,
+                        "Buffer byte operand must fit in one byte during verification.");
+                }
+                pops = 1;
+                pushes = 1;
+                break;
+            }
+            case OpCode::buffer_load_u8:
+            case OpCode::buffer_load_u32:
+            case OpCode::buffer_load_u64:
+            {
+                pops = 2;
+                pushes = 1;
+                break;
+            }
+            case OpCode::buffer_slice:
+            {
+                pops = 3;
+                pushes = 1;
+                break;
+            }
+            case OpCode::neg_f64:
+            case OpCode::i64_to_f64:
+            case OpCode::f64_to_i64:
+            {
+                pops = 1;
+                pushes = 1;
+                break;
+            }
+            case OpCode::add_f64:
+            case OpCode::sub_f64:
+            case OpCode::mul_f64:
+            case OpCode::div_f64:
+            case OpCode::cmp_eq_f64:
+            case OpCode::cmp_lt_f64:
+            {
+                pops = 2;
+                pushes = 1;
+                break;
+            }
+            case OpCode::fma_f64:
+            {
+                pops = 3;
+                pushes = 1;
+                break;
+            }
+            case OpCode::str_len:
+            case OpCode::str_hash:
+            {
+                pops = 1;
+                pushes = 1;
+                break;
+            }
+            case OpCode::str_eq:
+            case OpCode::str_prefix:
+            case OpCode::str_find:
+            case OpCode::str_concat:
+            {
+                pops = 2;
+                pushes = 1;
+                break;
+            }
+            case OpCode::str_slice:
+            {
+                pops = 3;
+                pushes = 1;
+                break;
+            }
+            case OpCode::str_intern:
+            case OpCode::str_eq_interned:
+            case OpCode::str_switch:
+            {
+                if (!scratch.interned_current.has_value())
+                {
+                    scratch.interned_current = program.interned.current_for(program);
+                }
+                if (!scratch.interned_current.value())
+                {
+                    return make_unexpected(
+                        ErrorCode::stale_intern_table,
+                        "Interned-string opcode needs Program::intern_strings before verification.");
+                }
+                if (instruction.opcode == OpCode::str_eq_interned &&
+                    program.interned.constant_id(instruction.operand) < 0)
+                {
+                    return make_unexpected(
+                        ErrorCode::invalid_constant_index,
+                        "str_eq_interned operand must name a string constant during verification.");
+                }
+                if (instruction.opcode == OpCode::str_switch)
+                {
+                    if (instruction.operand >= program.string_switches.size())
+                    {
+                        return make_unexpected(
+                            ErrorCode::verification_failed,
+                            "str_switch table index out of range during verification.");
+                    }
+                    switch_table = &program.string_switches[instruction.operand];
+                    for (const Program::StringSwitch::Case& string_case : switch_table->cases)
+                    {
+                        if (program.interned.constant_id(string_case.constant) < 0)
+                        {
+                            return make_unexpected(
+                                ErrorCode::invalid_constant_index,
+                                "str_switch case must name a string constant during verification.");
+                        }
+                    }
+                    has_fallthrough = false;
+                }
+                else
+                {
+                    pushes = 1;
+                }
+                pops = 1;
+                break;
+            }
+            case OpCode::call:
+            {
+                if (instruction.operand >= program.functions.size())
+                {
+                    return make_unexpected(
+                        ErrorCode::invalid_function_index,
+                        "call operand out of range during verification.");
+                }
+
+                const auto& function = program.functions[instruction.operand];
+                if (function.local_count < function.arity)
+                {
+                    return make_unexpected(
+                        ErrorCode::invalid_function_signature,
+                        "Function local_count must be >= arity.");
+                }
+
+                pops = function.arity;
+                pushes = 1;
+                has_fallthrough = true;
+                break;
+            }
+            case OpCode::ret:
+            {
+                if (!frame_local_count.has_value())
+                {
+                    return make_unexpected(ErrorCode::missing_call_frame, "ret is only valid inside function code.");
+                }
+                pops = 1;
+                has_fallthrough = false;
+                break;
+            }
+            case OpCode::load_local:
+            {
+                if (!frame_local_count.has_value())
+                {
+                    return make_unexpected(
+                        ErrorCode::missing_call_frame,
+                        "load_local requires function frame context.");
+                }
+                if (instruction.operand >= frame_local_count.value())
+                {
+                    return make_unexpected(
+                        ErrorCode::invalid_local_index,
+                        "load_local operand out of range during verification.");
+                }
+                pushes = 1;
+                break;
+            }
+            case OpCode::store_local:
+            {
+                if (!frame_local_count.has_value())
+                {
+                    return make_unexpected(
+                        ErrorCode::missing_call_frame,
+                        "store_local requires function frame context.");
+                }
+                if (instruction.operand >= frame_local_count.value())
+                {
+                    return make_unexpected(
+                        ErrorCode::invalid_local_index,
+                        "store_local operand out of range during verification.");
+                }
+                pops = 1;
+                break;
+            }
+            case OpCode::halt:
+            {
+                has_fallthrough = false;
+                break;
+            }
+            default:
+            {
+                return make_unexpected(ErrorCode::unknown_opcode, "Unknown opcode during verification.");
+            }
+        }
+
+        if (stack_depth < pops)
+        {
+            return make_unexpected(
+                ErrorCode::stack_underflow,
+                "Instruction would underflow stack during verification.");
+        }
+
+        const std::size_t next_depth = (stack_depth - pops) + pushes;
+
+        if (explicit_target.has_value())
+        {
+            if (explicit_target.value() >= program.code.size())
+            {
+                return make_unexpected(
+                    ErrorCode::invalid_jump_target,
+                    "Jump target out of range during verification.");
+            }
+
+            const auto target_result = enqueue_successor(explicit_target.value(), next_depth, false);
+            if (!target_result.has_value())
+            {
+                return std::unexpected(target_result.error());
+            }
+        }
+
+        if (switch_table != nullptr)
+        {
+            const auto enqueue_switch_target = [&](const std::uint32_t target) -> VoidResult {
+                if (target >= program.code.size())
+                {
+                    return make_unexpected(
+                        ErrorCode::invalid_jump_target,
+                        "str_switch target out of range during verification.");
+                }
+                return enqueue_successor(target, next_depth, false);
+            };
+            for (const Program::StringSwitch::Case& string_case : switch_table->cases)
+            {
+                const auto case_result = enqueue_switch_target(string_case.target);
+                if (!case_result.has_value())
+                {
+                    return std::unexpected(case_result.error());
+                }
+            }
+            const auto default_result = enqueue_switch_target(switch_table->default_target);
+            if (!default_result.has_value())
+            {
+                return std::unexpected(default_result.error());
+            }
+        }
+
+        if (has_fallthrough)
+        {
+            const auto fallthrough_result = enqueue_successor(pc + 1, next_depth, true);
+            if (!fallthrough_result.has_value())
+            {
+                return std::unexpected(fallthrough_result.error());
+            }
+        }
+    }
+
+    return {};
+}
+
+[[nodiscard]] auto verify_region(
+    const Program& program,
+    const std::deque<NativeBinding>& native_bindings,
+    const std::span<const RecordBinding> records,
+    const std::size_t available_inputs,
+    const VerifierRegion region,
+    const std::size_t initial_stack_depth,
+    const std::optional<std::size_t> frame_local_count,
+    VerifierScratch& scratch) -> VoidResult
+{
+    scratch.stack_depth_at_pc.assign(region.end - region.begin, verifier_unvisited_depth);
+    scratch.reached.clear();
+    return walk_region(
+        program,
+        native_bindings,
+        records,
+        available_inputs,
+        region,
+        region.begin,
+        initial_stack_depth,
+        frame_local_count,
+        scratch);
+}
+
+// Walks a function over the whole bytecode with a depth table of its own, as verify() did before it used regions.
+[[nodiscard]] auto verify_function_unbounded(
+    const Program& program,
+    const std::deque<NativeBinding>& native_bindings,
+    const std::span<const RecordBinding> records,
+    const std::size_t available_inputs,
+    const std::size_t function,
+    VerifierScratch& scratch) -> VoidResult
+{
+    const auto local_count = static_cast<std::size_t>(program.functions[function].local_count);
+    scratch.stack_depth_at_pc.assign(program.code.size(), verifier_unvisited_depth);
+    scratch.reached.clear();
+    return walk_region(
+        program,
+        native_bindings,
+        records,
+        available_inputs,
+        VerifierRegion {.begin = 0, .end = program.code.size()},
+        program.functions[function].entry,
+        local_count,
+        local_count,
+        scratch);
+}
+
+// Re-walks over the whole bytecode the functions whose region walk left their region; until it left, that walk matched
+// a whole-bytecode one step for step, so any other region failure is already the right error. Functions with the same
+// local_count share one depth table, so a common tail is walked once per frame shape. A walk that fails against the
+// shared table is undone and repeated alone, so the verdict matches a standalone walk. Returns the lowest failure.
+[[nodiscard]] auto verify_escaped_functions(
+    const Program& program,
+    const std::deque<NativeBinding>& native_bindings,
+    const std::span<const RecordBinding> records,
+    const std::size_t available_inputs,
+    const std::span<const std::size_t> escaped,
+    VerifierScratch& scratch) -> VerifierFailure
+{
+    const auto local_count_of = [&](const std::size_t function) {
+        return static_cast<std::size_t>(program.functions[function].local_count);
+    };
+
+    std::vector<std::size_t> order(escaped.begin(), escaped.end());
+    std::stable_sort(order.begin(), order.end(), [&](const std::size_t lhs, const std::size_t rhs) {
+        return local_count_of(lhs) < local_count_of(rhs);
+    });
+
+    const auto forget_reached = [&](const std::size_t keep) {
+        for (std::size_t i = keep; i < scratch.reached.size(); ++i)
+        {
+            scratch.stack_depth_at_pc[scratch.reached[i]] = verifier_unvisited_depth;
+        }
+        scratch.reached.resize(keep);
+    };
+
+    std::vector<std::size_t> failed;
+    scratch.stack_depth_at_pc.assign(program.code.size(), verifier_unvisited_depth);
+    scratch.reached.clear();
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        const std::size_t local_count = local_count_of(order[i]);
+        if (i > 0 && local_count != local_count_of(order[i - 1]))
+        {
+            forget_reached(0);
+        }
+
+        const std::size_t committed = scratch.reached.size();
+        const VoidResult walked = walk_region(
+            program,
+            native_bindings,
+            records,
+            available_inputs,
+            VerifierRegion {.begin = 0, .end = program.code.size()},
+            program.functions[order[i]].entry,
+            local_count,
+            local_count,
+            scratch);
+        if (!walked.has_value())
+        {
+            forget_reached(committed);
+            failed.push_back(order[i]);
+        }
+    }
+
+    std::sort(failed.begin(), failed.end());
+    for (const std::size_t function : failed)
+    {
+        const VoidResult alone =
+            verify_function_unbounded(program, native_bindings, records, available_inputs, function, scratch);
+        if (!alone.has_value())
+        {
+            return VerifierFailure {.function = function, .error = alone.error()};
+        }
+    }
+    return {};
+}
+
+constexpr std::size_t buffer_pool_class_count =
+    static_cast<std::size_t>(std::countr_zero(buffer_pool_max_bytes) - std::countr_zero(buffer_pool_min_bytes)) + 1;
+constexpr std::size_t buffer_pool_cached_bytes_per_class = 256 * 1024;
+
+auto buffer_size_class(const std::size_t byte_count) noexcept -> std::uint8_t
+{
+    if (byte_count <= buffer_pool_min_bytes)
+    {
+        return 0;
+    }
+    return static_cast<std::uint8_t>(std::bit_width(byte_count - 1) - std::countr_zero(buffer_pool_min_bytes));
+}
+
+auto buffer_class_bytes(const std::uint8_t size_class) noexcept -> std::size_t
+{
+    return buffer_pool_min_bytes << size_class;
+}
+
+// Per-thread free lists, one per power-of-two class. Capacity is reserved on first allocation so the deleter never
+// allocates; a block freed on a thread whose list is absent or full simply goes back to the heap.
+struct ThreadBufferCache final
+{
+    std::array<std::vector<std::byte*>, buffer_pool_class_count> free_blocks {};
+
+    ~ThreadBufferCache();
+};
+
+thread_local bool thread_buffer_cache_destroyed = false;
+
+ThreadBufferCache::~ThreadBufferCache()
+{
+    for (std::vector<std::byte*>& blocks : free_blocks)
+    {
+        for (std::byte* block : blocks)
+        {
+            delete[] block;
+        }
+    }
+    thread_buffer_cache_destroyed = true;
+}
+
+auto thread_buffer_cache() noexcept -> ThreadBufferCache*
+{
+    // Buffers can still be destroyed by other thread_local destructors after the cache itself is gone.
+    if (thread_buffer_cache_destroyed)
+    {
+        return nullptr;
+    }
+    thread_local ThreadBufferCache cache;
+    return &cache;
+}
+
+auto acquire_pooled_block(const std::uint8_t size_class) -> std::byte*
+{
+    ThreadBufferCache* cache = thread_buffer_cache();
+    if (cache != nullptr)
+    {
+        std::vector<std::byte*>& blocks = cache->free_blocks[size_class];
+        if (!blocks.empty())
+        {
+            std::byte* block = blocks.back();
+            blocks.pop_back();
+            return block;
+        }
+        if (blocks.capacity() == 0)
+        {
+            blocks.reserve((std::max)(
+                std::size_t {4},
+                buffer_pool_cached_bytes_per_class / buffer_class_bytes(size_class)));
+        }
+    }
+    return new std::byte[buffer_class_bytes(size_class)];
+}
+
+auto release_pooled_block(const std::uint8_t size_class, std::byte* block) noexcept -> bool
+{
+    ThreadBufferCache* cache = thread_buffer_cache();
+    if (cache == nullptr || size_class >= buffer_pool_class_count)
+    {
+        return false;
+    }
+
+    std::vector<std::byte*>& blocks = cache->free_blocks[size_class];
+    if (blocks.size() == blocks.capacity())
+    {
+        return false;
+    }
+    blocks.push_back(block);
+    return true;
+}
+
+[[nodiscard]] auto write_constant(ByteWriter& writer, const Value& constant) -> VoidResult
+{
+    if (constant.is_empty())
+    {
+        writer.write_u8(static_cast<std::uint8_t>(ConstantTag::empty));
+        return {};
+    }
+    if (constant.is_i64())
+    {
+        writer.write_u8(static_cast<std::uint8_t>(ConstantTag::i64));
+        writer.write_i64(constant.as_i64());
+        return {};
+    }
+    if (constant.is_f64())
+    {
+        writer.write_u8(static_cast<std::uint8_t>(ConstantTag::f64));
+        writer.write_f64(constant.as_f64());
+        return {};
+    }
+    if (constant.is_string())
+    {
+        const auto text_result = constant.expect_string("serialize_program");
+        if (!text_result.has_value())
+        {
+            return std::unexpected(text_result.error());
+        }
+
+        if (text_result->size() > bytecode_max_blob_bytes ||
+            text_result->size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            return make_unexpected(ErrorCode::bytecode_limit_exceeded, "String constant exceeds size limits.");
+        }
+
+        writer.write_u8(static_cast<std::uint8_t>(ConstantTag::string));
+        writer.write_u32(static_cast<std::uint32_t>(text_result->size()));
+        const auto* raw = reinterpret_cast<const std::byte*>(text_result->data());
+        writer.write_bytes(std::span<const std::byte>(raw, text_result->size()));
+        return {};
+    }
+    if (constant.is_bytes())
+    {
+        const auto bytes_result = constant.expect_bytes("serialize_program");
+        if (!bytes_result.has_value())
+        {
+            return std::unexpected(bytes_result.error());
+        }
+
+        const std::span<const std::byte> buffer = bytes_result.value();
+        if (buffer.size() > bytecode_max_blob_bytes ||
+            buffer.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            return make_unexpected(ErrorCode::bytecode_limit_exceeded, "Buffer constant exceeds size limits.");
+        }
+
+        writer.write_u8(static_cast<std::uint8_t>(ConstantTag::buffer));
+        writer.write_u32(static_cast<std::uint32_t>(buffer.size()));
+        writer.write_bytes(buffer);
+        return {};
+    }
+
+    return make_unexpected(
+        ErrorCode::malformed_bytecode,
+        "Encountered unsupported constant kind during serialization.");
+}
+
+[[nodiscard]] auto read_constant(ByteReader& reader) -> Result<Value>
+{
+    std::uint8_t tag_raw = 0;
+    if (!reader.read_u8(tag_raw))
+    {
+        return make_unexpected(ErrorCode::malformed_bytecode, "Constant table is truncated.");
+    }
+
+    switch (static_cast<ConstantTag>(tag_raw))
+    {
+        case ConstantTag::empty:
+            return Value {};
+        case ConstantTag::i64:
+        {
+            std::int64_t value = 0;
+            if (!reader.read_i64(value))
+            {
+                return make_unexpected(ErrorCode::malformed_bytecode, "i64 constant is truncated.");
+            }
+            return Value::i64(value);
+        }
+        case ConstantTag::f64:
+        {
+            double value = 0.0;
+            if (!reader.read_f64(value))
+            {
+                return make_unexpected(ErrorCode::malformed_bytecode, "f64 constant is truncated.");
+            }
+            return Value::f64(value);
+        }
+        case ConstantTag::string:
+        {
+            std::uint32_t length = 0;
+            if (!reader.read_u32(length))
+            {
+                return make_unexpected(ErrorCode::malformed_bytecode, "String constant length is truncated.");
+            }
+            if (length > bytecode_max_blob_bytes)
+            {
+                return make_unexpected(ErrorCode::bytecode_limit_exceeded, "String constant exceeds size limits.");
+            }
+
+            std::span<const std::byte> text_bytes;
+            if (!reader.read_bytes(length, text_bytes))
+            {
+                return make_unexpected(ErrorCode::malformed_bytecode, "String constant payload is truncated.");
+            }
+
+            std::string value;
+            value.resize(length);
+            if (length != 0)
+            {
+                std::memcpy(value.data(), text_bytes.data(), length);
+            }
+            return Value::shared_string(SharedString(std::move(value)));
+        }
+        case ConstantTag::buffer:
+        {
+            std::uint32_t length = 0;
+            if (!reader.read_u32(length))
+            {
+                return make_unexpected(ErrorCode::malformed_bytecode, "Buffer constant length is truncated.");
+            }
+            if (length > bytecode_max_blob_bytes)
+            {
+                return make_unexpected(ErrorCode::bytecode_limit_exceeded, "Buffer constant exceeds size limits.");
+            }
+
+            std::span<const std::byte> payload;
+            if (!reader.read_bytes(length, payload))
+            {
+                return make_unexpected(ErrorCode::malformed_bytecode, "Buffer constant payload is truncated.");
+            }
+
+            return Value::shared_buffer(SharedBuffer::copy_of(payload));
+        }
+        default:
+        {
+            return make_unexpected(
+                ErrorCode::malformed_bytecode,
+                "Unknown constant tag in bytecode.");
+        }
+    }
+}
+
+inline constexpr std::uint32_t snapshot_magic = 0x5354534EU;
+inline constexpr std::uint16_t snapshot_version = 1;
+
+// Identifies the program and native table a snapshot was taken against; FNV-1a is plenty for a consistency check.
+[[nodiscard]] auto execution_fingerprint(const Program& program, std::span<const NativeSignature> natives) noexcept
+    -> std::uint64_t
+{
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    const auto mix = [&hash](const std::uint64_t value) {
+        for (std::uint32_t shift = 0; shift < 64; shift += 8)
+        {
+            hash ^= (value >> shift) & 0xFFULL;
+            hash *= 0x100000001B3ULL;
+        }
+    };
+
+    mix(program.code.size());
+    for (const Instruction& instruction : program.code)
+    {
+        mix((static_cast<std::uint64_t>(instruction.opcode) << 32U) | instruction.operand);
+    }
+    mix(program.constants.size());
+    mix(program.functions.size());
+    for (const Program::Function& function : program.functions)
+    {
+        mix(function.entry);
+        mix(function.arity);
+        mix(function.local_count);
+    }
+    mix(program.string_switches.size());
+    for (const Program::StringSwitch& string_switch : program.string_switches)
+    {
+        mix(string_switch.default_target);
+        mix(string_switch.cases.size());
+        for (const Program::StringSwitch::Case& string_case : string_switch.cases)
+        {
+            mix((static_cast<std::uint64_t>(string_case.constant) << 32U) | string_case.target);
+        }
+    }
+    mix(natives.size());
+    for (const NativeSignature& native : natives)
+    {
+        mix(native.arity);
+        mix(native.name.size());
+        for (const char c : native.name)
+        {
+            mix(static_cast<unsigned char>(c));
+        }
+    }
+    return hash;
+}
+
+// Converts owned payloads in place to their shared forms and returns a copy that shares them. Payloads inside the
+// source arena are copied out, since the fork's arena is a different one.
+[[nodiscard]] auto share_for_fork(Value& value, const Arena& arena) -> Value
+{
+    if (value.is_string_view() && arena.contains(value.as_string_view().data()))
+    {
+        return Value::shared_string(SharedString(std::string(value.as_string_view())));
+    }
+    else if (value.is_borrowed_buffer() && arena.contains(value.as_borrowed_buffer().data()))
+    {
+        return Value::shared_buffer(SharedBuffer::copy_of(value.as_borrowed_buffer()));
+    }
+    return value.share();
+}
+} // namespace
+
+void BufferDeleter::operator()(std::byte* bytes) const noexcept
+{
+    if (size_class != unpooled && release_pooled_block(size_class, bytes))
+    {
+        return;
+    }
+    delete[] bytes;
+}
+
+MoveBuffer::MoveBuffer(std::size_t byte_count)
+    : MoveBuffer(uninitialized(byte_count))
+{
+    if (byte_count != 0)
+    {
+        std::memset(data.get(), 0, byte_count);
+    }
+}
+
+MoveBuffer::MoveBuffer(std::unique_ptr<std::byte[]> bytes, std::size_t byte_count) noexcept
+    : data(bytes.release(), BufferDeleter {})
+    , size(byte_count)
+{
+}
+
+auto MoveBuffer::uninitialized(std::size_t byte_count) -> MoveBuffer
+{
+    MoveBuffer buffer;
+    buffer.size = byte_count;
+    if (byte_count == 0)
+    {
+        return buffer;
+    }
+    if (byte_count > buffer_pool_max_bytes)
+    {
+        buffer.data = std::unique_ptr<std::byte[], BufferDeleter>(new std::byte[byte_count], BufferDeleter {});
+        return buffer;
+    }
+
+    const std::uint8_t size_class = buffer_size_class(byte_count);
+    buffer.data = std::unique_ptr<std::byte[], BufferDeleter>(
+        acquire_pooled_block(size_class),
+        BufferDeleter {.size_class = size_class});
+    return buffer;
+}
+
+auto MoveBuffer::bytes() noexcept -> std::span<std::byte>
+{
+    return {data.get(), size};
+}
+
+auto MoveBuffer::bytes() const noexcept -> std::span<const std::byte>
+{
+    return {data.get(), size};
+}
+
+auto MoveBuffer::data_ptr() noexcept -> std::byte*
+{
+    return data.get();
+}
+
+auto MoveBuffer::data_ptr() const noexcept -> const std::byte*
+{
+    return data.get();
+}
+
+SharedBuffer::SharedBuffer(MoveBuffer buffer)
+    : payload_(std::make_shared<MoveBuffer>(std::move(buffer)))
+    , length_(payload_->size)
+{
+}
+
+auto SharedBuffer::copy_of(std::span<const std::byte> bytes) -> SharedBuffer
+{
+    MoveBuffer buffer = MoveBuffer::uninitialized(bytes.size());
+    if (!bytes.empty())
+    {
+        std::copy(bytes.begin(), bytes.end(), buffer.bytes().begin());
+    }
+    return SharedBuffer(std::move(buffer));
+}
+
+auto SharedBuffer::slice(const std::size_t offset, const std::size_t length) const -> SharedBuffer
+{
+    SharedBuffer view = *this;
+    view.offset_ = offset_ + offset;
+    view.length_ = length;
+    return view;
+}
+
+auto SharedBuffer::bytes() const noexcept -> std::span<const std::byte>
+{
+    if (payload_ == nullptr)
+    {
+        return {};
+    }
+    return std::as_const(*payload_).bytes().subspan(offset_, length_);
+}
+
+auto SharedBuffer::size() const noexcept -> std::size_t
+{
+    return payload_ == nullptr ? 0 : length_;
+}
+
+auto SharedBuffer::use_count() const noexcept -> long
+{
+    return payload_.use_count();
+}
+
+auto SharedBuffer::into_move_buffer() && -> MoveBuffer
+{
+    if (payload_ == nullptr)
+    {
+        return {};
+    }
+
+    // Sole owner of the whole payload: nobody else can observe the bytes, so hand them over instead of copying.
+    if (payload_.use_count() == 1 && offset_ == 0 && length_ == payload_->size)
+    {
+        MoveBuffer stolen = std::move(*payload_);
+        payload_.reset();
+        return stolen;
+    }
+
+    const std::span<const std::byte> source = bytes();
+    MoveBuffer copied = MoveBuffer::uninitialized(source.size());
+    if (!source.empty())
+    {
+        std::copy(source.begin(), source.end(), copied.bytes().begin());
+    }
+    payload_.reset();
+    return copied;
+}
+
+SharedString::SharedString(std::string text)
+    : text_(std::make_shared<const std::string>(std::move(text)))
+    , length_(text_->size())
+{
+}
+
+auto SharedString::slice(const std::size_t offset, const std::size_t length) const -> SharedString
+{
+    SharedString view = *this;
+    view.offset_ = offset_ + offset;
+    view.length_ = length;
+    return view;
+}
+
+auto SharedString::view() const noexcept -> std::string_view
+{
+    return text_ == nullptr ? std::string_view {} : std::string_view(*text_).substr(offset_, length_);
+}
+
+auto SharedString::use_count() const noexcept -> long
+{
+    return text_.use_count();
+}
+
+Value::Value(std::int64_t integer) noexcept
+    : storage_(integer)
+{
+}
+
+Value::Value(double floating_point) noexcept
+    : storage_(floating_point)
+{
+}
+
+Value::Value(std::string_view borrowed_text) noexcept
+    : storage_(borrowed_text)
+{
+}
+
+Value::Value(std::string owned_text) noexcept
+    : storage_(std::move(owned_text))
+{
+}
+
+Value::Value(MoveBuffer buffer) noexcept
+    : storage_(std::move(buffer))
+{
+}
+
+Value::Value(SharedString text) noexcept
+    : storage_(std::move(text))
+{
+}
+
+Value::Value(SharedBuffer buffer) noexcept
+    : storage_(std::move(buffer))
+{
+}
+
+Value::Value(std::span<const std::byte> borrowed_bytes) noexcept
+    : storage_(borrowed_bytes)
+{
+}
+
+Value::Value(const Value& other)
+    : storage_(std::visit(
+          Overload {
+              [](std::monostate value) -> Storage { return value; },
+              [](std::int64_t value) -> Storage { return value; },
+              [](double value) -> Storage { return value; },
+              [](std::string_view value) -> Storage { return value; },
+              [](const std::string& value) -> Storage { return value; },
+              [](const MoveBuffer& value) -> Storage {
+                  MoveBuffer copied = MoveBuffer::uninitialized(value.size);
+                  if (value.size != 0)
+                  {
+                      std::copy(value.bytes().begin(), value.bytes().end(), copied.bytes().begin());
+                  }
+                  return Storage(std::move(copied));
+              },
+              [](const SharedString& value) -> Storage { return value; },
+              [](const SharedBuffer& value) -> Storage { return value; },
+              [](std::span<const std::byte> value) -> Storage { return value; }},
+          other.storage_))
+{
+}
+
+auto Value::operator=(const Value& other) -> Value&
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+
+    Value copy(other);
+    storage_ = std::move(copy.storage_);
+    return *this;
+}
+
+auto Value::i64(std::int64_t integer) noexcept -> Value
+{
+    return Value(integer);
+}
+
+auto Value::f64(double floating_point) noexcept -> Value
+{
+    return Value(floating_point);
+}
+
+auto Value::borrowed_string(std::string_view borrowed_text) noexcept -> Value
+{
+    return Value(borrowed_text);
+}
+
+auto Value::owned_string(std::string owned_text) noexcept -> Value
+{
+    return Value(std::move(owned_text));
+}
+
+auto Value::owned_buffer(MoveBuffer buffer) noexcept -> Value
+{
+    return Value(std::move(buffer));
+}
+
+auto Value::shared_string(SharedString text) noexcept -> Value
+{
+    return Value(std::move(text));
+}
+
+auto Value::shared_buffer(SharedBuffer buffer) noexcept -> Value
+{
+    return Value(std::move(buffer));
+}
+
+auto Value::borrowed_buffer(std::span<const std::byte> borrowed_bytes) noexcept -> Value
+{
+    return Value(borrowed_bytes);
+}
+
+auto Value::kind() const noexcept -> Kind
+{
+    return static_cast<Kind>(storage_.index());
+}
+
+auto Value::kind_name(const Kind kind) noexcept -> std::string_view
+{
+    switch (kind)
+    {
+        case Kind::empty:
+            return "empty";
+        case Kind::i64:
+            return "i64";
+        case Kind::f64:
+            return "f64";
+        case Kind::borrowed_string:
+            return "borrowed_string";
+        case Kind::owned_string:
+            return "owned_string";
+        case Kind::buffer:
+            return "buffer";
+        case Kind::shared_string:
+            return "shared_string";
+        case Kind::shared_buffer:
+            return "shared_buffer";
+        case Kind::borrowed_buffer:
+            return "borrowed_buffer";
+    }
+
+    return "unknown";
+}
+
+auto Value::is_empty() const noexcept -> bool
+{
+    return std::holds_alternative<std::monostate>(storage_);
+}
+
+auto Value::is_i64() const noexcept -> bool
+{
+    return std::holds_alternative<std::int64_t>(storage_);
+}
+
+auto Value::is_f64() const noexcept -> bool
+{
+    return std::holds_alternative<double>(storage_);
+}
+
+auto Value::is_string_view() const noexcept -> bool
+{
+    return std::holds_alternative<std::string_view>(storage_);
+}
+
+auto Value::is_owned_string() const noexcept -> bool
+{
+    return std::holds_alternative<std::string>(storage_);
+}
+
+auto Value::is_string() const noexcept -> bool
+{
+    return is_string_view() || is_owned_string() || is_shared_string();
+}
+
+auto Value::is_buffer() const noexcept -> bool
+{
+    return std::holds_alternative<MoveBuffer>(storage_);
+}
+
+auto Value::is_shared_string() const noexcept -> bool
+{
+    return std::holds_alternative<SharedString>(storage_);
+}
+
+auto Value::is_shared_buffer() const noexcept -> bool
+{
+    return std::holds_alternative<SharedBuffer>(storage_);
+}
+
+auto Value::is_borrowed_buffer() const noexcept -> bool
+{
+    return std::holds_alternative<std::span<const std::byte>>(storage_);
+}
+
+auto Value::is_bytes() const noexcept -> bool
+{
+    return is_buffer() || is_shared_buffer() || is_borrowed_buffer();
+}
+
+auto Value::as_i64() -> std::int64_t&
+{
+    return std::get<std::int64_t>(storage_);
+}
+
+auto Value::as_i64() const -> const std::int64_t&
+{
+    return std::get<std::int64_t>(storage_);
+}
+
+auto Value::as_f64() -> double&
+{
+    return std::get<double>(storage_);
+}
+
+auto Value::as_f64() const -> const double&
+{
+    return std::get<double>(storage_);
+}
+
+auto Value::as_string_view() -> std::string_view&
+{
+    return std::get<std::string_view>(storage_);
+}
+
+auto Value::as_string_view() const -> const std::string_view&
+{
+    return std::get<std::string_view>(storage_);
+}
+
+auto Value::as_owned_string() -> std::string&
+{
+    return std::get<std::string>(storage_);
+}
+
+auto Value::as_owned_string() const -> const std::string&
+{
+    return std::get<std::string>(storage_);
+}
+
+auto Value::as_buffer() -> MoveBuffer&
+{
+    return std::get<MoveBuffer>(storage_);
+}
+
+auto Value::as_buffer() const -> const MoveBuffer&
+{
     return std::get<MoveBuffer>(storage_);
 }
 
-auto Value::as_buffer() const -> const MoveBuffer&
-{
-    return std::get<MoveBuffer>(storage_);
-}
+auto Value::as_shared_string() const -> const SharedString&
+{
+    return std::get<SharedString>(storage_);
+}
+
+auto Value::as_shared_buffer() const -> const SharedBuffer&
+{
+    return std::get<SharedBuffer>(storage_);
+}
+
+auto Value::as_borrowed_buffer() const -> const std::span<const std::byte>&
+{
+    return std::get<std::span<const std::byte>>(storage_);
+}
+
+auto Value::expect_i64(std::string_view context) const -> Result<std::int64_t>
+{
+    if (is_i64())
+    {
+        return as_i64();
+    }
+
+    std::string message(context);
+    message += " expected i64 but got ";
+    message += kind_name(kind());
+    message += '.';
+    return make_unexpected(ErrorCode::type_mismatch, std::move(message));
+}
+
+auto Value::expect_f64(std::string_view context) const -> Result<double>
+{
+    if (is_f64())
+    {
+        return as_f64();
+    }
+
+    std::string message(context);
+    message += " expected f64 but got ";
+    message += kind_name(kind());
+    message += '.';
+    return make_unexpected(ErrorCode::type_mismatch, std::move(message));
+}
+
+auto Value::expect_string(std::string_view context) const -> Result<std::string_view>
+{
+    if (is_string_view())
+    {
+        return as_string_view();
+    }
+    if (is_owned_string())
+    {
+        return as_owned_string();
+    }
+    if (is_shared_string())
+    {
+        return as_shared_string().view();
+    }
+
+    std::string message(context);
+    message += " expected string but got ";
+    message += kind_name(kind());
+    message += '.';
+    return make_unexpected(ErrorCode::type_mismatch, std::move(message));
+}
+
+auto Value::expect_bytes(std::string_view context) const -> Result<std::span<const std::byte>>
+{
+    if (is_buffer())
+    {
+        return as_buffer().bytes();
+    }
+    if (is_shared_buffer())
+    {
+        return as_shared_buffer().bytes();
+    }
+    if (is_borrowed_buffer())
+    {
+        return as_borrowed_buffer();
+    }
+
+    std::string message(context);
+    message += " expected buffer but got ";
+    message += kind_name(kind());
+    message += '.';
+    return make_unexpected(ErrorCode::type_mismatch, std::move(message));
+}
+
+auto Value::take_buffer() -> Result<MoveBuffer>
+{
+    if (is_shared_buffer())
+    {
+        // Copy-on-write: the payload is stolen only when this Value holds the last reference.
+        MoveBuffer buffer = std::move(std::get<SharedBuffer>(storage_)).into_move_buffer();
+        storage_ = std::monostate {};
+        return buffer;
+    }
+    if (is_borrowed_buffer())
+    {
+        const std::span<const std::byte> borrowed = as_borrowed_buffer();
+        MoveBuffer buffer = MoveBuffer::uninitialized(borrowed.size());
+        if (!borrowed.empty())
+        {
+            std::copy(borrowed.begin(), borrowed.end(), buffer.bytes().begin());
+        }
+        storage_ = std::monostate {};
+        return buffer;
+    }
+    if (!is_buffer())
+    {
+        return make_unexpected(
+            ErrorCode::invalid_buffer_access,
+            "Attempted to take MoveBuffer from non-buffer Value.");
+    }
+
+    MoveBuffer buffer = std::move(std::get<MoveBuffer>(storage_));
+    storage_ = std::monostate {};
+    return buffer;
+}
+
+auto Value::share_buffer() -> Result<SharedBuffer>
+{
+    if (is_shared_buffer())
+    {
+        return as_shared_buffer();
+    }
+    if (is_borrowed_buffer())
+    {
+        SharedBuffer shared = SharedBuffer::copy_of(as_borrowed_buffer());
+        storage_ = shared;
+        return shared;
+    }
+    if (!is_buffer())
+    {
+        return make_unexpected(
+            ErrorCode::invalid_buffer_access,
+            "Attempted to share MoveBuffer from non-buffer Value.");
+    }
+
+    SharedBuffer shared(std::move(std::get<MoveBuffer>(storage_)));
+    storage_ = shared;
+    return shared;
+}
+
+auto Value::share() -> Value
+{
+    if (is_owned_string())
+    {
+        storage_ = SharedString(std::move(as_owned_string()));
+    }
+    else if (is_buffer())
+    {
+        storage_ = SharedBuffer(std::move(std::get<MoveBuffer>(storage_)));
+    }
+    return *this;
+}
+
+Arena::Marker::Marker(Arena* arena, DestructorRecord* rewind_to, const Position position) noexcept
+    : arena_(arena)
+    , rewind_to_(rewind_to)
+    , position_(position)
+{
+}
+
+Arena::Marker::~Marker()
+{
+    if (arena_ != nullptr)
+    {
+        arena_->rewind(rewind_to_, position_);
+    }
+}
+
+Arena::Marker::Marker(Marker&& other) noexcept
+    : arena_(std::exchange(other.arena_, nullptr))
+    , rewind_to_(std::exchange(other.rewind_to_, nullptr))
+    , position_(std::exchange(other.position_, Position {}))
+{
+}
+
+auto Arena::Marker::operator=(Marker&& other) noexcept -> Marker&
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+
+    if (arena_ != nullptr)
+    {
+        arena_->rewind(rewind_to_, position_);
+    }
+
+    arena_ = std::exchange(other.arena_, nullptr);
+    rewind_to_ = std::exchange(other.rewind_to_, nullptr);
+    position_ = std::exchange(other.position_, Position {});
+    return *this;
+}
+
+void Arena::Marker::release() noexcept
+{
+    arena_ = nullptr;
+}
+
+Arena::Arena(std::size_t initial_bytes, std::pmr::memory_resource* upstream)
+    : upstream_(upstream)
+    , initial_bytes_(initial_bytes)
+    , next_block_bytes_((std::max)(initial_bytes, arena_min_block_bytes))
+{
+    if (initial_bytes != 0)
+    {
+        grow(initial_bytes);
+    }
+}
+
+Arena::~Arena()
+{
+    rewind(nullptr);
+    release_blocks(0);
+}
+
+auto Arena::mark() noexcept -> Marker
+{
+    return Marker(this, destructors_, top_);
+}
+
+void Arena::reset() noexcept
+{
+    rewind(nullptr);
+    release_blocks(initial_bytes_ == 0 ? 0 : 1);
+    top_ = {};
+    next_block_bytes_ = (std::max)(initial_bytes_, arena_min_block_bytes);
+}
+
+auto Arena::live_allocations() const noexcept -> std::size_t
+{
+    return live_objects_;
+}
+
+auto Arena::copy_string(std::string_view text) -> std::string_view
+{
+    if (text.empty())
+    {
+        return {};
+    }
+
+    auto* memory = static_cast<char*>(allocate_bytes(text.size(), alignof(char)));
+    std::memcpy(memory, text.data(), text.size());
+    return {memory, text.size()};
+}
+
+auto Arena::copy_bytes(std::span<const std::byte> bytes) -> std::span<std::byte>
+{
+    if (bytes.empty())
+    {
+        return {};
+    }
+
+    auto* memory = static_cast<std::byte*>(allocate_bytes(bytes.size(), alignof(std::max_align_t)));
+    std::memcpy(memory, bytes.data(), bytes.size());
+    return {memory, bytes.size()};
+}
+
+auto Arena::contains(const void* address) const noexcept -> bool
+{
+    const auto* byte_address = static_cast<const std::byte*>(address);
+    const std::less<const std::byte*> before;
+    return std::any_of(blocks_.begin(), blocks_.end(), [&](const std::span<std::byte> block) {
+        return !before(byte_address, block.data()) && before(byte_address, block.data() + block.size());
+    });
+}
+
+void* Arena::allocate_bytes(std::size_t size, std::size_t alignment)
+{
+    for (;; ++top_.block, top_.offset = 0)
+    {
+        if (top_.block == blocks_.size())
+        {
+            grow(size + alignment);
+        }
+
+        const std::span<std::byte> block = blocks_[top_.block];
+        const auto address = reinterpret_cast<std::uintptr_t>(block.data() + top_.offset);
+        const std::size_t padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+        const std::size_t begin = top_.offset + padding;
+        if (begin <= block.size() && size <= block.size() - begin)
+        {
+            top_.offset = begin + size;
+            return block.data() + begin;
+        }
+    }
+}
+
+void Arena::grow(const std::size_t min_bytes)
+{
+    const std::size_t bytes = (std::max)(next_block_bytes_, min_bytes);
+    auto* data = static_cast<std::byte*>(upstream_->allocate(bytes, alignof(std::max_align_t)));
+    try
+    {
+        blocks_.emplace_back(data, bytes);
+    }
+    catch (...)
+    {
+        upstream_->deallocate(data, bytes, alignof(std::max_align_t));
+        throw;
+    }
+    next_block_bytes_ = (std::min)(bytes * 2, (std::max)(bytes, arena_max_block_bytes));
+}
+
+void Arena::release_blocks(const std::size_t keep) noexcept
+{
+    while (blocks_.size() > keep)
+    {
+        const std::span<std::byte> block = blocks_.back();
+        blocks_.pop_back();
+        upstream_->deallocate(block.data(), block.size(), alignof(std::max_align_t));
+    }
+}
+
+auto Arena::allocate_destructor_record() -> DestructorRecord*
+{
+    return new (allocate_bytes(sizeof(DestructorRecord), alignof(DestructorRecord))) DestructorRecord {};
+}
+
+void Arena::register_destructor(
+    DestructorRecord* record,
+    void* objects,
+    std::size_t count,
+    DestroyFunction destroy) noexcept
+{
+    record->objects = objects;
+    record->count = count;
+    record->destroy = destroy;
+    record->previous = destructors_;
+    destructors_ = record;
+    live_objects_ += count;
+}
+
+void Arena::rewind(DestructorRecord* target) noexcept
+{
+    while (destructors_ != nullptr && destructors_ != target)
+    {
+        DestructorRecord* record = destructors_;
+        destructors_ = record->previous;
+        live_objects_ -= record->count;
+        record->destroy(record->objects, record->count);
+    }
+}
+
+void Arena::rewind(DestructorRecord* target, const Position position) noexcept
+{
+    rewind(target);
+
+    // A marker that outlived a reset, or one released out of order, points at or past the top; moving the top
+    // forward would hand out memory that is still in use.
+    const bool behind_top =
+        position.block < top_.block || (position.block == top_.block && position.offset < top_.offset);
+    if (behind_top)
+    {
+        top_ = position;
+    }
+}
+
+auto Program::add_constant(Value value) -> std::size_t
+{
+    // Pool entries are copied on every push_constant, so heap payloads are frozen into refcounted form here.
+    if (value.is_owned_string())
+    {
+        value = Value::shared_string(SharedString(std::move(value.as_owned_string())));
+    }
+    else if (value.is_buffer())
+    {
+        value = Value::shared_buffer(SharedBuffer(std::move(value.as_buffer())));
+    }
+
+    constants.push_back(std::move(value));
+    return constants.size() - 1;
+}
+
+auto Program::add_function(std::uint32_t entry, std::uint32_t arity, std::uint32_t local_count) -> std::size_t
+{
+    functions.push_back({entry, arity, local_count});
+    return functions.size() - 1;
+}
+
+auto serialize_program(const Program& program) -> Result<MoveBuffer>
+{
+    if (program.code.size() > bytecode_max_instruction_count ||
+        program.constants.size() > bytecode_max_constant_count ||
+        program.functions.size() > bytecode_max_function_count)
+    {
+        return make_unexpected(
+            ErrorCode::bytecode_limit_exceeded,
+            "Program exceeds configured bytecode limits.");
+    }
+
+    if (program.code.size() > std::numeric_limits<std::uint32_t>::max() ||
+        program.constants.size() > std::numeric_limits<std::uint32_t>::max() ||
+        program.functions.size() > std::numeric_limits<std::uint32_t>::max())
+    {
+        return make_unexpected(
+            ErrorCode::malformed_bytecode,
+            "Program exceeds bytecode format size limits.");
+    }
+
+    ByteWriter writer;
+    writer.write_u32(bytecode_magic);
+    writer.write_u16(bytecode_version);
+    writer.write_u16(0);
+    writer.write_u32(static_cast<std::uint32_t>(program.code.size()));
+    writer.write_u32(static_cast<std::uint32_t>(program.constants.size()));
+    writer.write_u32(static_cast<std::uint32_t>(program.functions.size()));
+
+    for (const Instruction& instruction : program.code)
+    {
+        writer.write_u8(static_cast<std::uint8_t>(instruction.opcode));
+        writer.write_u32(instruction.operand);
+    }
+
+    for (const Value& constant : program.constants)
+    {
+        const VoidResult written = write_constant(writer, constant);
+        if (!written.has_value())
+        {
+            return std::unexpected(written.error());
+        }
+    }
+
+    for (const Program::Function& function : program.functions)
+    {
+        writer.write_u32(function.entry);
+        writer.write_u32(function.arity);
+        writer.write_u32(function.local_count);
+    }
+
+    std::size_t switch_cases = 0;
+    for (const Program::StringSwitch& string_switch : program.string_switches)
+    {
+        switch_cases += string_switch.cases.size() + 1;
+    }
+    if (switch_cases > bytecode_max_switch_case_count)
+    {
+        return make_unexpected(ErrorCode::bytecode_limit_exceeded, "String switch tables exceed configured limits.");
+    }
+    writer.write_u32(static_cast<std::uint32_t>(program.string_switches.size()));
+    for (const Program::StringSwitch& string_switch : program.string_switches)
+    {
+        writer.write_u32(string_switch.default_target);
+        writer.write_u32(static_cast<std::uint32_t>(string_switch.cases.size()));
+        for (const Program::StringSwitch::Case& string_case : string_switch.cases)
+        {
+            writer.write_u32(string_case.constant);
+            writer.write_u32(string_case.target);
+        }
+    }
+
+    MoveBuffer encoded = writer.finish();
+    if (encoded.size > bytecode_max_total_bytes)
+    {
+        return make_unexpected(ErrorCode::bytecode_limit_exceeded, "Serialized bytecode exceeds maximum size.");
+    }
+    return encoded;
+}
+
+auto deserialize_program(std::span<const std::byte> bytes) -> Result<Program>
+{
+    if (bytes.size() > bytecode_max_total_bytes)
+    {
+        return make_unexpected(ErrorCode::bytecode_limit_exceeded, "Bytecode payload exceeds maximum size.");
+    }
+
+    ByteReader reader(bytes);
+
+    std::uint32_t magic = 0;
+    std::uint16_t version = 0;
+    std::uint16_t reserved = 0;
+    std::uint32_t instruction_count = 0;
+    std::uint32_t constant_count = 0;
+    std::uint32_t function_count = 0;
+
+    if (!reader.read_u32(magic) || !reader.read_u16(version) || !reader.read_u16(reserved) ||
+        !reader.read_u32(instruction_count) || !reader.read_u32(constant_count) ||
+        !reader.read_u32(function_count))
+    {
+        return make_unexpected(ErrorCode::malformed_bytecode, "Bytecode header is truncated.");
+    }
+
+    if (magic != bytecode_magic)
+    {
+        return make_unexpected(ErrorCode::invalid_bytecode_magic, "Bytecode magic number mismatch.");
+    }
+    if (version != bytecode_version && version != 1)
+    {
+        return make_unexpected(
+            ErrorCode::unsupported_bytecode_version,
+            "Unsupported bytecode version.");
+    }
+    if (reserved != 0)
+    {
+        return make_unexpected(ErrorCode::malformed_bytecode, "Reserved bytecode header bits must be zero.");
+    }
+
+    if (instruction_count > bytecode_max_instruction_count ||
+        constant_count > bytecode_max_constant_count ||
+        function_count > bytecode_max_function_count)
+    {
+        return make_unexpected(ErrorCode::bytecode_limit_exceeded, "Bytecode header exceeds configured limits.");
+    }
+
+    std::uint64_t instruction_bytes = 0;
+    std::uint64_t function_bytes = 0;
+    if (!checked_mul_u64(static_cast<std::uint64_t>(instruction_count), 5ULL, instruction_bytes) ||
+        !checked_mul_u64(static_cast<std::uint64_t>(function_count), 12ULL, function_bytes))
+    {
+        return make_unexpected(ErrorCode::malformed_bytecode, "Bytecode section sizes overflow.");
+    }
+
+    const std::uint64_t minimum_remaining = instruction_bytes + function_bytes + constant_count;
+    if (minimum_remaining > reader.remaining())
+    {
+        return make_unexpected(ErrorCode::malformed_bytecode, "Bytecode payload is truncated.");
+    }
+
+    Program program;
+    program.code.reserve(instruction_count);
+    program.constants.reserve(constant_count);
+    program.functions.reserve(function_count);
+
+    for (std::uint32_t i = 0; i < instruction_count; ++i)
+    {
+        std::uint8_t opcode_raw = 0;
+        std::uint32_t operand = 0;
+        if (!reader.read_u8(opcode_raw) || !reader.read_u32(operand))
+        {
+            return make_unexpected(ErrorCode::malformed_bytecode, "Instruction table is truncated.");
+        }
+
+        program.code.push_back({static_cast<OpCode>(opcode_raw), operand});
+    }
 
-auto Value::expect_i64(std::string_view context) const -> Result<std::int64_t>
-{
-    if (is_i64())
+    for (std::uint32_t i = 0; i < constant_count; ++i)
     {
-        return as_i64();
+        Result<Value> constant = read_constant(reader);
+        if (!constant.has_value())
+        {
+            return std::unexpected(constant.error());
+        }
+        program.constants.push_back(std::move(constant).value());
     }
 
-    std::string message(context);
-    message += " expected i64 but got ";
-    message += kind_name(kind());
-    message += '.';
-    return make_unexpected(ErrorCode::type_mismatch, std::move(message));
+    for (std::uint32_t i = 0; i < function_count; ++i)
+    {
+        std::uint32_t entry = 0;
+        std::uint32_t arity = 0;
+        std::uint32_t local_count = 0;
+
+        if (!reader.read_u32(entry) || !reader.read_u32(arity) || !reader.read_u32(local_count))
+        {
+            return make_unexpected(ErrorCode::malformed_bytecode, "Function table is truncated.");
+        }
+
+        program.functions.push_back({entry, arity, local_count});
+    }
+
+    if (version >= 2)
+    {
+        std::uint32_t switch_count = 0;
+        if (!reader.read_u32(switch_count))
+        {
+            return make_unexpected(ErrorCode::malformed_bytecode, "String switch table count is truncated.");
+        }
+
+        // Every table costs at least eight bytes and one budgeted entry, so both checks bound the reservation.
+        std::uint64_t switch_budget = switch_count;
+        if (switch_count > bytecode_max_switch_case_count || switch_count > reader.remaining() / 8)
+        {
+            return make_unexpected(
+                ErrorCode::bytecode_limit_exceeded,
+                "String switch tables exceed configured limits.");
+        }
+        program.string_switches.reserve(switch_count);
+        for (std::uint32_t i = 0; i < switch_count; ++i)
+        {
+            Program::StringSwitch string_switch;
+            std::uint32_t case_count = 0;
+            if (!reader.read_u32(string_switch.default_target) || !reader.read_u32(case_count))
+            {
+                return make_unexpected(ErrorCode::malformed_bytecode, "String switch table is truncated.");
+            }
+            switch_budget += case_count;
+            if (switch_budget > bytecode_max_switch_case_count || case_count > reader.remaining() / 8)
+            {
+                return make_unexpected(
+                    ErrorCode::bytecode_limit_exceeded,
+                    "String switch tables exceed configured limits.");
+            }
+
+            string_switch.cases.reserve(case_count);
+            for (std::uint32_t c = 0; c < case_count; ++c)
+            {
+                Program::StringSwitch::Case string_case;
+                if (!reader.read_u32(string_case.constant) || !reader.read_u32(string_case.target))
+                {
+                    return make_unexpected(ErrorCode::malformed_bytecode, "String switch case is truncated.");
+                }
+                string_switch.cases.push_back(string_case);
+            }
+            program.string_switches.push_back(std::move(string_switch));
+        }
+    }
+
+    if (reader.remaining() != 0)
+    {
+        return make_unexpected(
+            ErrorCode::malformed_bytecode,
+            "Bytecode payload has trailing bytes.");
+    }
+
+    program.intern_strings();
+    return program;
 }
 
-auto Value::expect_string(std::string_view context) const -> Result<std::string_view>
+VM::VM(std::size_t stack_reserve, std::size_t arena_bytes, std::pmr::memory_resource* resource)
+    : arena_(arena_bytes, resource)
+    , stack_(resource)
+    , inputs_(resource)
+    , input_views_(resource)
+    , records_(resource)
+    , call_frames_(resource)
 {
-    if (is_string_view())
+    stack_.reserve(stack_reserve);
+    call_frames_.reserve(16);
+}
+
+auto RecordSchema::make(const void* record_tag, std::vector<RecordField> fields) -> Result<RecordSchema>
+{
+    if (fields.size() > max_record_fields)
     {
-        return as_string_view();
+        return make_unexpected(ErrorCode::invalid_field_index, "Record schema declares too many fields.");
     }
-    if (is_owned_string())
+
+    for (std::size_t i = 0; i < fields.size(); ++i)
     {
-        return as_owned_string();
+        if (fields[i].record_tag != record_tag || fields[i].address == nullptr)
+        {
+            std::string message = "Record field '";
+            message += fields[i].name;
+            message += "' belongs to a different record type.";
+            return make_unexpected(ErrorCode::type_mismatch, std::move(message));
+        }
+        for (std::size_t j = 0; j < i; ++j)
+        {
+            if (fields[j].name == fields[i].name)
+            {
+                std::string message = "Record schema declares field '";
+                message += fields[i].name;
+                message += "' twice.";
+                return make_unexpected(ErrorCode::invalid_field_index, std::move(message));
+            }
+        }
     }
 
-    std::string message(context);
-    message += " expected string but got ";
-    message += kind_name(kind());
-    message += '.';
-    return make_unexpected(ErrorCode::type_mismatch, std::move(message));
+    RecordSchema schema;
+    schema.record_tag_ = record_tag;
+    schema.fields_ = std::move(fields);
+    return schema;
 }
 
-auto Value::take_buffer() -> Result<MoveBuffer>
+auto RecordSchema::fields() const noexcept -> std::span<const RecordField>
 {
-    if (!is_buffer())
+    return fields_;
+}
+
+auto RecordSchema::find(std::string_view name) const noexcept -> std::optional<std::uint32_t>
+{
+    for (std::size_t i = 0; i < fields_.size(); ++i)
     {
-        return make_unexpected(
-            ErrorCode::invalid_buffer_access,
-            "Attempted to take MoveBuffer from non-buffer Value.");
+        if (fields_[i].name == name)
+        {
+            return static_cast<std::uint32_t>(i);
+        }
     }
+    return std::nullopt;
+}
 
-    MoveBuffer buffer = std::move(std::get<MoveBuffer>(storage_));
-    storage_ = std::monostate {};
-    return buffer;
+auto RecordSchema::record_tag() const noexcept -> const void*
+{
+    return record_tag_;
 }
 
-Arena::Marker::Marker(Arena* arena, std::size_t rewind_to) noexcept
-    : arena_(arena)
-    , rewind_to_(rewind_to)
+InputView::InputView(const std::int64_t& integer) noexcept
+    : source_(&integer)
 {
 }
 
-Arena::Marker::~Marker()
+InputView::InputView(const double& floating_point) noexcept
+    : source_(&floating_point)
 {
-    if (arena_ != nullptr)
+}
+
+InputView::InputView(const std::string_view& text) noexcept
+    : source_(&text)
+{
+}
+
+InputView::InputView(const std::string& text) noexcept
+    : source_(&text)
+{
+}
+
+InputView::InputView(const std::span<const std::byte>& bytes) noexcept
+    : source_(&bytes)
+{
+}
+
+auto InputView::bytes(std::span<const std::byte> bytes) noexcept -> InputView
+{
+    InputView view;
+    view.source_ = bytes;
+    return view;
+}
+
+auto InputView::bound() const noexcept -> bool
+{
+    return !std::holds_alternative<std::monostate>(source_);
+}
+
+auto InputView::read() const noexcept -> Value
+{
+    return std::visit(
+        Overload {
+            [](std::monostate) { return Value {}; },
+            [](const std::int64_t* integer) { return Value::i64(*integer); },
+            [](const double* floating_point) { return Value::f64(*floating_point); },
+            [](const std::string_view* text) { return Value::borrowed_string(*text); },
+            [](const std::string* text) { return Value::borrowed_string(*text); },
+            [](const std::span<const std::byte>* bytes) { return Value::borrowed_buffer(*bytes); },
+            [](std::span<const std::byte> bytes) { return Value::borrowed_buffer(bytes); }},
+        source_);
+}
+
+NativeBindingBuilder::NativeBindingBuilder(VM& vm, std::string name)
+    : vm_(&vm)
+    , name_(std::move(name))
+{
+}
+
+auto NativeBindingBuilder::arity(const std::size_t expected_arity) -> NativeBindingBuilder&
+{
+    explicit_arity_ = expected_arity;
+    return *this;
+}
+
+auto NativeBindingBuilder::pure(const bool is_pure) -> NativeBindingBuilder&
+{
+    pure_ = is_pure;
+    return *this;
+}
+
+auto VM::bind_native(std::string name, std::size_t arity, NativeFunction function, const bool pure) -> std::size_t
+{
+    native_bindings_.push_back({std::move(name), arity, std::move(function), pure, {}, {}});
+    ++native_bindings_generation_;
+    return native_bindings_.size() - 1;
+}
+
+auto VM::bind_async_native(std::string name, std::size_t arity, AsyncNativeFunction function) -> std::size_t
+{
+    const std::size_t index = native_bindings_.size();
+    NativeFunction blocking = [index](VM& vm, std::span<Value> args) -> Result<Value> {
+        const PendingValue pending = vm.native_bindings_[index].async_function(vm, args);
+        if (!pending)
+        {
+            return make_unexpected(ErrorCode::empty_native_binding, "Async native returned an empty pending value.");
+        }
+        pending.wait();
+        return pending.take();
+    };
+    native_bindings_.push_back({std::move(name), arity, std::move(blocking), false, std::move(function), {}});
+    ++native_bindings_generation_;
+    return index;
+}
+
+auto VM::bind_batch_native(std::string name, std::size_t arity, BatchNativeFunction function, const bool pure)
+    -> std::size_t
+{
+    const std::size_t index = native_bindings_.size();
+    // Row-at-a-time callers see a one-row batch; each column views the argument's own i64 payload.
+    NativeFunction single_row = [index, columns = std::vector<std::span<const std::int64_t>>()](
+                                    VM& vm,
+                                    std::span<Value> args) mutable -> Result<Value> {
+        columns.clear();
+        for (const Value& arg : args)
+        {
+            if (!arg.is_i64())
+            {
+                return make_unexpected(
+                    ErrorCode::type_mismatch,
+                    "Batch native '" + vm.native_bindings_[index].name + "' expects i64 arguments.");
+            }
+            columns.emplace_back(&arg.as_i64(), 1);
+        }
+
+        std::int64_t result = 0;
+        const VoidResult called =
+            vm.native_bindings_[index].batch_function(columns, std::span<std::int64_t>(&result, 1));
+        if (!called.has_value())
+        {
+            return std::unexpected(called.error());
+        }
+        return Value::i64(result);
+    };
+    native_bindings_.push_back({std::move(name), arity, std::move(single_row), pure, {}, std::move(function)});
+    ++native_bindings_generation_;
+    return index;
+}
+
+auto VM::native(std::string name) -> NativeBindingBuilder
+{
+    return NativeBindingBuilder(*this, std::move(name));
+}
+
+auto VM::native_signatures() const -> std::vector<NativeSignature>
+{
+    std::vector<NativeSignature> signatures;
+    signatures.reserve(native_bindings_.size());
+    for (const NativeBinding& binding : native_bindings_)
     {
-        arena_->rewind(rewind_to_);
+        signatures.push_back({binding.name, binding.arity});
     }
+    return signatures;
 }
 
-Arena::Marker::Marker(Marker&& other) noexcept
-    : arena_(std::exchange(other.arena_, nullptr))
-    , rewind_to_(std::exchange(other.rewind_to_, 0))
+auto VM::push_input(Value value) -> std::size_t
+{
+    inputs_.push_back(std::move(value));
+    input_views_.emplace_back();
+    return inputs_.size() - 1;
+}
+
+auto VM::bind_input(InputView view) -> std::size_t
 {
+    inputs_.emplace_back();
+    input_views_.push_back(view);
+    return inputs_.size() - 1;
 }
 
-auto Arena::Marker::operator=(Marker&& other) noexcept -> Marker&
+auto VM::bind_inputs(std::span<const std::int64_t> integers) -> std::size_t
 {
-    if (this == &other)
+    const std::size_t first = inputs_.size();
+    inputs_.resize(first + integers.size());
+    input_views_.reserve(first + integers.size());
+    for (const std::int64_t& integer : integers)
     {
-        return *this;
+        input_views_.emplace_back(integer);
     }
+    return first;
+}
 
-    if (arena_ != nullptr)
+auto VM::rebind_input(std::size_t index, InputView view) -> VoidResult
+{
+    if (index >= inputs_.size())
     {
-        arena_->rewind(rewind_to_);
+        return make_unexpected(ErrorCode::invalid_input_index, "rebind_input index out of range.");
     }
 
-    arena_ = std::exchange(other.arena_, nullptr);
-    rewind_to_ = std::exchange(other.rewind_to_, 0);
-    return *this;
+    inputs_[index] = Value {};
+    input_views_[index] = view;
+    return {};
 }
 
-void Arena::Marker::release() noexcept
+void VM::clear_inputs()
 {
-    arena_ = nullptr;
+    inputs_.clear();
+    input_views_.clear();
 }
 
-Arena::Arena(std::size_t initial_bytes)
-    : initial_buffer_(initial_bytes)
-    , resource_(
-          initial_buffer_.empty() ? nullptr : initial_buffer_.data(),
-          initial_buffer_.size(),
-          std::pmr::new_delete_resource())
+void VM::clear_records()
 {
+    records_.clear();
 }
 
-Arena::~Arena()
+auto VM::record_bindings() const noexcept -> std::span<const RecordBinding>
 {
-    reset();
+    return records_;
 }
 
-auto Arena::mark() noexcept -> Marker
+void VM::clear_stack()
 {
-    return Marker(this, tracked_allocations_.size());
+    stack_.clear();
+    suspended_program_ = nullptr;
+    yielded_ = false;
+    awaiting_native_ = {};
+    // An abandoned suspended run also gives back the arena scope its transient payloads live in.
+    suspended_scope_ = Arena::Marker {};
+    suspended_scope_active_ = false;
 }
 
-void Arena::reset() noexcept
+void VM::reset() noexcept
 {
-    rewind(0);
-    resource_.release();
+    stack_.clear();
+    inputs_.clear();
+    input_views_.clear();
+    records_.clear();
+    call_frames_.clear();
+    suspended_program_ = nullptr;
+    yielded_ = false;
+    awaiting_native_ = {};
+    suspended_scope_.release();
+    suspended_scope_active_ = false;
+    arena_.reset();
+    reset_profile();
 }
 
-auto Arena::live_allocations() const noexcept -> std::size_t
+auto VM::stack() noexcept -> std::span<Value>
 {
-    return static_cast<std::size_t>(std::count_if(
-        tracked_allocations_.begin(),
-        tracked_allocations_.end(),
-        [](const TrackedAllocation& tracked) { return tracked.alive; }));
+    return stack_;
 }
 
-void* Arena::allocate_bytes(std::size_t size, std::size_t alignment)
+auto VM::stack() const noexcept -> std::span<const Value>
+{
+    return stack_;
+}
+
+auto VM::arena() noexcept -> Arena&
+{
+    return arena_;
+}
+
+auto VM::arena() const noexcept -> const Arena&
+{
+    return arena_;
+}
+
+void VM::set_arena_payloads_enabled(const bool enabled) noexcept
+{
+    arena_payloads_enabled_ = enabled;
+}
+
+auto VM::arena_payloads_enabled() const noexcept -> bool
+{
+    return arena_payloads_enabled_;
+}
+
+auto VM::transient_string(std::string_view text) -> Value
+{
+    if (!arena_payloads_enabled_)
+    {
+        return Value::owned_string(std::string(text));
+    }
+    return Value::borrowed_string(arena_.copy_string(text));
+}
+
+auto VM::transient_buffer(std::span<const std::byte> bytes) -> Value
+{
+    if (!arena_payloads_enabled_)
+    {
+        MoveBuffer buffer = MoveBuffer::uninitialized(bytes.size());
+        if (!bytes.empty())
+        {
+            std::copy(bytes.begin(), bytes.end(), buffer.bytes().begin());
+        }
+        return Value::owned_buffer(std::move(buffer));
+    }
+    return Value::borrowed_buffer(arena_.copy_bytes(bytes));
+}
+
+void VM::set_step_budget(std::size_t max_steps) noexcept
+{
+    step_budget_ = max_steps;
+}
+
+auto VM::step_budget() const noexcept -> std::size_t
+{
+    return step_budget_;
+}
+
+void VM::clear_step_budget() noexcept
+{
+    step_budget_ = 0;
+}
+
+void VM::set_trace_sink(std::move_only_function<void(const TraceEvent&)> trace_sink)
+{
+    trace_sink_ = std::move(trace_sink);
+}
+
+void VM::clear_trace_sink()
 {
-    return resource_.allocate(size, alignment);
+    trace_sink_ = {};
 }
 
-void Arena::register_destructor(void* object, void (*destroy)(void*) noexcept)
+void VM::set_profiling_enabled(const bool enabled) noexcept
 {
-    tracked_allocations_.push_back({object, destroy, true});
+    profiling_enabled_ = enabled;
 }
 
-void Arena::rewind(std::size_t index) noexcept
+auto VM::profiling_enabled() const noexcept -> bool
 {
-    if (index > tracked_allocations_.size())
-    {
-        index = tracked_allocations_.size();
-    }
-
-    for (std::size_t i = tracked_allocations_.size(); i > index; --i)
-    {
-        TrackedAllocation& tracked = tracked_allocations_[i - 1];
-        if (tracked.alive && tracked.destroy != nullptr)
-        {
-            tracked.destroy(tracked.object);
-            tracked.alive = false;
-        }
-    }
-
-    tracked_allocations_.resize(index);
+    return profiling_enabled_;
 }
 
-auto Program::add_constant(Value value) -> std::size_t
+void VM::reset_profile() noexcept
 {
-    constants.push_back(std::move(value));
-    return constants.size() - 1;
+    profile_stats_ = {};
 }
 
-auto Program::add_function(std::uint32_t entry, std::uint32_t arity, std::uint32_t local_count) -> std::size_t
+auto VM::profile() const noexcept -> const ProfileStats&
 {
-    functions.push_back({entry, arity, local_count});
-    return functions.size() - 1;
+    return profile_stats_;
 }
 
-auto serialize_program(const Program& program) -> Result<MoveBuffer>
+auto VM::verify(const Program& program, std::size_t available_inputs) const -> VoidResult
 {
-    if (program.code.size() > bytecode_max_instruction_count ||
-        program.constants.size() > bytecode_max_constant_count ||
-        program.functions.size() > bytecode_max_function_count)
-    {
-        return make_unexpected(
-            ErrorCode::bytecode_limit_exceeded,
-            "Program exceeds configured bytecode limits.");
-    }
-
-    if (program.code.size() > std::numeric_limits<std::uint32_t>::max() ||
-        program.constants.size() > std::numeric_limits<std::uint32_t>::max() ||
-        program.functions.size() > std::numeric_limits<std::uint32_t>::max())
-    {
-        return make_unexpected(
-            ErrorCode::malformed_bytecode,
-            "Program exceeds bytecode format size limits.");
-    }
-
-    ByteWriter writer;
-    writer.write_u32(bytecode_magic);
-    writer.write_u16(bytecode_version);
-    writer.write_u16(0);
-    writer.write_u32(static_cast<std::uint32_t>(program.code.size()));
-    writer.write_u32(static_cast<std::uint32_t>(program.constants.size()));
-    writer.write_u32(static_cast<std::uint32_t>(program.functions.size()));
-
-    for (const Instruction& instruction : program.code)
+    const VoidResult table_result = validate_function_table(program);
+    if (!table_result.has_value())
+    {
+        return table_result;
+    }
+
+    VerifierScratch scratch;
+    scratch.stack_depth_at_pc.reserve(program.code.size());
+    scratch.worklist.reserve(program.code.size());
+
+    // Top-level code may legitimately jump over function bodies, so it is bounded only by the bytecode end.
+    const auto entry_verify = verify_region(
+        program,
+        native_bindings_,
+        records_,
+        available_inputs,
+        VerifierRegion {.begin = 0, .end = program.code.size()},
+        0,
+        std::nullopt,
+        scratch);
+    if (!entry_verify.has_value())
     {
-        writer.write_u8(static_cast<std::uint8_t>(instruction.opcode));
-        writer.write_u32(instruction.operand);
+        return std::unexpected(entry_verify.error());
     }
 
-    for (const Value& constant : program.constants)
+    const std::vector<VerifierRegion> regions = partition_function_regions(program);
+    const std::vector<bool> redundant = redundant_function_mask(program);
+    std::vector<std::size_t> escaped;
+    VerifierFailure failure;
+    for (std::size_t i = 0; i < program.functions.size(); ++i)
     {
-        if (constant.is_empty())
-        {
-            writer.write_u8(static_cast<std::uint8_t>(ConstantTag::empty));
-            continue;
-        }
-        if (constant.is_i64())
-        {
-            writer.write_u8(static_cast<std::uint8_t>(ConstantTag::i64));
-            writer.write_i64(constant.as_i64());
-            continue;
-        }
-        if (constant.is_f64())
+        if (redundant[i])
         {
-            writer.write_u8(static_cast<std::uint8_t>(ConstantTag::f64));
-            writer.write_f64(constant.as_f64());
             continue;
         }
-        if (constant.is_string())
-        {
-            const auto text_result = constant.expect_string("serialize_program");
-            if (!text_result.has_value())
-            {
-                return std::unexpected(text_result.error());
-            }
-
-            if (text_result->size() > bytecode_max_blob_bytes ||
-                text_result->size() > std::numeric_limits<std::uint32_t>::max())
-            {
-                return make_unexpected(ErrorCode::bytecode_limit_exceeded, "String constant exceeds size limits.");
-            }
 
-            writer.write_u8(static_cast<std::uint8_t>(ConstantTag::string));
-            writer.write_u32(static_cast<std::uint32_t>(text_result->size()));
-            const auto* raw = reinterpret_cast<const std::byte*>(text_result->data());
-            writer.write_bytes(std::span<const std::byte>(raw, text_result->size()));
-            continue;
-        }
-        if (constant.is_buffer())
+        const auto local_count = static_cast<std::size_t>(program.functions[i].local_count);
+        const auto function_verify = verify_region(
+            program,
+            native_bindings_,
+            records_,
+            available_inputs,
+            regions[i],
+            local_count,
+            local_count,
+            scratch);
+        if (!function_verify.has_value())
         {
-            const MoveBuffer& buffer = constant.as_buffer();
-            if (buffer.size > bytecode_max_blob_bytes ||
-                buffer.size > std::numeric_limits<std::uint32_t>::max())
+            if (scratch.left_region)
             {
-                return make_unexpected(ErrorCode::bytecode_limit_exceeded, "Buffer constant exceeds size limits.");
+                escaped.push_back(i);
+                continue;
             }
-
-            writer.write_u8(static_cast<std::uint8_t>(ConstantTag::buffer));
-            writer.write_u32(static_cast<std::uint32_t>(buffer.size));
-            writer.write_bytes(buffer.bytes());
-            continue;
+            failure = VerifierFailure {.function = i, .error = function_verify.error()};
+            break;
         }
-
-        return make_unexpected(
-            ErrorCode::malformed_bytecode,
-            "Encountered unsupported constant kind during serialization.");
     }
 
-    for (const Program::Function& function : program.functions)
+    if (!escaped.empty())
     {
-        writer.write_u32(function.entry);
-        writer.write_u32(function.arity);
-        writer.write_u32(function.local_count);
+        VerifierFailure escaped_failure =
+            verify_escaped_functions(program, native_bindings_, records_, available_inputs, escaped, scratch);
+        if (escaped_failure.function < failure.function)
+        {
+            failure = std::move(escaped_failure);
+        }
     }
-
-    MoveBuffer encoded = writer.finish();
-    if (encoded.size > bytecode_max_total_bytes)
+    if (failure.function != no_verify_failure)
     {
-        return make_unexpected(ErrorCode::bytecode_limit_exceeded, "Serialized bytecode exceeds maximum size.");
+        return std::unexpected(std::move(failure.error));
     }
-    return encoded;
+
+    return {};
 }
 
-auto deserialize_program(std::span<const std::byte> bytes) -> Result<Program>
+auto VM::verify_parallel(const Program& program, std::size_t available_inputs, Executor& executor) const
+    -> VoidResult
 {
-    if (bytes.size() > bytecode_max_total_bytes)
-    {
-        return make_unexpected(ErrorCode::bytecode_limit_exceeded, "Bytecode payload exceeds maximum size.");
-    }
-
-    ByteReader reader(bytes);
-
-    std::uint32_t magic = 0;
-    std::uint16_t version = 0;
-    std::uint16_t reserved = 0;
-    std::uint32_t instruction_count = 0;
-    std::uint32_t constant_count = 0;
-    std::uint32_t function_count = 0;
-
-    if (!reader.read_u32(magic) || !reader.read_u16(version) || !reader.read_u16(reserved) ||
-        !reader.read_u32(instruction_count) || !reader.read_u32(constant_count) ||
-        !reader.read_u32(function_count))
-    {
-        return make_unexpected(ErrorCode::malformed_bytecode, "Bytecode header is truncated.");
-    }
-
-    if (magic != bytecode_magic)
-    {
-        return make_unexpected(ErrorCode::invalid_bytecode_magic, "Bytecode magic number mismatch.");
-    }
-    if (version != bytecode_version)
-    {
-        return make_unexpected(
-            ErrorCode::unsupported_bytecode_version,
-            "Unsupported bytecode version.");
-    }
-    if (reserved != 0)
+    const std::size_t worker_count = executor.concurrency();
+    if (worker_count <= 1 || program.code.size() < parallel_verify_min_instructions)
     {
-        return make_unexpected(ErrorCode::malformed_bytecode, "Reserved bytecode header bits must be zero.");
+        return verify(program, available_inputs);
     }
 
-    if (instruction_count > bytecode_max_instruction_count ||
-        constant_count > bytecode_max_constant_count ||
-        function_count > bytecode_max_function_count)
+    const VoidResult table_result = validate_function_table(program);
+    if (!table_result.has_value())
     {
-        return make_unexpected(ErrorCode::bytecode_limit_exceeded, "Bytecode header exceeds configured limits.");
+        return table_result;
     }
 
-    std::uint64_t instruction_bytes = 0;
-    std::uint64_t function_bytes = 0;
-    if (!checked_mul_u64(static_cast<std::uint64_t>(instruction_count), 5ULL, instruction_bytes) ||
-        !checked_mul_u64(static_cast<std::uint64_t>(function_count), 12ULL, function_bytes))
-    {
-        return make_unexpected(ErrorCode::malformed_bytecode, "Bytecode section sizes overflow.");
-    }
+    const std::vector<VerifierRegion> regions = partition_function_regions(program);
+    const std::vector<bool> redundant = redundant_function_mask(program);
 
-    const std::uint64_t minimum_remaining = instruction_bytes + function_bytes + constant_count;
-    if (minimum_remaining > reader.remaining())
+    // Rank 0 is the top-level pass and rank i + 1 is function i, matching the order verify() reports in.
+    struct VerifyChunk final
     {
-        return make_unexpected(ErrorCode::malformed_bytecode, "Bytecode payload is truncated.");
-    }
+        std::size_t first_rank = 0;
+        std::size_t end_rank = 0;
+        std::size_t failed_rank = no_verify_failure;
+        Error error {};
+        std::exception_ptr thrown {};
+        std::vector<std::size_t> escaped {};
+    };
 
-    Program program;
-    program.code.reserve(instruction_count);
-    program.constants.reserve(constant_count);
-    program.functions.reserve(function_count);
+    const std::size_t target_instructions =
+        (std::max)(program.code.size() / (worker_count * 4), parallel_verify_min_chunk_instructions);
 
-    for (std::uint32_t i = 0; i < instruction_count; ++i)
+    std::vector<VerifyChunk> chunks;
+    chunks.push_back({.first_rank = 0, .end_rank = 1});
+    std::size_t chunk_begin = 1;
+    std::size_t chunk_instructions = 0;
+    for (std::size_t i = 0; i < program.functions.size(); ++i)
     {
-        std::uint8_t opcode_raw = 0;
-        std::uint32_t operand = 0;
-        if (!reader.read_u8(opcode_raw) || !reader.read_u32(operand))
+        chunk_instructions += regions[i].end - regions[i].begin;
+        if (chunk_instructions >= target_instructions)
         {
-            return make_unexpected(ErrorCode::malformed_bytecode, "Instruction table is truncated.");
+            chunks.push_back({.first_rank = chunk_begin, .end_rank = i + 2});
+            chunk_begin = i + 2;
+            chunk_instructions = 0;
         }
-
-        program.code.push_back({static_cast<OpCode>(opcode_raw), operand});
     }
-
-    for (std::uint32_t i = 0; i < constant_count; ++i)
+    if (chunk_begin <= program.functions.size())
     {
-        std::uint8_t tag_raw = 0;
-        if (!reader.read_u8(tag_raw))
-        {
-            return make_unexpected(ErrorCode::malformed_bytecode, "Constant table is truncated.");
-        }
+        chunks.push_back({.first_rank = chunk_begin, .end_rank = program.functions.size() + 1});
+    }
 
-        switch (static_cast<ConstantTag>(tag_raw))
+    // The caller claims chunks alongside the executor tasks, so the call finishes even from inside a worker of a
+    // saturated executor. Tasks that start after every chunk is claimed touch only the shared counter.
+    const auto next_chunk = std::make_shared<std::atomic<std::size_t>>(0);
+    std::atomic<std::size_t> lowest_failed_rank {no_verify_failure};
+    std::latch done(static_cast<std::ptrdiff_t>(chunks.size()));
+
+    const auto verify_chunk = [&](VerifyChunk& chunk) {
+        VerifierScratch scratch;
+        for (std::size_t rank = chunk.first_rank; rank < chunk.end_rank; ++rank)
         {
-            case ConstantTag::empty:
-                program.constants.push_back(Value {});
-                break;
-            case ConstantTag::i64:
+            if (rank > lowest_failed_rank.load(std::memory_order_relaxed))
             {
-                std::int64_t value = 0;
-                if (!reader.read_i64(value))
-                {
-                    return make_unexpected(ErrorCode::malformed_bytecode, "i64 constant is truncated.");
-                }
-                program.constants.push_back(Value::i64(value));
-                break;
-            }
-            case ConstantTag::f64:
-            {
-                double value = 0.0;
-                if (!reader.read_f64(value))
-                {
-                    return make_unexpected(ErrorCode::malformed_bytecode, "f64 constant is truncated.");
-                }
-                program.constants.push_back(Value::f64(value));
                 break;
             }
-            case ConstantTag::string:
-            {
-                std::uint32_t length = 0;
-                if (!reader.read_u32(length))
-                {
-                    return make_unexpected(ErrorCode::malformed_bytecode, "String constant length is truncated.");
-                }
-                if (length > bytecode_max_blob_bytes)
-                {
-                    return make_unexpected(ErrorCode::bytecode_limit_exceeded, "String constant exceeds size limits.");
-                }
 
-                std::span<const std::byte> text_bytes;
-                if (!reader.read_bytes(length, text_bytes))
-                {
-                    return make_unexpected(ErrorCode::malformed_bytecode, "String constant payload is truncated.");
-                }
-
-                std::string value;
-                value.resize(length);
-                if (length != 0)
-                {
-                    std::memcpy(value.data(), text_bytes.data(), length);
-                }
-                program.constants.push_back(Value::owned_string(std::move(value)));
-                break;
-            }
-            case ConstantTag::buffer:
+            VoidResult result {};
+            if (rank == 0)
             {
-                std::uint32_t length = 0;
-                if (!reader.read_u32(length))
-                {
-                    return make_unexpected(ErrorCode::malformed_bytecode, "Buffer constant length is truncated.");
-                }
-                if (length > bytecode_max_blob_bytes)
-                {
-                    return make_unexpected(ErrorCode::bytecode_limit_exceeded, "Buffer constant exceeds size limits.");
-                }
-
-                std::span<const std::byte> payload;
-                if (!reader.read_bytes(length, payload))
-                {
-                    return make_unexpected(ErrorCode::malformed_bytecode, "Buffer constant payload is truncated.");
-                }
-
-                MoveBuffer buffer(length);
-                if (length != 0)
-                {
-                    std::copy(payload.begin(), payload.end(), buffer.bytes().begin());
-                }
-                program.constants.push_back(Value::owned_buffer(std::move(buffer)));
-                break;
+                result = verify_region(
+                    program,
+                    native_bindings_,
+                    records_,
+                    available_inputs,
+                    VerifierRegion {.begin = 0, .end = program.code.size()},
+                    0,
+                    std::nullopt,
+                    scratch);
             }
-            default:
+            else if (!redundant[rank - 1])
             {
-                return make_unexpected(
-                    ErrorCode::malformed_bytecode,
-                    "Unknown constant tag in bytecode.");
+                const auto local_count = static_cast<std::size_t>(program.functions[rank - 1].local_count);
+                result = verify_region(
+                    program,
+                    native_bindings_,
+                    records_,
+                    available_inputs,
+                    regions[rank - 1],
+                    local_count,
+                    local_count,
+                    scratch);
             }
-        }
-    }
-
-    for (std::uint32_t i = 0; i < function_count; ++i)
-    {
-        std::uint32_t entry = 0;
-        std::uint32_t arity = 0;
-        std::uint32_t local_count = 0;
-
-        if (!reader.read_u32(entry) || !reader.read_u32(arity) || !reader.read_u32(local_count))
-        {
-            return make_unexpected(ErrorCode::malformed_bytecode, "Function table is truncated.");
-        }
-
-        program.functions.push_back({entry, arity, local_count});
-    }
-
-    if (reader.remaining() != 0)
-    {
-        return make_unexpected(
-            ErrorCode::malformed_bytecode,
-            "Bytecode payload has trailing bytes.");
-    }
-
-    return program;
-}
-
-VM::VM(std::size_t stack_reserve, std::size_t arena_bytes)
-    : arena_(arena_bytes)
-{
-    stack_.reserve(stack_reserve);
-    call_frames_.reserve(16);
-}
-
-NativeBindingBuilder::NativeBindingBuilder(VM& vm, std::string name)
-    : vm_(&vm)
-    , name_(std::move(name))
-{
-}
-
-auto NativeBindingBuilder::arity(const std::size_t expected_arity) -> NativeBindingBuilder&
-{
-    explicit_arity_ = expected_arity;
-    return *this;
-}
-
-auto VM::bind_native(std::string name, std::size_t arity, NativeFunction function) -> std::size_t
-{
-    native_bindings_.push_back({std::move(name), arity, std::move(function)});
-    ++native_bindings_generation_;
-    return native_bindings_.size() - 1;
-}
 
-auto VM::native(std::string name) -> NativeBindingBuilder
-{
-    return NativeBindingBuilder(*this, std::move(name));
-}
-
-auto VM::push_input(Value value) -> std::size_t
-{
-    inputs_.push_back(std::move(value));
-    return inputs_.size() - 1;
-}
-
-void VM::clear_inputs()
-{
-    inputs_.clear();
-}
+            if (!result.has_value() && scratch.left_region)
+            {
+                chunk.escaped.push_back(rank - 1);
+            }
+            else if (!result.has_value())
+            {
+                chunk.failed_rank = rank;
+                chunk.error = std::move(result).error();
 
-void VM::clear_stack()
-{
-    stack_.clear();
-}
+                std::size_t observed = lowest_failed_rank.load(std::memory_order_relaxed);
+                while (rank < observed &&
+                       !lowest_failed_rank.compare_exchange_weak(observed, rank, std::memory_order_relaxed))
+                {
+                }
+                break;
+            }
+        }
+    };
 
-auto VM::stack() noexcept -> std::span<Value>
-{
-    return stack_;
-}
+    // Every claimed chunk counts down exactly once, even if it throws; the exception is rethrown on the caller.
+    const auto claim_chunks = [&, next_chunk, chunk_count = chunks.size()] {
+        for (std::size_t index = next_chunk->fetch_add(1); index < chunk_count; index = next_chunk->fetch_add(1))
+        {
+            struct CountDown final
+            {
+                std::latch& latch;
+                ~CountDown()
+                {
+                    latch.count_down();
+                }
+            } count_down {done};
 
-auto VM::stack() const noexcept -> std::span<const Value>
-{
-    return stack_;
-}
+            try
+            {
+                verify_chunk(chunks[index]);
+            }
+            catch (...)
+            {
+                chunks[index].thrown = std::current_exception();
+                lowest_failed_rank.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
 
-auto VM::arena() noexcept -> Arena&
-{
-    return arena_;
-}
+    for (std::size_t i = 1; i < (std::min)(chunks.size(), worker_count + 1); ++i)
+    {
+        executor.execute(claim_chunks);
+    }
+    claim_chunks();
+    done.wait();
 
-auto VM::arena() const noexcept -> const Arena&
-{
-    return arena_;
-}
+    for (const VerifyChunk& chunk : chunks)
+    {
+        if (chunk.thrown)
+        {
+            std::rethrow_exception(chunk.thrown);
+        }
+    }
 
-void VM::set_step_budget(std::size_t max_steps) noexcept
-{
-    step_budget_ = max_steps;
-}
+    const auto failed = std::min_element(chunks.begin(), chunks.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.failed_rank < rhs.failed_rank;
+    });
 
-void VM::clear_step_budget() noexcept
-{
-    step_budget_ = 0;
-}
+    // Walks that left their region share depth tables across functions, so they finish here on the calling thread.
+    std::vector<std::size_t> escaped;
+    for (const VerifyChunk& chunk : chunks)
+    {
+        for (const std::size_t function : chunk.escaped)
+        {
+            if (function + 1 < failed->failed_rank)
+            {
+                escaped.push_back(function);
+            }
+        }
+    }
+    if (!escaped.empty())
+    {
+        VerifierScratch scratch;
+        VerifierFailure escaped_failure =
+            verify_escaped_functions(program, native_bindings_, records_, available_inputs, escaped, scratch);
+        if (escaped_failure.function != no_verify_failure)
+        {
+            return std::unexpected(std::move(escaped_failure.error));
+        }
+    }
+    if (failed->failed_rank != no_verify_failure)
+    {
+        return std::unexpected(std::move(failed->error));
+    }
 
-void VM::set_trace_sink(std::move_only_function<void(const TraceEvent&)> trace_sink)
-{
-    trace_sink_ = std::move(trace_sink);
+    return {};
 }
 
-void VM::clear_trace_sink()
+auto VerificationState::reverified_regions() const noexcept -> std::size_t
 {
-    trace_sink_ = {};
+    return reverified_regions_;
 }
 
-void VM::set_profiling_enabled(const bool enabled) noexcept
+auto VM::verify_with_state(const Program& program, std::size_t available_inputs) const -> Result<VerificationState>
 {
-    profiling_enabled_ = enabled;
-}
+    const VoidResult table_result = validate_function_table(program);
+    if (!table_result.has_value())
+    {
+        return std::unexpected(table_result.error());
+    }
 
-auto VM::profiling_enabled() const noexcept -> bool
-{
-    return profiling_enabled_;
-}
+    VerificationState state;
+    state.available_inputs_ = available_inputs;
+    state.code_size_ = program.code.size();
+    state.constant_count_ = program.constants.size();
+    state.native_arities_ = native_arity_table(native_bindings_);
+    state.record_schemas_ = record_schema_table(records_);
+    state.functions_ = program.functions;
+    state.string_switches_ = program.string_switches;
+    state.interned_source_ = interned_source_of(program);
+    state.top_level_reach_.assign(program.code.size(), false);
+    state.callees_.resize(program.functions.size() + 1);
+    state.escaped_reach_.resize(program.functions.size());
 
-void VM::reset_profile() noexcept
-{
-    profile_stats_ = {};
-}
+    std::vector<std::size_t> ranks(program.functions.size() + 1);
+    for (std::size_t rank = 0; rank < ranks.size(); ++rank)
+    {
+        ranks[rank] = rank;
+    }
 
-auto VM::profile() const noexcept -> const ProfileStats&
-{
-    return profile_stats_;
+    const VoidResult verified = reverify_regions(program, state, ranks);
+    if (!verified.has_value())
+    {
+        return std::unexpected(verified.error());
+    }
+    return state;
 }
 
-auto VM::verify(const Program& program, std::size_t available_inputs) const -> VoidResult
+auto VM::verify_incremental(const Program& patched, VerificationState base, const ProgramChanges& changes) const
+    -> Result<VerificationState>
 {
-    if (program.code.empty())
+    const VoidResult table_result = validate_function_table(patched);
+    if (!table_result.has_value())
     {
-        return make_unexpected(ErrorCode::verification_failed, "Program has no instructions.");
+        return std::unexpected(table_result.error());
     }
 
-    for (const auto& function : program.functions)
+    // Region boundaries, the native table, bound record schemas, switch tables, the intern table and the input count
+    // shape every region's analysis; if any of them moved, or constants were removed, nothing recorded in the base
+    // state can be trusted.
+    const std::optional<std::uint64_t> interned_source = interned_source_of(patched);
+    bool layout_unchanged = patched.code.size() == base.code_size_ &&
+                            patched.functions.size() == base.functions_.size() &&
+                            patched.constants.size() >= base.constant_count_ &&
+                            patched.string_switches == base.string_switches_ &&
+                            (!base.interned_source_.has_value() || interned_source == base.interned_source_) &&
+                            native_arity_table(native_bindings_) == base.native_arities_ &&
+                            record_schema_table(records_) == base.record_schemas_;
+    for (std::size_t i = 0; layout_unchanged && i < patched.functions.size(); ++i)
     {
-        if (function.entry >= program.code.size())
+        layout_unchanged = patched.functions[i].entry == base.functions_[i].entry;
+    }
+    if (!layout_unchanged)
+    {
+        return verify_with_state(patched, base.available_inputs_);
+    }
+
+    const std::size_t function_count = patched.functions.size();
+    std::vector<bool> dirty(function_count + 1, false);
+
+    for (const std::uint32_t function : changes.functions)
+    {
+        if (function >= function_count)
         {
             return make_unexpected(
                 ErrorCode::invalid_function_index,
-                "Function entry points outside bytecode.");
+                "Changed function index is out of range.");
         }
-        if (function.local_count < function.arity)
+        dirty[static_cast<std::size_t>(function) + 1] = true;
+    }
+
+    const std::vector<VerifierRegion> regions = partition_function_regions(patched);
+    for (const CodeRange& range : changes.code_ranges)
+    {
+        const std::size_t begin = (std::min)(range.begin, patched.code.size());
+        const std::size_t end = (std::min)(range.end, patched.code.size());
+        if (begin >= end)
         {
-            return make_unexpected(
-                ErrorCode::invalid_function_signature,
-                "Function local_count must be >= arity.");
+            continue;
+        }
+
+        if (std::find(base.top_level_reach_.begin() + static_cast<std::ptrdiff_t>(begin),
+                      base.top_level_reach_.begin() + static_cast<std::ptrdiff_t>(end),
+                      true) != base.top_level_reach_.begin() + static_cast<std::ptrdiff_t>(end))
+        {
+            dirty[0] = true;
+        }
+        const auto overlaps = [&](const auto& reach) { return reach.begin < end && begin < reach.end; };
+        for (std::size_t i = 0; i < function_count; ++i)
+        {
+            const std::vector<CodeRange>& escaped_reach = base.escaped_reach_[i];
+            if (overlaps(regions[i]) || std::any_of(escaped_reach.begin(), escaped_reach.end(), overlaps))
+            {
+                dirty[i + 1] = true;
+            }
         }
     }
 
-    const auto verify_entry =
-        [&](const std::size_t entry_pc,
-            const std::size_t initial_stack_depth,
-            const std::optional<std::size_t> frame_local_count) -> VoidResult {
-        std::vector<std::optional<std::size_t>> stack_depth_at_pc(program.code.size());
-        std::optional<std::size_t> stack_depth_at_end;
-        std::vector<std::size_t> worklist;
-        worklist.reserve(program.code.size());
+    std::vector<bool> signature_changed(function_count, false);
+    bool any_signature_changed = false;
+    for (std::size_t i = 0; i < function_count; ++i)
+    {
+        if (patched.functions[i].arity != base.functions_[i].arity ||
+            patched.functions[i].local_count != base.functions_[i].local_count)
+        {
+            signature_changed[i] = true;
+            any_signature_changed = true;
+            dirty[i + 1] = true;
+        }
+    }
 
-        const auto enqueue_successor = [&](const std::size_t pc, const std::size_t depth) -> VoidResult {
-            if (pc == program.code.size())
+    if (any_signature_changed)
+    {
+        for (std::size_t rank = 0; rank <= function_count; ++rank)
+        {
+            for (const std::uint32_t callee : base.callees_[rank])
             {
-                if (frame_local_count.has_value())
+                if (callee < function_count && signature_changed[callee])
                 {
-                    return make_unexpected(
-                        ErrorCode::missing_call_frame,
-                        "Function can fall through bytecode end without ret.");
+                    dirty[rank] = true;
+                    break;
                 }
+            }
+        }
+    }
 
-                if (!stack_depth_at_end.has_value())
-                {
-                    stack_depth_at_end = depth;
-                    return {};
-                }
+    std::vector<std::size_t> ranks;
+    for (std::size_t rank = 0; rank <= function_count; ++rank)
+    {
+        if (dirty[rank])
+        {
+            ranks.push_back(rank);
+        }
+    }
 
-                if (stack_depth_at_end.value() != depth)
-                {
-                    return make_unexpected(
-                        ErrorCode::verification_failed,
-                        "Inconsistent stack depth at implicit program end.");
-                }
+    base.constant_count_ = patched.constants.size();
+    base.functions_ = patched.functions;
+    base.interned_source_ = interned_source;
 
-                return {};
-            }
+    const VoidResult verified = reverify_regions(patched, base, ranks);
+    if (!verified.has_value())
+    {
+        return std::unexpected(verified.error());
+    }
+    return base;
+}
 
-            if (pc > program.code.size())
-            {
-                return make_unexpected(
-                    ErrorCode::invalid_jump_target,
-                    "Jump target points past end of bytecode.");
-            }
+auto VM::reverify_regions(const Program& program, VerificationState& state, std::span<const std::size_t> ranks) const
+    -> VoidResult
+{
+    const std::vector<VerifierRegion> regions = partition_function_regions(program);
 
-            std::optional<std::size_t>& known_depth = stack_depth_at_pc[pc];
-            if (!known_depth.has_value())
+    VerifierScratch scratch;
+    for (const std::size_t rank : ranks)
+    {
+        if (rank == 0)
+        {
+            const VerifierRegion whole_program {.begin = 0, .end = program.code.size()};
+            const auto entry_verify = verify_region(
+                program,
+                native_bindings_,
+                records_,
+                state.available_inputs_,
+                whole_program,
+                0,
+                std::nullopt,
+                scratch);
+            if (!entry_verify.has_value())
             {
-                known_depth = depth;
-                worklist.push_back(pc);
-                return {};
+                return std::unexpected(entry_verify.error());
             }
 
-            if (known_depth.value() != depth)
-            {
-                return make_unexpected(
-                    ErrorCode::verification_failed,
-                    "Inconsistent stack depth across control-flow merge.");
-            }
+            state.top_level_reach_.assign(program.code.size(), false);
+            record_region(program, whole_program, scratch, state.callees_[0], &state.top_level_reach_);
+            continue;
+        }
 
-            return {};
-        };
+        const auto local_count = static_cast<std::size_t>(program.functions[rank - 1].local_count);
+        const auto function_verify = verify_region(
+            program,
+            native_bindings_,
+            records_,
+            state.available_inputs_,
+            regions[rank - 1],
+            local_count,
+            local_count,
+            scratch);
+        std::vector<CodeRange>& escaped_reach = state.escaped_reach_[rank - 1];
+        escaped_reach.clear();
+        if (function_verify.has_value())
+        {
+            record_region(program, regions[rank - 1], scratch, state.callees_[rank], nullptr);
+            continue;
+        }
+        if (!scratch.left_region)
+        {
+            return std::unexpected(function_verify.error());
+        }
 
+        // The state has to know every pc such a function reaches, so it gets a standalone walk instead of sharing.
+        const VoidResult unbounded = verify_function_unbounded(
+            program,
+            native_bindings_,
+            records_,
+            state.available_inputs_,
+            rank - 1,
+            scratch);
+        if (!unbounded.has_value())
+        {
+            return std::unexpected(unbounded.error());
+        }
+        record_region(
+            program,
+            VerifierRegion {.begin = 0, .end = program.code.size()},
+            scratch,
+            state.callees_[rank],
+            nullptr);
+        for (std::size_t pc = 0; pc < program.code.size(); ++pc)
         {
-            const auto entry = enqueue_successor(entry_pc, initial_stack_depth);
-            if (!entry.has_value())
+            if (scratch.stack_depth_at_pc[pc] == verifier_unvisited_depth)
             {
-                return std::unexpected(entry.error());
+                continue;
+            }
+            if (!escaped_reach.empty() && escaped_reach.back().end == pc)
+            {
+                ++escaped_reach.back().end;
+            }
+            else
+            {
+                escaped_reach.push_back({.begin = pc, .end = pc + 1});
             }
         }
+    }
 
-        while (!worklist.empty())
-        {
-            const std::size_t pc = worklist.back();
-            worklist.pop_back();
+    state.reverified_regions_ = ranks.size();
+    return {};
+}
 
-            const Instruction& instruction = program.code[pc];
-            const std::size_t stack_depth = stack_depth_at_pc[pc].value_or(0);
+auto VM::run(const Program& program) -> Result<Value>
+{
+    const VoidResult verify_result = verify(program, inputs_.size());
+    if (!verify_result.has_value())
+    {
+        return std::unexpected(verify_result.error());
+    }
 
-            std::size_t pops = 0;
-            std::size_t pushes = 0;
-            std::optional<std::size_t> explicit_target;
-            bool has_fallthrough = true;
+    return run_unchecked(program);
+}
 
-            switch (instruction.opcode)
-            {
-                case OpCode::push_constant:
-                {
-                    if (instruction.operand >= program.constants.size())
-                    {
-                        return make_unexpected(
-                            ErrorCode::invalid_constant_index,
-                            "push_constant operand out of range during verification.");
-                    }
-                    pushes = 1;
-                    break;
-                }
-                case OpCode::push_input:
-                {
-                    if (instruction.operand >= available_inputs)
-                    {
-                        return make_unexpected(
-                            ErrorCode::invalid_input_index,
-                            "push_input operand out of range during verification.");
-                    }
-                    pushes = 1;
-                    break;
-                }
-                case OpCode::add_i64:
-                case OpCode::sub_i64:
-                case OpCode::mul_i64:
-                case OpCode::mod_i64:
-                case OpCode::cmp_eq_i64:
-                case OpCode::cmp_lt_i64:
-                case OpCode::and_i64:
-                case OpCode::or_i64:
-                case OpCode::xor_i64:
-                case OpCode::shl_i64:
-                case OpCode::shr_i64:
-                {
-                    pops = 2;
-                    pushes = 1;
-                    break;
-                }
-                case OpCode::call_native:
-                {
-                    if (instruction.operand >= native_bindings_.size())
-                    {
-                        return make_unexpected(
-                            ErrorCode::invalid_native_index,
-                            "call_native operand out of range during verification.");
-                    }
-                    if (!native_bindings_[instruction.operand].function)
-                    {
-                        return make_unexpected(
-                            ErrorCode::empty_native_binding,
-                            "call_native resolved to empty native binding during verification.");
-                    }
-                    pops = native_bindings_[instruction.operand].arity;
-                    pushes = 1;
-                    break;
-                }
-                case OpCode::jump:
-                {
-                    explicit_target = static_cast<std::size_t>(instruction.operand);
-                    has_fallthrough = false;
-                    break;
-                }
-                case OpCode::jump_if_true:
-                {
-                    pops = 1;
-                    explicit_target = static_cast<std::size_t>(instruction.operand);
-                    has_fallthrough = true;
-                    break;
-                }
-                case OpCode::dup:
-                {
-                    if (stack_depth == 0)
-                    {
-                        return make_unexpected(
-                            ErrorCode::stack_underflow,
-                            "dup requires at least one value on stack.");
-                    }
-                    pushes = 1;
-                    break;
-                }
-                case OpCode::pop:
-                {
-                    pops = 1;
-                    break;
-                }
-                case OpCode::call:
-                {
-                    if (instruction.operand >= program.functions.size())
-                    {
-                        return make_unexpected(
-                            ErrorCode::invalid_function_index,
-                            "call operand out of range during verification.");
-                    }
+auto VM::run_unchecked(const Program& program) -> Result<Value>
+{
+    if (!arena_payloads_enabled_)
+    {
+        return execute_program(program);
+    }
+
+    // Abandoning a suspended run rewinds the arena below its scope, so that happens before this run's marker is taken.
+    clear_stack();
+    Arena::Marker run_scope = arena_.mark();
+    return promote_arena_result(execute_program(program));
+}
+
+auto VM::run_resumable(const Program& program) -> Result<RunSlice>
+{
+    const VoidResult verify_result = verify(program, inputs_.size());
+    if (!verify_result.has_value())
+    {
+        return std::unexpected(verify_result.error());
+    }
+
+    clear_stack();
+    call_frames_.clear();
+    suspended_scope_active_ = arena_payloads_enabled_;
+    suspended_scope_ = suspended_scope_active_ ? arena_.mark() : Arena::Marker {};
+    return finish_slice(execute_from(program, 0, true));
+}
+
+auto VM::resume() -> Result<RunSlice>
+{
+    if (suspended_program_ == nullptr)
+    {
+        return make_unexpected(ErrorCode::not_suspended, "resume called without a suspended run.");
+    }
 
-                    const auto& function = program.functions[instruction.operand];
-                    if (function.local_count < function.arity)
-                    {
-                        return make_unexpected(
-                            ErrorCode::invalid_function_signature,
-                            "Function local_count must be >= arity.");
-                    }
+    if (awaiting_native_)
+    {
+        if (!awaiting_native_.ready())
+        {
+            return RunSlice {.status = RunStatus::awaiting_native, .value = {}, .pending = awaiting_native_};
+        }
 
-                    pops = function.arity;
-                    pushes = 1;
-                    has_fallthrough = true;
-                    break;
-                }
-                case OpCode::ret:
-                {
-                    if (!frame_local_count.has_value())
-                    {
-                        return make_unexpected(ErrorCode::missing_call_frame, "ret is only valid inside function code.");
-                    }
-                    pops = 1;
-                    has_fallthrough = false;
-                    break;
-                }
-                case OpCode::load_local:
-                {
-                    if (!frame_local_count.has_value())
-                    {
-                        return make_unexpected(
-                            ErrorCode::missing_call_frame,
-                            "load_local requires function frame context.");
-                    }
-                    if (instruction.operand >= frame_local_count.value())
-                    {
-                        return make_unexpected(
-                            ErrorCode::invalid_local_index,
-                            "load_local operand out of range during verification.");
-                    }
-                    pushes = 1;
-                    break;
-                }
-                case OpCode::store_local:
-                {
-                    if (!frame_local_count.has_value())
-                    {
-                        return make_unexpected(
-                            ErrorCode::missing_call_frame,
-                            "store_local requires function frame context.");
-                    }
-                    if (instruction.operand >= frame_local_count.value())
-                    {
-                        return make_unexpected(
-                            ErrorCode::invalid_local_index,
-                            "store_local operand out of range during verification.");
-                    }
-                    pops = 1;
-                    break;
-                }
-                case OpCode::halt:
-                {
-                    has_fallthrough = false;
-                    break;
-                }
-                default:
-                {
-                    return make_unexpected(ErrorCode::unknown_opcode, "Unknown opcode during verification.");
-                }
-            }
+        Result<Value> returned = std::exchange(awaiting_native_, {}).take();
+        if (!returned.has_value())
+        {
+            suspended_program_ = nullptr;
+            return finish_slice(std::unexpected(returned.error()));
+        }
+        stack_.push_back(std::move(returned).value());
+    }
+
+    const Program& program = *std::exchange(suspended_program_, nullptr);
+    return finish_slice(execute_from(program, suspended_pc_, true));
+}
+
+auto VM::suspended() const noexcept -> bool
+{
+    return suspended_program_ != nullptr;
+}
+
+auto VM::run_async(const Program& program, Executor& executor) -> RunAwaitable
+{
+    return RunAwaitable(*this, program, executor);
+}
+
+auto VM::steps(const Program& program) -> StepSequence
+{
+    return StepSequence(*this, program);
+}
+
+auto VM::snapshot() const -> Result<MoveBuffer>
+{
+    if (suspended_program_ == nullptr)
+    {
+        return make_unexpected(ErrorCode::not_suspended, "snapshot requires a suspended run.");
+    }
+    if (awaiting_native_)
+    {
+        return make_unexpected(
+            ErrorCode::unsupported_operation,
+            "A run parked on an async native cannot be snapshotted.");
+    }
+
+    ByteWriter writer;
+    writer.write_u32(snapshot_magic);
+    writer.write_u16(snapshot_version);
+    writer.write_u16(0);
+    writer.write_u64(execution_fingerprint(*suspended_program_, native_signatures()));
+    writer.write_u64(suspended_pc_);
 
-            if (stack_depth < pops)
+    const auto write_values = [&writer](const auto& values) -> VoidResult {
+        writer.write_u32(static_cast<std::uint32_t>(values.size()));
+        for (const Value& value : values)
+        {
+            const VoidResult written = write_constant(writer, value);
+            if (!written.has_value())
             {
-                return make_unexpected(
-                    ErrorCode::stack_underflow,
-                    "Instruction would underflow stack during verification.");
+                return written;
             }
+        }
+        return {};
+    };
 
-            const std::size_t next_depth = (stack_depth - pops) + pushes;
+    if (const VoidResult written = write_values(stack_); !written.has_value())
+    {
+        return std::unexpected(written.error());
+    }
 
-            if (explicit_target.has_value())
-            {
-                if (explicit_target.value() >= program.code.size())
-                {
-                    return make_unexpected(
-                        ErrorCode::invalid_jump_target,
-                        "Jump target out of range during verification.");
-                }
+    writer.write_u32(static_cast<std::uint32_t>(call_frames_.size()));
+    for (const CallFrame& frame : call_frames_)
+    {
+        writer.write_u64(frame.return_pc);
+        writer.write_u64(frame.base);
+        writer.write_u64(frame.local_count);
+    }
 
-                const auto target_result = enqueue_successor(explicit_target.value(), next_depth);
-                if (!target_result.has_value())
-                {
-                    return std::unexpected(target_result.error());
-                }
-            }
+    std::vector<Value> inputs;
+    inputs.reserve(inputs_.size());
+    for (std::size_t i = 0; i < inputs_.size(); ++i)
+    {
+        inputs.push_back(input_views_[i].bound() ? input_views_[i].read() : inputs_[i]);
+    }
+    if (const VoidResult written = write_values(inputs); !written.has_value())
+    {
+        return std::unexpected(written.error());
+    }
+    return writer.finish();
+}
+
+auto VM::restore(const Program& program, const std::span<const std::byte> snapshot) -> VoidResult
+{
+    ByteReader reader(snapshot);
+    std::uint32_t magic = 0;
+    std::uint16_t version = 0;
+    std::uint16_t flags = 0;
+    std::uint64_t fingerprint = 0;
+    std::uint64_t pc = 0;
+    if (!reader.read_u32(magic) || !reader.read_u16(version) || !reader.read_u16(flags) ||
+        !reader.read_u64(fingerprint) || !reader.read_u64(pc))
+    {
+        return make_unexpected(ErrorCode::malformed_bytecode, "Snapshot header is truncated.");
+    }
+    if (magic != snapshot_magic || version != snapshot_version)
+    {
+        return make_unexpected(ErrorCode::malformed_bytecode, "Snapshot header is not recognized.");
+    }
+    if (fingerprint != execution_fingerprint(program, native_signatures()))
+    {
+        return make_unexpected(
+            ErrorCode::snapshot_mismatch,
+            "Snapshot was taken against a different program or native table.");
+    }
 
-            if (has_fallthrough)
+    const auto read_values = [&reader](auto& values) -> VoidResult {
+        std::uint32_t count = 0;
+        if (!reader.read_u32(count))
+        {
+            return make_unexpected(ErrorCode::malformed_bytecode, "Snapshot value table is truncated.");
+        }
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            Result<Value> value = read_constant(reader);
+            if (!value.has_value())
             {
-                const auto fallthrough_result = enqueue_successor(pc + 1, next_depth);
-                if (!fallthrough_result.has_value())
-                {
-                    return std::unexpected(fallthrough_result.error());
-                }
+                return std::unexpected(value.error());
             }
+            values.push_back(std::move(value).value());
         }
-
         return {};
     };
 
-    const auto entry_verify = verify_entry(0, 0, std::nullopt);
-    if (!entry_verify.has_value())
+    std::pmr::vector<Value> stack(stack_.get_allocator());
+    if (const VoidResult read = read_values(stack); !read.has_value())
     {
-        return std::unexpected(entry_verify.error());
+        return read;
     }
 
-    for (const auto& function : program.functions)
+    std::uint32_t frame_count = 0;
+    if (!reader.read_u32(frame_count))
     {
-        const auto function_verify = verify_entry(
-            static_cast<std::size_t>(function.entry),
-            static_cast<std::size_t>(function.local_count),
-            static_cast<std::size_t>(function.local_count));
-        if (!function_verify.has_value())
+        return make_unexpected(ErrorCode::malformed_bytecode, "Snapshot call frames are truncated.");
+    }
+    std::pmr::vector<CallFrame> frames(call_frames_.get_allocator());
+    for (std::uint32_t i = 0; i < frame_count; ++i)
+    {
+        std::uint64_t return_pc = 0;
+        std::uint64_t base = 0;
+        std::uint64_t local_count = 0;
+        if (!reader.read_u64(return_pc) || !reader.read_u64(base) || !reader.read_u64(local_count))
         {
-            return std::unexpected(function_verify.error());
+            return make_unexpected(ErrorCode::malformed_bytecode, "Snapshot call frames are truncated.");
+        }
+        if (return_pc > program.code.size() || base > stack.size() || local_count > stack.size() - base)
+        {
+            return make_unexpected(ErrorCode::malformed_bytecode, "Snapshot call frame is out of range.");
         }
+        frames.push_back({return_pc, base, local_count});
+    }
+
+    std::pmr::vector<Value> inputs(inputs_.get_allocator());
+    if (const VoidResult read = read_values(inputs); !read.has_value())
+    {
+        return read;
+    }
+    if (reader.remaining() != 0 || pc > program.code.size())
+    {
+        return make_unexpected(ErrorCode::malformed_bytecode, "Snapshot payload is malformed.");
+    }
+
+    const VoidResult verified = verify(program, inputs.size());
+    if (!verified.has_value())
+    {
+        return verified;
     }
 
+    clear_stack();
+    stack_ = std::move(stack);
+    call_frames_ = std::move(frames);
+    inputs_ = std::move(inputs);
+    input_views_.assign(inputs_.size(), InputView {});
+    suspended_program_ = &program;
+    suspended_pc_ = static_cast<std::size_t>(pc);
     return {};
 }
 
-auto VM::run(const Program& program) -> Result<Value>
+auto VM::fork(VM& target) -> VoidResult
 {
-    const VoidResult verify_result = verify(program, inputs_.size());
-    if (!verify_result.has_value())
+    if (suspended_program_ == nullptr)
     {
-        return std::unexpected(verify_result.error());
+        return make_unexpected(ErrorCode::not_suspended, "fork requires a suspended run.");
+    }
+    if (awaiting_native_ || &target == this)
+    {
+        return make_unexpected(
+            ErrorCode::unsupported_operation,
+            "fork needs a distinct target and a run that is not parked on an async native.");
     }
 
-    return run_unchecked(program);
+    const std::vector<NativeSignature> natives = native_signatures();
+    const std::vector<NativeSignature> target_natives = target.native_signatures();
+    const bool natives_match = std::equal(
+        natives.begin(),
+        natives.end(),
+        target_natives.begin(),
+        target_natives.end(),
+        [](const NativeSignature& lhs, const NativeSignature& rhs) {
+            return lhs.name == rhs.name && lhs.arity == rhs.arity;
+        });
+    if (!natives_match)
+    {
+        return make_unexpected(ErrorCode::snapshot_mismatch, "fork target has different native bindings.");
+    }
+
+    target.clear_stack();
+    target.stack_.clear();
+    target.stack_.reserve(stack_.size());
+    for (Value& value : stack_)
+    {
+        target.stack_.push_back(share_for_fork(value, arena_));
+    }
+    target.inputs_.clear();
+    target.inputs_.reserve(inputs_.size());
+    for (Value& value : inputs_)
+    {
+        target.inputs_.push_back(share_for_fork(value, arena_));
+    }
+    target.input_views_.assign(input_views_.begin(), input_views_.end());
+    target.records_.assign(records_.begin(), records_.end());
+    target.call_frames_.assign(call_frames_.begin(), call_frames_.end());
+    target.suspended_program_ = suspended_program_;
+    target.suspended_pc_ = suspended_pc_;
+    return {};
 }
 
-auto VM::run_unchecked(const Program& program) -> Result<Value>
+auto VM::finish_slice(Result<Value> result) -> Result<RunSlice>
+{
+    if (result.has_value() && suspended_program_ != nullptr)
+    {
+        if (awaiting_native_)
+        {
+            return RunSlice {.status = RunStatus::awaiting_native, .value = {}, .pending = awaiting_native_};
+        }
+        const RunStatus status = std::exchange(yielded_, false) ? RunStatus::yielded : RunStatus::suspended;
+        return RunSlice {.status = status, .value = {}, .pending = {}, .steps = slice_steps_};
+    }
+
+    // The run is over either way; the arena scope opened by run_resumable rewinds when this function returns.
+    const Arena::Marker run_scope = std::move(suspended_scope_);
+    if (std::exchange(suspended_scope_active_, false))
+    {
+        result = promote_arena_result(std::move(result));
+    }
+    if (!result.has_value())
+    {
+        return std::unexpected(result.error());
+    }
+    return RunSlice {.status = RunStatus::completed, .value = std::move(result).value(), .pending = {}};
+}
+
+auto VM::promote_arena_result(Result<Value> result) -> Result<Value>
+{
+    // Leftover stack slots may view arena memory that the caller's scope reclaims on return.
+    clear_stack();
+    if (!result.has_value())
+    {
+        return result;
+    }
+
+    if (result->is_string_view() && arena_.contains(result->as_string_view().data()))
+    {
+        return Value::owned_string(std::string(result->as_string_view()));
+    }
+    if (result->is_borrowed_buffer() && arena_.contains(result->as_borrowed_buffer().data()))
+    {
+        Result<MoveBuffer> promoted = result->take_buffer();
+        if (!promoted.has_value())
+        {
+            return std::unexpected(promoted.error());
+        }
+        return Value::owned_buffer(std::move(promoted).value());
+    }
+    return result;
+}
+
+auto VM::execute_program(const Program& program) -> Result<Value>
+{
+    clear_stack();
+    call_frames_.clear();
+    return execute_from(program, 0, false);
+}
+
+auto VM::execute_from(const Program& program, const std::size_t start_pc, const bool suspend_on_budget)
+    -> Result<Value>
 {
     using Clock = std::chrono::steady_clock;
 
@@ -1572,14 +3871,32 @@ auto VM::run_unchecked(const Program& program) -> Result<Value>
 
     RunProfileGuard run_profile(this, profiling_enabled_);
 
-    clear_stack();
-    call_frames_.clear();
+    // Natives may re-enter the VM with a plain run, which must not inherit this run's parking mode.
+    struct ParkingGuard final
+    {
+        VM& vm;
+        bool previous = false;
+
+        ~ParkingGuard()
+        {
+            vm.parking_enabled_ = previous;
+        }
+    };
+    const ParkingGuard parking_guard {*this, std::exchange(parking_enabled_, suspend_on_budget)};
+
     std::size_t executed_steps = 0;
 
-    for (std::size_t pc = 0; pc < program.code.size();)
+    for (std::size_t pc = start_pc; pc < program.code.size();)
     {
         if (step_budget_ != 0 && executed_steps >= step_budget_)
         {
+            if (suspend_on_budget)
+            {
+                suspended_program_ = &program;
+                suspended_pc_ = pc;
+                slice_steps_ = executed_steps;
+                return Value {};
+            }
             return make_unexpected(
                 ErrorCode::step_budget_exceeded,
                 "VM step budget exhausted before termination.");
@@ -1656,6 +3973,12 @@ auto VM::run_unchecked(const Program& program) -> Result<Value>
                 {
                     return make_unexpected(ErrorCode::invalid_input_index, "push_input operand out of range.");
                 }
+                const InputView& view = input_views_[instruction.operand];
+                if (view.bound())
+                {
+                    stack_.push_back(view.read());
+                    break;
+                }
                 stack_.push_back(std::move(inputs_[instruction.operand]));
                 inputs_[instruction.operand] = Value {};
                 break;
@@ -1815,7 +4138,8 @@ auto VM::run_unchecked(const Program& program) -> Result<Value>
                 {
                     return make_unexpected(ErrorCode::stack_underflow, "dup requires non-empty stack.");
                 }
-                stack_.push_back(stack_.back());
+                // Owned payloads move into refcounted form first, so both slots share one copy of the bytes.
+                stack_.push_back(stack_.back().share());
                 break;
             }
             case OpCode::pop:
@@ -1827,6 +4151,19 @@ auto VM::run_unchecked(const Program& program) -> Result<Value>
                 stack_.pop_back();
                 break;
             }
+            case OpCode::yield:
+            {
+                // A safe point for resumable runs; plain runs treat it as a no-op.
+                if (parking_enabled_)
+                {
+                    suspended_program_ = &program;
+                    suspended_pc_ = pc + 1;
+                    yielded_ = true;
+                    slice_steps_ = executed_steps;
+                    return Value {};
+                }
+                break;
+            }
             case OpCode::call:
             {
                 if (instruction.operand >= program.functions.size())
@@ -1919,7 +4256,7 @@ auto VM::run_unchecked(const Program& program) -> Result<Value>
                         "load_local resolved stack index out of range.");
                 }
 
-                stack_.push_back(stack_[stack_index]);
+                stack_.push_back(stack_[stack_index].share());
                 break;
             }
             case OpCode::store_local:
@@ -1957,6 +4294,94 @@ auto VM::run_unchecked(const Program& program) -> Result<Value>
                 stack_[stack_index] = std::move(value_result).value();
                 break;
             }
+            case OpCode::load_field_i64:
+            case OpCode::load_field_f64:
+            case OpCode::load_field_string:
+            case OpCode::load_field_bytes:
+            {
+                const auto field = resolve_record_field(records_, instruction);
+                if (!field.has_value())
+                {
+                    return std::unexpected<Error> {field.error()};
+                }
+                const std::size_t slot = instruction.operand >> record_field_operand_bits;
+                stack_.push_back(read_record_field(*field.value(), records_[slot].record));
+                break;
+            }
+            case OpCode::buffer_len:
+            case OpCode::buffer_slice:
+            case OpCode::buffer_load_u8:
+            case OpCode::buffer_load_u32:
+            case OpCode::buffer_load_u64:
+            case OpCode::buffer_hash:
+            case OpCode::buffer_find_byte:
+            case OpCode::buffer_xor_const:
+            {
+                Result<Value> buffer_result = execute_buffer_opcode(instruction);
+                if (!buffer_result.has_value())
+                {
+                    return std::unexpected<Error> {buffer_result.error()};
+                }
+                stack_.push_back(std::move(buffer_result).value());
+                break;
+            }
+            case OpCode::add_f64:
+            case OpCode::sub_f64:
+            case OpCode::mul_f64:
+            case OpCode::div_f64:
+            case OpCode::fma_f64:
+            case OpCode::neg_f64:
+            case OpCode::cmp_eq_f64:
+            case OpCode::cmp_lt_f64:
+            case OpCode::i64_to_f64:
+            case OpCode::f64_to_i64:
+            {
+                Result<Value> f64_result = execute_f64_opcode(instruction);
+                if (!f64_result.has_value())
+                {
+                    return std::unexpected<Error> {f64_result.error()};
+                }
+                stack_.push_back(std::move(f64_result).value());
+                break;
+            }
+            case OpCode::str_len:
+            case OpCode::str_eq:
+            case OpCode::str_prefix:
+            case OpCode::str_slice:
+            case OpCode::str_hash:
+            case OpCode::str_find:
+            case OpCode::str_concat:
+            {
+                Result<Value> string_result = execute_string_opcode(instruction);
+                if (!string_result.has_value())
+                {
+                    return std::unexpected<Error> {string_result.error()};
+                }
+                stack_.push_back(std::move(string_result).value());
+                break;
+            }
+            case OpCode::str_intern:
+            case OpCode::str_eq_interned:
+            {
+                Result<Value> intern_result = execute_intern_opcode(program, instruction);
+                if (!intern_result.has_value())
+                {
+                    return std::unexpected<Error> {intern_result.error()};
+                }
+                stack_.push_back(std::move(intern_result).value());
+                break;
+            }
+            case OpCode::str_switch:
+            {
+                Result<std::size_t> switch_target = execute_str_switch(program, instruction);
+                if (!switch_target.has_value())
+                {
+                    return std::unexpected<Error> {switch_target.error()};
+                }
+                pc = switch_target.value();
+                advance_pc = false;
+                break;
+            }
             case OpCode::call_native:
             {
                 Result<Value> native_result = execute_call_native(instruction.operand);
@@ -1964,6 +4389,12 @@ auto VM::run_unchecked(const Program& program) -> Result<Value>
                 {
                     return std::unexpected<Error> {native_result.error()};
                 }
+                if (awaiting_native_)
+                {
+                    suspended_program_ = &program;
+                    suspended_pc_ = pc + 1;
+                    return Value {};
+                }
                 stack_.push_back(std::move(native_result).value());
                 break;
             }
@@ -2002,6 +4433,38 @@ auto VM::run_unchecked(const Program& program) -> Result<Value>
     return pop_value();
 }
 
+auto VM::apply_binary_i64(const OpCode opcode, const std::int64_t lhs, const std::int64_t rhs)
+    -> Result<std::int64_t>
+{
+    switch (opcode)
+    {
+        case OpCode::add_i64:
+            return checked_add_i64(lhs, rhs);
+        case OpCode::sub_i64:
+            return checked_sub_i64(lhs, rhs);
+        case OpCode::mul_i64:
+            return checked_mul_i64(lhs, rhs);
+        case OpCode::mod_i64:
+            return checked_mod_i64(lhs, rhs);
+        case OpCode::cmp_eq_i64:
+            return std::int64_t {lhs == rhs ? 1 : 0};
+        case OpCode::cmp_lt_i64:
+            return std::int64_t {lhs < rhs ? 1 : 0};
+        case OpCode::and_i64:
+            return lhs & rhs;
+        case OpCode::or_i64:
+            return lhs | rhs;
+        case OpCode::xor_i64:
+            return lhs ^ rhs;
+        case OpCode::shl_i64:
+            return checked_shl_i64(lhs, rhs);
+        case OpCode::shr_i64:
+            return checked_shr_i64(lhs, rhs);
+        default:
+            return make_unexpected(ErrorCode::unknown_opcode, "Opcode is not a binary i64 operation.");
+    }
+}
+
 auto VM::pop_value() -> Result<Value>
 {
     if (stack_.empty())
@@ -2413,30 +4876,37 @@ auto VM::execute_call_native(std::size_t binding_index) -> Result<Value>
     std::span<Value> args(stack_.data() + args_offset, binding_arity);
 
     const std::uint64_t generation_before = native_bindings_generation_;
-    struct NativeDispatchGuard final
+    const NativeDispatchGuard dispatch_guard(native_dispatch_depth_);
+
+    Result<Value> result = Value {};
+    if (binding.async_function && parking_enabled_)
     {
-        explicit NativeDispatchGuard(VM& owner)
-            : vm(owner)
+        PendingValue pending = binding.async_function(*this, args);
+        if (!pending)
         {
-            ++vm.native_dispatch_depth_;
+            result = make_unexpected(ErrorCode::empty_native_binding, "Async native returned an empty pending value.");
         }
-
-        ~NativeDispatchGuard()
+        else if (pending.ready())
         {
-            --vm.native_dispatch_depth_;
+            result = pending.take();
         }
-
-        VM& vm;
-    };
-    NativeDispatchGuard dispatch_guard(*this);
-
-    Result<Value> result = binding.function(*this, args);
+        else
+        {
+            // The caller parks at this call_native; resume() pushes the completed value in place of result.
+            awaiting_native_ = std::move(pending);
+        }
+    }
+    else
+    {
+        result = binding.function(*this, args);
+    }
     if (!result.has_value())
     {
         return std::unexpected<Error> {result.error()};
     }
     if (native_bindings_generation_ != generation_before)
     {
+        awaiting_native_ = {};
         return make_unexpected(
             ErrorCode::native_reentrancy,
             "Native bindings were modified during native callback dispatch.");
@@ -2445,4 +4915,27 @@ auto VM::execute_call_native(std::size_t binding_index) -> Result<Value>
     stack_.resize(args_offset);
     return std::move(result).value();
 }
+
+auto VM::execute_batch_native(
+    const std::size_t binding_index,
+    const std::span<const std::span<const std::int64_t>> args,
+    const std::span<std::int64_t> results) -> VoidResult
+{
+    NativeBinding& binding = native_bindings_[binding_index];
+    const std::uint64_t generation_before = native_bindings_generation_;
+    const NativeDispatchGuard dispatch_guard(native_dispatch_depth_);
+
+    const VoidResult called = binding.batch_function(args, results);
+    if (!called.has_value())
+    {
+        return called;
+    }
+    if (native_bindings_generation_ != generation_before)
+    {
+        return make_unexpected(
+            ErrorCode::native_reentrancy,
+            "Native bindings were modified during native callback dispatch.");
+    }
+    return {};
+}
 } // namespace stella::vm
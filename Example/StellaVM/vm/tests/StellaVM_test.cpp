@@ -3,11 +3,25 @@
 import vm;
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <coroutine>
 #include <cstddef>
 #include <span>
 #include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <latch>
 #include <limits>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 #include <utility>
 
@@ -27,6 +41,36 @@ struct DestructionProbe final
 
     int* counter = nullptr;
 };
+
+struct DetachedTask final
+{
+    struct promise_type final
+    {
+        auto get_return_object() noexcept -> DetachedTask
+        {
+            return {};
+        }
+
+        auto initial_suspend() noexcept -> std::suspend_never
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept -> std::suspend_never
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
 }
 
 TEST_CASE("bytecode VM executes add_i64")
@@ -280,6 +324,1394 @@ TEST_CASE("arena marker provides RAII rewind for temporary VM allocations")
     arena.reset();
     CHECK(destroyed == 2);
     CHECK(arena.live_allocations() == 0);
+
+    // Markers rewind to their position even when the arena already holds data, reusing memory across blocks.
+    const std::string_view kept = arena.copy_string("kept");
+    const char* first_scratch = nullptr;
+    for (int round = 0; round < 3; ++round)
+    {
+        const auto marker = arena.mark();
+        const std::span<std::byte> large = arena.copy_bytes(std::vector<std::byte>(1000, std::byte {0x7F}));
+        const std::string_view scratch = arena.copy_string("scratch");
+        CHECK(arena.contains(large.data()));
+        first_scratch = round == 0 ? scratch.data() : first_scratch;
+        CHECK(scratch.data() == first_scratch);
+    }
+    CHECK(kept == "kept");
+}
+
+TEST_CASE("arena tracks only non-trivial destructors and destroys arrays in reverse")
+{
+    using namespace stella::vm;
+
+    struct OrderProbe final
+    {
+        std::vector<int>* log = nullptr;
+        int id = 0;
+
+        ~OrderProbe()
+        {
+            if (log != nullptr)
+            {
+                log->push_back(id);
+            }
+        }
+    };
+
+    std::vector<int> destroyed_ids;
+    Arena arena(256);
+
+    auto* point = arena.emplace<std::pair<int, int>>(3, 4);
+    CHECK(point->second == 4);
+    std::int64_t* raw = arena.allocate<std::int64_t>(32);
+    CHECK(reinterpret_cast<std::uintptr_t>(raw) % alignof(std::int64_t) == 0);
+    CHECK(arena.live_allocations() == 0);
+
+    {
+        auto marker = arena.mark();
+        std::span<OrderProbe> probes = arena.emplace_array<OrderProbe>(3);
+        for (std::size_t i = 0; i < probes.size(); ++i)
+        {
+            probes[i].log = &destroyed_ids;
+            probes[i].id = static_cast<int>(i);
+        }
+        CHECK(arena.live_allocations() == 3);
+    }
+
+    CHECK(arena.live_allocations() == 0);
+    CHECK(destroyed_ids == std::vector<int> {2, 1, 0});
+    CHECK(arena.emplace_array<int>(0).empty());
+}
+
+TEST_CASE("buffer pool recycles size classes and VM containers honor the memory resource")
+{
+    using namespace stella::vm;
+
+    const std::byte* first_block = nullptr;
+    {
+        MoveBuffer packet = MoveBuffer::uninitialized(512);
+        REQUIRE(packet.size == 512);
+        first_block = packet.data_ptr();
+    }
+    MoveBuffer recycled = MoveBuffer::uninitialized(500);
+    CHECK(recycled.data_ptr() == first_block);
+
+    MoveBuffer zeroed(512);
+    CHECK(std::all_of(zeroed.bytes().begin(), zeroed.bytes().end(), [](std::byte b) { return b == std::byte {0}; }));
+    CHECK(MoveBuffer::uninitialized(buffer_pool_max_bytes + 1).size == buffer_pool_max_bytes + 1);
+    CHECK(MoveBuffer::uninitialized(0).data_ptr() == nullptr);
+
+    struct CountingResource final : std::pmr::memory_resource
+    {
+        std::size_t allocations = 0;
+
+        auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override
+        {
+            ++allocations;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+        }
+
+        auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override
+        {
+            return this == &other;
+        }
+    };
+
+    CountingResource counting;
+    VM vm(32, 1024, &counting);
+    const std::size_t after_construction = counting.allocations;
+    CHECK(after_construction >= 2);
+
+    Program program;
+    const auto c0 = static_cast<std::uint32_t>(program.add_constant(Value::i64(20)));
+    const auto c1 = static_cast<std::uint32_t>(program.add_constant(Value::i64(22)));
+    program.code = {{OpCode::push_constant, c0}, {OpCode::push_constant, c1}, {OpCode::add_i64, 0}, {OpCode::halt, 0}};
+    const auto result = vm.run(program);
+    REQUIRE(result.has_value());
+    CHECK(result->as_i64() == 42);
+}
+
+TEST_CASE("VM pool hands out configured VMs and resets them on release")
+{
+    using namespace stella::vm;
+
+    std::atomic<int> configured {0};
+    VMPool pool([&configured](VM& vm) {
+        ++configured;
+        (void)vm.native("double_it").bind([](std::int64_t value) { return value * 2; });
+    });
+
+    Program program;
+    program.code = {{OpCode::push_input, 0}, {OpCode::call_native, 0}, {OpCode::halt, 0}};
+
+    int destroyed = 0;
+    const VM* first_vm = nullptr;
+    {
+        VMPool::Lease lease = pool.acquire();
+        REQUIRE(lease);
+        first_vm = &lease.vm();
+        (void)lease->push_input(Value::i64(21));
+        (void)lease->arena().emplace<DestructionProbe>(&destroyed);
+        const auto result = lease->run(program);
+        REQUIRE(result.has_value());
+        CHECK(result->as_i64() == 42);
+    }
+
+    CHECK(configured == 1);
+    CHECK(destroyed == 1);
+    CHECK(pool.idle() == 1);
+
+    {
+        VMPool::Lease lease = pool.acquire();
+        CHECK(&lease.vm() == first_vm);
+        CHECK(lease->stack().empty());
+        CHECK(lease->arena().live_allocations() == 0);
+        (void)lease->push_input(Value::i64(5));
+        const auto result = lease->run(program);
+        REQUIRE(result.has_value());
+        CHECK(result->as_i64() == 10);
+    }
+
+    const VMPoolStats stats = pool.stats();
+    CHECK(stats.misses == 1);
+    CHECK(stats.local_hits + stats.shared_hits == 1);
+    CHECK(stats.releases == 2);
+}
+
+TEST_CASE("bound input views are read by reference on every run")
+{
+    using namespace stella::vm;
+
+    struct Order final
+    {
+        std::int64_t quantity = 0;
+        std::int64_t unit_price = 0;
+        std::string region;
+    };
+
+    VM vm;
+    const auto region_length = static_cast<std::uint32_t>(
+        vm.native("region_length").bind([](std::string_view region) {
+            return static_cast<std::int64_t>(region.size());
+        }));
+
+    Order order {.quantity = 3, .unit_price = 7, .region = "emea"};
+    const std::size_t first = vm.bind_record_inputs(order, &Order::quantity, &Order::unit_price, &Order::region);
+    CHECK(first == 0);
+
+    const std::array<std::int64_t, 2> extras {100, 1000};
+    const std::size_t extras_first = vm.bind_inputs(extras);
+    CHECK(extras_first == 3);
+
+    Program program;
+    program.code = {
+        {OpCode::push_input, 0},
+        {OpCode::push_input, 1},
+        {OpCode::mul_i64, 0},
+        {OpCode::push_input, 2},
+        {OpCode::call_native, region_length},
+        {OpCode::add_i64, 0},
+        {OpCode::push_input, 3},
+        {OpCode::add_i64, 0},
+        {OpCode::push_input, 0},
+        {OpCode::add_i64, 0},
+        {OpCode::halt, 0},
+    };
+
+    auto result = vm.run(program);
+    REQUIRE(result.has_value());
+    CHECK(result->as_i64() == 3 * 7 + 4 + 100 + 3);
+
+    order.quantity = 5;
+    order.region = "apac-south";
+    result = vm.run(program);
+    REQUIRE(result.has_value());
+    CHECK(result->as_i64() == 5 * 7 + 10 + 100 + 5);
+
+    const std::int64_t replacement = 1;
+    REQUIRE(vm.rebind_input(3, InputView(replacement)).has_value());
+    result = vm.run(program);
+    REQUIRE(result.has_value());
+    CHECK(result->as_i64() == 5 * 7 + 10 + 1 + 5);
+    CHECK(!vm.rebind_input(9, InputView(replacement)).has_value());
+}
+
+TEST_CASE("record schemas feed load_field opcodes from bound host structs")
+{
+    using namespace stella::vm;
+
+    struct Trade final
+    {
+        std::int64_t quantity = 0;
+        double price = 0.0;
+        std::string venue;
+        std::int64_t limit = 0;
+    };
+
+    auto schema = RecordSchema::of<Trade>({
+        record_field<&Trade::quantity>("quantity"),
+        record_field<&Trade::price>("price"),
+        record_field<&Trade::venue>("venue"),
+        record_field<&Trade::limit>("limit"),
+    });
+    REQUIRE(schema.has_value());
+    CHECK(schema->find("limit") == 3U);
+    CHECK(!schema->find("missing").has_value());
+
+    struct Other final
+    {
+        std::int64_t value = 0;
+    };
+    const auto mixed = RecordSchema::of<Trade>({record_field<&Other::value>("value")});
+    REQUIRE(!mixed.has_value());
+    CHECK(mixed.error().code == ErrorCode::type_mismatch);
+
+    VM vm;
+    const auto venue_length = static_cast<std::uint32_t>(
+        vm.native("venue_length").bind([](std::string_view venue) { return static_cast<std::int64_t>(venue.size()); }));
+
+    std::vector<Trade> rows {{10, 1.5, "xnys", 5}, {2, 3.0, "xlon-dark", 7}};
+    const auto slot = vm.bind_record(*schema, rows[0]);
+    REQUIRE(slot.has_value());
+    const auto s0 = static_cast<std::uint32_t>(slot.value());
+
+    Program program;
+    program.code = {
+        {OpCode::load_field_i64, field_operand(s0, 0)},
+        {OpCode::load_field_string, field_operand(s0, 2)},
+        {OpCode::call_native, venue_length},
+        {OpCode::add_i64, 0},
+        {OpCode::load_field_i64, field_operand(s0, 3)},
+        {OpCode::cmp_lt_i64, 0},
+        {OpCode::halt, 0},
+    };
+    REQUIRE(vm.verify(program, 0).has_value());
+
+    std::vector<std::int64_t> verdicts;
+    for (const Trade& row : rows)
+    {
+        REQUIRE(vm.rebind_record(s0, row).has_value());
+        const auto result = vm.run(program);
+        REQUIRE(result.has_value());
+        verdicts.push_back(result->as_i64());
+    }
+    CHECK(verdicts == std::vector<std::int64_t> {0, 0});
+    rows[1].quantity = -5;
+    REQUIRE(vm.rebind_record(s0, rows[1]).has_value());
+    CHECK(vm.run(program)->as_i64() == 1);
+
+    Program wrong_type = program;
+    wrong_type.code[0] = {OpCode::load_field_f64, field_operand(s0, 0)};
+    CHECK(vm.verify(wrong_type, 0).error().code == ErrorCode::type_mismatch);
+
+    Program wrong_field = program;
+    wrong_field.code[0] = {OpCode::load_field_i64, field_operand(s0, 9)};
+    CHECK(vm.verify(wrong_field, 0).error().code == ErrorCode::invalid_field_index);
+
+    Program wrong_slot = program;
+    wrong_slot.code[0] = {OpCode::load_field_i64, field_operand(4, 0)};
+    CHECK(vm.verify(wrong_slot, 0).error().code == ErrorCode::invalid_record_index);
+
+    const auto price = static_cast<std::uint32_t>(schema->find("price").value());
+    Program read_price;
+    read_price.code = {{OpCode::load_field_f64, field_operand(s0, price)}, {OpCode::halt, 0}};
+    const auto price_result = vm.run(read_price);
+    REQUIRE(price_result.has_value());
+    CHECK(price_result->as_f64() == 3.0);
+}
+
+TEST_CASE("columnar engine matches row-at-a-time execution across divergent branches")
+{
+    using namespace stella::vm;
+
+    VM vm;
+    const auto scale = static_cast<std::uint32_t>(
+        vm.native("scale").bind([](std::int64_t value) { return value * 2 + 1; }));
+
+    Program program;
+    const auto factor = static_cast<std::uint32_t>(program.add_constant(Value::i64(3)));
+    program.code = {
+        {OpCode::push_input, 0},
+        {OpCode::push_input, 1},
+        {OpCode::cmp_lt_i64, 0},
+        {OpCode::jump_if_true, 8},
+        {OpCode::push_input, 0},
+        {OpCode::push_input, 1},
+        {OpCode::sub_i64, 0},
+        {OpCode::jump, 10},
+        {OpCode::push_input, 1},
+        {OpCode::call_native, scale},
+        {OpCode::push_constant, factor},
+        {OpCode::mul_i64, 0},
+        {OpCode::halt, 0},
+    };
+
+    const auto columnar = vm.compile_columnar(program, 2);
+    REQUIRE(columnar.has_value());
+    CHECK(columnar->max_stack_depth() == 2U);
+
+    constexpr std::size_t rows = column_vector_rows * 2 + 37;
+    std::vector<std::int64_t> xs(rows);
+    std::vector<std::int64_t> ys(rows);
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+        xs[i] = static_cast<std::int64_t>((i * 7) % 100);
+        ys[i] = static_cast<std::int64_t>((i * 13) % 100);
+    }
+    const std::array<std::span<const std::int64_t>, 2> columns {xs, ys};
+    std::vector<std::int64_t> results(rows);
+    REQUIRE(vm.run_columns(*columnar, columns, results).has_value());
+
+    std::array<std::int64_t, 2> row {};
+    static_cast<void>(vm.bind_inputs(row));
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+        row = {xs[i], ys[i]};
+        const auto expected = vm.run(program);
+        REQUIRE(expected.has_value());
+        REQUIRE(results[i] == expected->as_i64());
+    }
+
+    xs[5] = std::numeric_limits<std::int64_t>::max();
+    ys[5] = -1;
+    const auto overflow = vm.run_columns(*columnar, columns, results);
+    REQUIRE(!overflow.has_value());
+    CHECK(overflow.error().code == ErrorCode::arithmetic_overflow);
+
+    const std::array<std::span<const std::int64_t>, 1> too_few {xs};
+    CHECK(!vm.run_columns(*columnar, too_few, results).has_value());
+
+    Program strings;
+    const auto label = static_cast<std::uint32_t>(strings.add_constant(Value::owned_string("x")));
+    strings.code = {{OpCode::push_constant, label}, {OpCode::halt, 0}};
+    const auto rejected = vm.compile_columnar(strings, 0);
+    REQUIRE(!rejected.has_value());
+    CHECK(rejected.error().code == ErrorCode::unsupported_operation);
+}
+
+TEST_CASE("scheduler time-slices fibers across workers and enforces per-fiber step limits")
+{
+    using namespace stella::vm;
+
+    Program countdown;
+    const auto zero = static_cast<std::uint32_t>(countdown.add_constant(Value::i64(0)));
+    const auto minus_one = static_cast<std::uint32_t>(countdown.add_constant(Value::i64(-1)));
+    countdown.code = {
+        {OpCode::push_input, 1},
+        {OpCode::push_input, 0},
+        {OpCode::dup, 0},
+        {OpCode::push_constant, zero},
+        {OpCode::cmp_eq_i64, 0},
+        {OpCode::jump_if_true, 9},
+        {OpCode::push_constant, minus_one},
+        {OpCode::add_i64, 0},
+        {OpCode::jump, 2},
+        {OpCode::pop, 0},
+        {OpCode::halt, 0},
+    };
+
+    VMPool pool([](VM&) {}, 16);
+    constexpr std::int64_t fibers = 300;
+    std::atomic<std::int64_t> id_sum {0};
+    std::atomic<int> failures {0};
+    {
+        Scheduler scheduler(pool, 4);
+        CHECK(scheduler.worker_count() == 4U);
+        for (std::int64_t id = 1; id <= fibers; ++id)
+        {
+            scheduler.spawn(
+                countdown,
+                [id](VM& vm) {
+                    vm.clear_inputs();
+                    static_cast<void>(vm.push_input(Value::i64(40)));
+                    static_cast<void>(vm.push_input(Value::i64(id)));
+                },
+                [&](Result<Value> result) {
+                    if (result.has_value())
+                    {
+                        id_sum += result->as_i64();
+                    }
+                    else
+                    {
+                        ++failures;
+                    }
+                },
+                FiberOptions {.slice_steps = 16});
+        }
+
+        Result<Value> limited = Value {};
+        scheduler.spawn(
+            countdown,
+            [](VM& vm) {
+                vm.clear_inputs();
+                static_cast<void>(vm.push_input(Value::i64(1000000)));
+                static_cast<void>(vm.push_input(Value::i64(0)));
+            },
+            [&](Result<Value> result) { limited = std::move(result); },
+            FiberOptions {.slice_steps = 64, .step_limit = 1000});
+
+        scheduler.wait_idle();
+        CHECK(scheduler.active_fibers() == 0U);
+        REQUIRE(!limited.has_value());
+        CHECK(limited.error().code == ErrorCode::step_budget_exceeded);
+
+        const SchedulerStats stats = scheduler.stats();
+        CHECK(stats.spawned == static_cast<std::uint64_t>(fibers + 1));
+        CHECK(stats.completed == stats.spawned);
+        CHECK(stats.slices > stats.spawned * 10);
+    }
+
+    CHECK(failures == 0);
+    CHECK(id_sum == fibers * (fibers + 1) / 2);
+    CHECK(pool.stats().releases == static_cast<std::uint64_t>(fibers + 1));
+}
+
+TEST_CASE("scheduler requeues yielded fibers and charges only the steps they ran")
+{
+    using namespace stella::vm;
+
+    Program yielding;
+    const auto five = static_cast<std::uint32_t>(yielding.add_constant(Value::i64(5)));
+    yielding.code = {
+        {OpCode::push_constant, five},
+        {OpCode::yield, 0},
+        {OpCode::push_constant, five},
+        {OpCode::add_i64, 0},
+        {OpCode::halt, 0},
+    };
+
+    // Two steps per slice: a whole-budget charge would exhaust the limit after the first yield.
+    Program spinning;
+    spinning.code = {{OpCode::yield, 0}, {OpCode::jump, 0}};
+
+    VMPool pool([](VM&) {}, 4);
+    Result<Value> summed = Value {};
+    Result<Value> spun = Value {};
+    {
+        Scheduler scheduler(pool, 2);
+        scheduler.spawn(
+            yielding,
+            [](VM&) {},
+            [&](Result<Value> result) { summed = std::move(result); },
+            FiberOptions {.slice_steps = 1000});
+        scheduler.spawn(
+            spinning,
+            [](VM&) {},
+            [&](Result<Value> result) { spun = std::move(result); },
+            FiberOptions {.slice_steps = 1000, .step_limit = 50});
+        scheduler.wait_idle();
+
+        const SchedulerStats stats = scheduler.stats();
+        CHECK(stats.completed == 2U);
+        CHECK(stats.slices >= 2U + 25U);
+    }
+
+    REQUIRE(summed.has_value());
+    CHECK(summed->as_i64() == 10);
+    REQUIRE(!spun.has_value());
+    CHECK(spun.error().code == ErrorCode::step_budget_exceeded);
+    CHECK(pool.stats().releases == 2U);
+}
+
+TEST_CASE("async natives park resumable runs and complete through pending values")
+{
+    using namespace stella::vm;
+
+    VM vm;
+    PendingValue lookup;
+    const auto fetch = static_cast<std::uint32_t>(vm.bind_async_native("fetch", 1, [&](VM&, std::span<Value> args) {
+        if (args[0].as_i64() < 0)
+        {
+            return PendingValue::completed(Value::i64(0));
+        }
+        lookup = PendingValue::create();
+        return lookup;
+    }));
+
+    Program program;
+    const auto key = static_cast<std::uint32_t>(program.add_constant(Value::i64(7)));
+    const auto one = static_cast<std::uint32_t>(program.add_constant(Value::i64(1)));
+    program.code = {
+        {OpCode::push_constant, key},
+        {OpCode::call_native, fetch},
+        {OpCode::push_constant, one},
+        {OpCode::add_i64, 0},
+        {OpCode::halt, 0},
+    };
+
+    auto slice = vm.run_resumable(program);
+    REQUIRE(slice.has_value());
+    REQUIRE(slice->status == RunStatus::awaiting_native);
+    CHECK(!slice->pending.ready());
+
+    slice = vm.resume();
+    REQUIRE(slice.has_value());
+    CHECK(slice->status == RunStatus::awaiting_native);
+
+    std::jthread producer([pending = lookup] { pending.complete(Value::i64(41)); });
+    producer.join();
+    slice = vm.resume();
+    REQUIRE(slice.has_value());
+    REQUIRE(slice->status == RunStatus::completed);
+    CHECK(slice->value.as_i64() == 42);
+
+    ThreadPool io(2);
+    VM blocking;
+    const auto slow = static_cast<std::uint32_t>(blocking.bind_async_native("slow", 1, [&](VM&, std::span<Value> args) {
+        const std::int64_t value = args[0].as_i64();
+        return offload_native(io, [value]() -> Result<Value> { return Value::i64(value * 2); });
+    }));
+    program.code[1].operand = slow;
+    const auto waited = blocking.run(program);
+    REQUIRE(waited.has_value());
+    CHECK(waited->as_i64() == 15);
+
+    std::atomic<std::int64_t> awaited {0};
+    const PendingValue later = PendingValue::create();
+    [](PendingValue pending, std::atomic<std::int64_t>& out) -> DetachedTask {
+        const Result<Value> value = co_await pending;
+        out = value.has_value() ? value->as_i64() : -1;
+    }(later, awaited);
+    CHECK(awaited == 0);
+    later.complete(Value::i64(9));
+    CHECK(awaited == 9);
+
+    VMPool pool([&](VM& pooled) {
+        static_cast<void>(pooled.bind_async_native("slow", 1, [&](VM&, std::span<Value> args) {
+            const std::int64_t value = args[0].as_i64();
+            return offload_native(io, [value]() -> Result<Value> { return Value::i64(value * 2); });
+        }));
+    });
+    Program fiber_program = program;
+    fiber_program.code[1].operand = 0;
+    std::atomic<std::int64_t> total {0};
+    {
+        Scheduler scheduler(pool, 2);
+        for (int i = 0; i < 64; ++i)
+        {
+            scheduler.spawn(fiber_program, nullptr, [&](Result<Value> result) {
+                total += result.has_value() ? result->as_i64() : -1000;
+            });
+        }
+        scheduler.wait_idle();
+    }
+    CHECK(total == 64 * 15);
+}
+
+TEST_CASE("coroutine host API steps through yields and awaits runs on an executor")
+{
+    using namespace stella::vm;
+
+    Program program;
+    const auto three = static_cast<std::uint32_t>(program.add_constant(Value::i64(3)));
+    const auto zero = static_cast<std::uint32_t>(program.add_constant(Value::i64(0)));
+    const auto minus_one = static_cast<std::uint32_t>(program.add_constant(Value::i64(-1)));
+    program.code = {
+        {OpCode::push_constant, three},
+        {OpCode::dup, 0},
+        {OpCode::push_constant, zero},
+        {OpCode::cmp_eq_i64, 0},
+        {OpCode::jump_if_true, 9},
+        {OpCode::yield, 0},
+        {OpCode::push_constant, minus_one},
+        {OpCode::add_i64, 0},
+        {OpCode::jump, 1},
+        {OpCode::halt, 0},
+    };
+
+    VM vm;
+    std::vector<RunStatus> statuses;
+    for (Result<RunSlice>& slice : vm.steps(program))
+    {
+        REQUIRE(slice.has_value());
+        statuses.push_back(slice->status);
+    }
+    CHECK(statuses ==
+          std::vector<RunStatus> {RunStatus::yielded, RunStatus::yielded, RunStatus::yielded, RunStatus::completed});
+
+    const auto plain = vm.run(program);
+    REQUIRE(plain.has_value());
+    CHECK(plain->as_i64() == 0);
+
+    ManualExecutor executor;
+    std::optional<Result<Value>> outcome;
+    vm.set_step_budget(4);
+    [](VM& host, const Program& code, Executor& loop, std::optional<Result<Value>>& out) -> DetachedTask {
+        out = co_await host.run_async(code, loop);
+    }(vm, program, executor, outcome);
+    CHECK(!outcome.has_value());
+
+    const std::size_t tasks = executor.run_pending();
+    REQUIRE(outcome.has_value());
+    REQUIRE(outcome->has_value());
+    CHECK(outcome->value().as_i64() == 0);
+    CHECK(tasks > 4U);
+    vm.clear_step_budget();
+
+    // A task that breaks the no-throw rule surfaces on the run_pending caller; the task behind it stays queued.
+    bool later_ran = false;
+    executor.execute([] { throw std::runtime_error("task failed"); });
+    executor.execute([&later_ran] { later_ran = true; });
+    bool surfaced = false;
+    try
+    {
+        static_cast<void>(executor.run_pending());
+    }
+    catch (const std::runtime_error&)
+    {
+        surfaced = true;
+    }
+    CHECK(surfaced);
+    CHECK(!later_ran);
+    CHECK(executor.run_pending() == 1U);
+    CHECK(later_ran);
+}
+
+TEST_CASE("suspended runs fork per scenario and round-trip through snapshots")
+{
+    using namespace stella::vm;
+
+    Program program;
+    const auto label = static_cast<std::uint32_t>(program.add_constant(Value::owned_string("base")));
+    const auto ten = static_cast<std::uint32_t>(program.add_constant(Value::i64(10)));
+    const auto weight = static_cast<std::uint32_t>(program.add_constant(Value::i64(32)));
+    program.code = {
+        {OpCode::push_constant, label},
+        {OpCode::push_constant, ten},
+        {OpCode::push_constant, weight},
+        {OpCode::mul_i64, 0},
+        {OpCode::yield, 0},
+        {OpCode::push_input, 0},
+        {OpCode::add_i64, 0},
+        {OpCode::halt, 0},
+    };
+
+    VM base;
+    static_cast<void>(base.push_input(Value::i64(0)));
+    const auto prefix = base.run_resumable(program);
+    REQUIRE(prefix.has_value());
+    REQUIRE(prefix->status == RunStatus::yielded);
+
+    const std::array<std::int64_t, 2> scenarios {1, 2};
+    std::vector<std::int64_t> outcomes;
+    for (const std::int64_t& scenario : scenarios)
+    {
+        VM variant;
+        REQUIRE(base.fork(variant).has_value());
+        REQUIRE(variant.rebind_input(0, InputView(scenario)).has_value());
+        const auto finished = variant.resume();
+        REQUIRE(finished.has_value());
+        outcomes.push_back(finished->value.as_i64());
+    }
+    CHECK(outcomes == std::vector<std::int64_t> {321, 322});
+
+    VM with_natives;
+    static_cast<void>(with_natives.native("noop").bind([](std::int64_t value) { return value; }));
+    const auto mismatched_fork = base.fork(with_natives);
+    REQUIRE(!mismatched_fork.has_value());
+    CHECK(mismatched_fork.error().code == ErrorCode::snapshot_mismatch);
+
+    const auto blob = base.snapshot();
+    REQUIRE(blob.has_value());
+    const auto finished = base.resume();
+    REQUIRE(finished.has_value());
+    CHECK(finished->value.as_i64() == 320);
+    const auto idle = base.snapshot();
+    REQUIRE(!idle.has_value());
+    CHECK(idle.error().code == ErrorCode::not_suspended);
+
+    VM restored;
+    REQUIRE(restored.restore(program, blob->bytes()).has_value());
+    REQUIRE(restored.stack().size() == 2U);
+    CHECK(restored.stack()[0].expect_string("snapshot").value() == "base");
+    const auto replayed = restored.resume();
+    REQUIRE(replayed.has_value());
+    CHECK(replayed->value.as_i64() == 320);
+
+    Program edited = program;
+    edited.code[2].operand = ten;
+    const auto mismatch = restored.restore(edited, blob->bytes());
+    REQUIRE(!mismatch.has_value());
+    CHECK(mismatch.error().code == ErrorCode::snapshot_mismatch);
+}
+
+TEST_CASE("pure natives memoize whole runs through a sharded CLOCK result cache")
+{
+    using namespace stella::vm;
+
+    VM vm;
+    vm.set_profiling_enabled(true);
+    std::size_t square_calls = 0;
+    std::size_t clock_calls = 0;
+    const auto square = static_cast<std::uint32_t>(vm.native("square").pure().bind([&square_calls](std::int64_t x) {
+        ++square_calls;
+        return x * x;
+    }));
+    const auto tick =
+        static_cast<std::uint32_t>(vm.bind_native("tick", 0, [&clock_calls](VM&, std::span<Value>) -> Result<Value> {
+            return Value::i64(static_cast<std::int64_t>(++clock_calls));
+        }));
+
+    Program pure_program;
+    pure_program.code = {
+        {OpCode::push_input, 0},
+        {OpCode::call_native, square},
+        {OpCode::halt, 0},
+    };
+    Program impure_program;
+    impure_program.code = {
+        {OpCode::call_native, tick},
+        {OpCode::halt, 0},
+    };
+
+    ResultCache cache(2, 1);
+    vm.set_result_cache(&cache);
+    const auto run_with = [&vm](const Program& program, const std::uint64_t id, const std::int64_t input) {
+        vm.clear_inputs();
+        static_cast<void>(vm.push_input(Value::i64(input)));
+        const auto result = vm.run_memoized(program, id);
+        REQUIRE(result.has_value());
+        return result->as_i64();
+    };
+
+    CHECK(run_with(pure_program, 1, 7) == 49);
+    CHECK(run_with(pure_program, 1, 7) == 49);
+    CHECK(square_calls == 1U);
+    CHECK(run_with(pure_program, 1, 8) == 64);
+    CHECK(square_calls == 2U);
+    CHECK(cache.stats().hits == 1U);
+
+    CHECK(run_with(impure_program, 2, 0) == 1);
+    CHECK(run_with(impure_program, 2, 0) == 2);
+    CHECK(vm.profile().result_cache_bypasses == 2U);
+
+    // 7 was referenced by its hit, so the CLOCK sweep gives it a second chance and evicts 8 instead.
+    CHECK(run_with(pure_program, 1, 9) == 81);
+    CHECK(cache.size() == 2U);
+    CHECK(cache.stats().evictions == 1U);
+    CHECK(run_with(pure_program, 1, 7) == 49);
+    CHECK(square_calls == 3U);
+    CHECK(run_with(pure_program, 1, 8) == 64);
+    CHECK(square_calls == 4U);
+
+    CHECK(vm.profile().result_cache_hits == 2U);
+    CHECK(vm.profile().result_cache_misses == 4U);
+
+    // A hit leaves the inputs as consumed as a miss does, including ones the program never read.
+    Program echo;
+    echo.code = {{OpCode::push_input, 1}, {OpCode::halt, 0}};
+    for (const std::int64_t input : {10, 10})
+    {
+        vm.clear_inputs();
+        static_cast<void>(vm.push_input(Value::i64(input)));
+        static_cast<void>(vm.push_input(Value::i64(input + 1)));
+        REQUIRE(vm.run_memoized(pure_program, 1).has_value());
+        const auto leftover = vm.run(echo);
+        REQUIRE(leftover.has_value());
+        CHECK(leftover->is_empty());
+    }
+    CHECK(vm.profile().result_cache_hits == 3U);
+    CHECK(vm.profile().result_cache_misses == 5U);
+
+    // Purity follows in-place edits: the same Program object now calls the impure native and must bypass the cache.
+    pure_program.code = {{OpCode::call_native, tick}, {OpCode::halt, 0}};
+    const std::size_t ticks_before = clock_calls;
+    CHECK(run_with(pure_program, 1, 7) == static_cast<std::int64_t>(ticks_before + 1));
+    CHECK(run_with(pure_program, 1, 7) == static_cast<std::int64_t>(ticks_before + 2));
+    CHECK(vm.profile().result_cache_bypasses == 4U);
+
+    // Owned string inputs hit by content.
+    const auto length = static_cast<std::uint32_t>(vm.native("length").pure().bind([](const std::string_view text) {
+        return static_cast<std::int64_t>(text.size());
+    }));
+    Program measure;
+    measure.code = {{OpCode::push_input, 0}, {OpCode::call_native, length}, {OpCode::halt, 0}};
+    for (int round = 0; round < 2; ++round)
+    {
+        vm.clear_inputs();
+        static_cast<void>(vm.push_input(Value::owned_string(std::string(64, 'q'))));
+        const auto measured = vm.run_memoized(measure, 3);
+        REQUIRE(measured.has_value());
+        CHECK(measured->as_i64() == 64);
+    }
+    CHECK(vm.profile().result_cache_hits == 4U);
+}
+
+TEST_CASE("load-time folding evaluates pure natives with constant arguments")
+{
+    using namespace stella::vm;
+
+    VM vm;
+    std::size_t scale_calls = 0;
+    const auto scale = static_cast<std::uint32_t>(vm.native("scale").pure().bind([&scale_calls](std::int64_t x) {
+        ++scale_calls;
+        return x * 10;
+    }));
+    const auto mix = static_cast<std::uint32_t>(
+        vm.native("mix").pure().bind([](std::int64_t lhs, std::int64_t rhs) { return lhs + rhs; }));
+    const auto noisy =
+        static_cast<std::uint32_t>(vm.native("noisy").bind([](std::int64_t value) { return value + 1; }));
+
+    Program program;
+    const auto two = static_cast<std::uint32_t>(program.add_constant(Value::i64(2)));
+    const auto three = static_cast<std::uint32_t>(program.add_constant(Value::i64(3)));
+    program.code = {
+        {OpCode::push_constant, two},
+        {OpCode::push_constant, three},
+        {OpCode::call_native, scale},
+        {OpCode::call_native, mix},
+        {OpCode::push_input, 0},
+        {OpCode::jump_if_true, 9},
+        {OpCode::push_constant, two},
+        {OpCode::call_native, noisy},
+        {OpCode::jump, 11},
+        {OpCode::push_constant, three},
+        {OpCode::call_native, scale},
+        {OpCode::add_i64, 0},
+        {OpCode::halt, 0},
+    };
+
+    const auto folded = vm.fold_pure_natives(program);
+    REQUIRE(folded.has_value());
+    CHECK(scale_calls == 2U);
+    // mix(2, scale(3)) and the taken branch's scale(3) collapse; the impure call is left alone.
+    REQUIRE(folded->code.size() == 9U);
+    CHECK(folded->code[0].opcode == OpCode::push_constant);
+    CHECK(folded->constants[folded->code[0].operand].as_i64() == 32);
+    CHECK(folded->code[2].operand == 6U);
+    CHECK(folded->code[4].opcode == OpCode::call_native);
+    CHECK(folded->code[5].operand == 7U);
+    CHECK(folded->constants[folded->code[6].operand].as_i64() == 30);
+
+    for (const std::int64_t branch : {0, 1})
+    {
+        vm.clear_inputs();
+        static_cast<void>(vm.push_input(Value::i64(branch)));
+        const auto expected = vm.run(program);
+        vm.clear_inputs();
+        static_cast<void>(vm.push_input(Value::i64(branch)));
+        const auto actual = vm.run(folded.value());
+        REQUIRE(expected.has_value());
+        REQUIRE(actual.has_value());
+        CHECK(actual->as_i64() == expected->as_i64());
+    }
+
+    // A call_native that is itself a jump target may be entered with a stack built on another path.
+    Program guarded;
+    guarded.code = {
+        {OpCode::push_constant, two},
+        {OpCode::jump, 2},
+        {OpCode::call_native, scale},
+        {OpCode::halt, 0},
+    };
+    const auto unfolded = vm.fold_pure_natives(guarded);
+    REQUIRE(unfolded.has_value());
+    CHECK(unfolded->code.size() == 4U);
+}
+
+TEST_CASE("batch natives cross once per row group in columnar runs and fall back to single rows")
+{
+    using namespace stella::vm;
+
+    VM vm;
+    std::size_t batch_calls = 0;
+    std::size_t rows_seen = 0;
+    const auto scale = static_cast<std::uint32_t>(vm.native("scale").bind_batch(
+        [&](std::span<const std::int64_t> values, std::span<const std::int64_t> factors, std::span<std::int64_t> out) {
+            ++batch_calls;
+            rows_seen += out.size();
+            for (std::size_t i = 0; i < out.size(); ++i)
+            {
+                out[i] = values[i] * factors[i];
+            }
+        }));
+    const auto checked = static_cast<std::uint32_t>(
+        vm.native("checked").bind_batch([](std::span<const std::int64_t> values, std::span<std::int64_t> out) {
+            for (std::size_t i = 0; i < out.size(); ++i)
+            {
+                if (values[i] < 0)
+                {
+                    return VoidResult(std::unexpected(Error {ErrorCode::type_mismatch, "negative"}));
+                }
+                out[i] = values[i];
+            }
+            return VoidResult {};
+        }));
+
+    Program program;
+    const auto three = static_cast<std::uint32_t>(program.add_constant(Value::i64(3)));
+    const auto seven = static_cast<std::uint32_t>(program.add_constant(Value::i64(7)));
+    program.code = {
+        {OpCode::push_input, 0},
+        {OpCode::dup, 0},
+        {OpCode::jump_if_true, 5},
+        {OpCode::push_constant, seven},
+        {OpCode::jump, 6},
+        {OpCode::push_constant, three},
+        {OpCode::call_native, scale},
+        {OpCode::call_native, checked},
+        {OpCode::halt, 0},
+    };
+
+    const auto lowered = vm.compile_columnar(program, 1);
+    REQUIRE(lowered.has_value());
+    const std::array<std::int64_t, 5> inputs {0, 1, 2, 0, 4};
+    std::array<std::int64_t, 5> results {};
+    const std::array<std::span<const std::int64_t>, 1> columns {std::span<const std::int64_t>(inputs)};
+    REQUIRE(vm.run_columns(lowered.value(), columns, results).has_value());
+    CHECK(results == std::array<std::int64_t, 5> {0, 3, 6, 0, 12});
+    // The branches merge at the call, so all five rows cross together.
+    CHECK(batch_calls == 1U);
+    CHECK(rows_seen == 5U);
+
+    static_cast<void>(vm.push_input(Value::i64(5)));
+    const auto scalar = vm.run(program);
+    REQUIRE(scalar.has_value());
+    CHECK(scalar->as_i64() == 15);
+    CHECK(batch_calls == 2U);
+
+    const std::array<std::int64_t, 2> negative {-2, 1};
+    std::array<std::int64_t, 2> unused {};
+    const std::array<std::span<const std::int64_t>, 1> negative_columns {std::span<const std::int64_t>(negative)};
+    const auto failed = vm.run_columns(lowered.value(), negative_columns, unused);
+    REQUIRE(!failed.has_value());
+    CHECK(failed.error().code == ErrorCode::type_mismatch);
+}
+
+TEST_CASE("buffer opcodes match scalar native implementations and slice without copying")
+{
+    using namespace stella::vm;
+
+    std::vector<std::byte> packet(100);
+    for (std::size_t i = 0; i < packet.size(); ++i)
+    {
+        packet[i] = static_cast<std::byte>((i * 37U + 11U) & 0xFFU);
+    }
+    packet[70] = std::byte {0xEE};
+
+    const auto reference_crc32c = [](std::span<const std::byte> bytes) {
+        std::uint32_t crc = 0xFFFFFFFFU;
+        for (const std::byte byte : bytes)
+        {
+            crc ^= std::to_integer<std::uint32_t>(byte);
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc >> 1U) ^ ((crc & 1U) != 0 ? 0x82F63B78U : 0U);
+            }
+        }
+        return static_cast<std::int64_t>(~crc);
+    };
+
+    VM vm;
+    const auto native_xor = static_cast<std::uint32_t>(vm.native("xor_5a").bind([](MoveBuffer buffer) {
+        for (std::byte& byte : buffer.bytes())
+        {
+            byte ^= std::byte {0x5A};
+        }
+        return buffer;
+    }));
+
+    const auto run_on_packet = [&](std::vector<Instruction> code, const std::vector<std::int64_t>& operands) {
+        Program program;
+        program.code.push_back({OpCode::push_input, 0});
+        for (const std::int64_t operand : operands)
+        {
+            const auto index = static_cast<std::uint32_t>(program.add_constant(Value::i64(operand)));
+            program.code.push_back({OpCode::push_constant, index});
+        }
+        program.code.insert(program.code.end(), code.begin(), code.end());
+        program.code.push_back({OpCode::halt, 0});
+        vm.clear_inputs();
+        static_cast<void>(vm.bind_input(InputView::bytes(packet)));
+        return vm.run(program);
+    };
+
+    CHECK(run_on_packet({{OpCode::buffer_len, 0}}, {})->as_i64() == 100);
+    CHECK(run_on_packet({{OpCode::buffer_load_u8, 0}}, {3})->as_i64() == static_cast<std::int64_t>(packet[3]));
+    std::uint32_t word = 0;
+    std::memcpy(&word, packet.data() + 9, sizeof(word));
+    CHECK(run_on_packet({{OpCode::buffer_load_u32, 0}}, {9})->as_i64() == static_cast<std::int64_t>(word));
+    std::uint64_t wide = 0;
+    std::memcpy(&wide, packet.data() + 92, sizeof(wide));
+    CHECK(run_on_packet({{OpCode::buffer_load_u64, 0}}, {92})->as_i64() == static_cast<std::int64_t>(wide));
+    const auto past_end = run_on_packet({{OpCode::buffer_load_u64, 0}}, {93});
+    REQUIRE(!past_end.has_value());
+    CHECK(past_end.error().code == ErrorCode::invalid_buffer_access);
+
+    CHECK(run_on_packet({{OpCode::buffer_find_byte, 0xEE}}, {})->as_i64() == 70);
+    CHECK(run_on_packet({{OpCode::buffer_find_byte, 0x02}}, {})->as_i64() == -1);
+    CHECK(run_on_packet({{OpCode::buffer_hash, 0}}, {})->as_i64() == reference_crc32c(packet));
+    const std::string_view check_string = "123456789";
+    CHECK(reference_crc32c(std::as_bytes(std::span(check_string))) == 0xE3069283);
+
+    const auto transformed = run_on_packet({{OpCode::buffer_xor_const, 0x5A}}, {});
+    const auto via_native = run_on_packet({{OpCode::call_native, native_xor}}, {});
+    REQUIRE(transformed.has_value());
+    REQUIRE(via_native.has_value());
+    CHECK(std::ranges::equal(
+        transformed->expect_bytes("xor").value(),
+        via_native->expect_bytes("native").value()));
+    CHECK(packet[0] == std::byte {11});
+
+    const auto borrowed_slice = run_on_packet({{OpCode::buffer_slice, 0}}, {40, 20});
+    REQUIRE(borrowed_slice.has_value());
+    REQUIRE(borrowed_slice->is_borrowed_buffer());
+    CHECK(borrowed_slice->as_borrowed_buffer().data() == packet.data() + 40);
+    CHECK(borrowed_slice->as_borrowed_buffer().size() == 20U);
+
+    // An owned payload is shared by the slice rather than copied, and stays hashable through it.
+    Program owned_slice;
+    const auto offset = static_cast<std::uint32_t>(owned_slice.add_constant(Value::i64(64)));
+    const auto length = static_cast<std::uint32_t>(owned_slice.add_constant(Value::i64(36)));
+    owned_slice.code = {
+        {OpCode::push_input, 0},
+        {OpCode::push_constant, offset},
+        {OpCode::push_constant, length},
+        {OpCode::buffer_slice, 0},
+        {OpCode::buffer_hash, 0},
+        {OpCode::halt, 0},
+    };
+    vm.clear_inputs();
+    static_cast<void>(vm.push_input(Value::owned_buffer(SharedBuffer::copy_of(packet).into_move_buffer())));
+    const auto slice_hash = vm.run(owned_slice);
+    REQUIRE(slice_hash.has_value());
+    CHECK(slice_hash->as_i64() == reference_crc32c(std::span(packet).subspan(64)));
+
+    Program wide_operand;
+    wide_operand.code = {
+        {OpCode::push_input, 0},
+        {OpCode::buffer_find_byte, 0x100},
+        {OpCode::halt, 0},
+    };
+    const auto rejected = vm.verify(wide_operand, 1);
+    REQUIRE(!rejected.has_value());
+    CHECK(rejected.error().code == ErrorCode::verification_failed);
+}
+
+TEST_CASE("f64 opcodes price in bytecode with deterministic NaN, overflow and conversion rules")
+{
+    using namespace stella::vm;
+
+    VM vm;
+    const auto run_code = [&vm](const Program& program) {
+        vm.clear_inputs();
+        static_cast<void>(vm.push_input(Value::i64(3)));
+        return vm.run(program);
+    };
+
+    // price * quantity + fee, then a discount and a threshold comparison.
+    Program pricing;
+    const auto price = static_cast<std::uint32_t>(pricing.add_constant(Value::f64(19.99)));
+    const auto fee = static_cast<std::uint32_t>(pricing.add_constant(Value::f64(2.5)));
+    const auto discount = static_cast<std::uint32_t>(pricing.add_constant(Value::f64(0.9)));
+    pricing.code = {
+        {OpCode::push_constant, price},
+        {OpCode::push_input, 0},
+        {OpCode::i64_to_f64, 0},
+        {OpCode::push_constant, fee},
+        {OpCode::fma_f64, 0},
+        {OpCode::push_constant, discount},
+        {OpCode::mul_f64, 0},
+        {OpCode::halt, 0},
+    };
+    REQUIRE(vm.verify(pricing, 1).has_value());
+    const auto priced = run_code(pricing);
+    REQUIRE(priced.has_value());
+    CHECK(priced->as_f64() == std::fma(19.99, 3.0, 2.5) * 0.9);
+
+    const auto encoded = serialize_program(pricing);
+    REQUIRE(encoded.has_value());
+    const auto decoded = deserialize_program(encoded->bytes());
+    REQUIRE(decoded.has_value());
+    const auto replayed = run_code(decoded.value());
+    REQUIRE(replayed.has_value());
+    CHECK(replayed->as_f64() == priced->as_f64());
+
+    const auto binary = [&](const double lhs, const double rhs, const OpCode opcode) {
+        Program program;
+        const auto a = static_cast<std::uint32_t>(program.add_constant(Value::f64(lhs)));
+        const auto b = static_cast<std::uint32_t>(program.add_constant(Value::f64(rhs)));
+        program.code = {{OpCode::push_constant, a}, {OpCode::push_constant, b}, {opcode, 0}, {OpCode::halt, 0}};
+        return run_code(program);
+    };
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const auto zero_by_zero = binary(0.0, 0.0, OpCode::div_f64);
+    REQUIRE(zero_by_zero.has_value());
+    CHECK(std::bit_cast<std::uint64_t>(zero_by_zero->as_f64()) == std::bit_cast<std::uint64_t>(nan));
+    CHECK(binary(1e308, 10.0, OpCode::mul_f64)->as_f64() == std::numeric_limits<double>::infinity());
+    CHECK(binary(-1.0, 0.0, OpCode::div_f64)->as_f64() == -std::numeric_limits<double>::infinity());
+    CHECK(binary(nan, nan, OpCode::cmp_eq_f64)->as_i64() == 0);
+    CHECK(binary(nan, 1.0, OpCode::cmp_lt_f64)->as_i64() == 0);
+    CHECK(binary(0.5, 1.0, OpCode::cmp_lt_f64)->as_i64() == 1);
+    CHECK(binary(1.0, 0.25, OpCode::sub_f64)->as_f64() == 0.75);
+
+    const auto truncate = [&](const double value) {
+        Program program;
+        const auto a = static_cast<std::uint32_t>(program.add_constant(Value::f64(value)));
+        program.code = {{OpCode::push_constant, a}, {OpCode::neg_f64, 0}, {OpCode::f64_to_i64, 0}, {OpCode::halt, 0}};
+        return run_code(program);
+    };
+    CHECK(truncate(-7.9)->as_i64() == 7);
+    CHECK(truncate(9223372036854775808.0)->as_i64() == std::numeric_limits<std::int64_t>::min());
+    const auto too_wide = truncate(-9223372036854775808.0);
+    REQUIRE(!too_wide.has_value());
+    CHECK(too_wide.error().code == ErrorCode::arithmetic_overflow);
+    CHECK(truncate(nan).error().code == ErrorCode::arithmetic_overflow);
+
+    Program mixed;
+    mixed.code = {{OpCode::push_input, 0}, {OpCode::push_input, 0}, {OpCode::add_f64, 0}, {OpCode::halt, 0}};
+    CHECK(run_code(mixed).error().code == ErrorCode::type_mismatch);
+    Program short_fma;
+    short_fma.code = {{OpCode::push_input, 0}, {OpCode::dup, 0}, {OpCode::fma_f64, 0}, {OpCode::halt, 0}};
+    CHECK(vm.verify(short_fma, 1).error().code == ErrorCode::stack_underflow);
+}
+
+TEST_CASE("string opcodes view inputs and constants and concatenate into the arena")
+{
+    using namespace stella::vm;
+
+    VM vm;
+    const std::string request = "GET /api/v1/orders?id=42 HTTP/1.1";
+    const auto run_code = [&](const Program& program) {
+        vm.clear_inputs();
+        static_cast<void>(vm.push_input(Value::borrowed_string(request)));
+        return vm.run(program);
+    };
+    const auto pair = [&](const std::string_view text, const OpCode opcode) {
+        Program program;
+        const auto needle = static_cast<std::uint32_t>(program.add_constant(Value::owned_string(std::string(text))));
+        program.code = {{OpCode::push_input, 0}, {OpCode::push_constant, needle}, {opcode, 0}, {OpCode::halt, 0}};
+        return run_code(program);
+    };
+
+    CHECK(pair("GET /api/", OpCode::str_prefix)->as_i64() == 1);
+    CHECK(pair("POST", OpCode::str_prefix)->as_i64() == 0);
+    CHECK(pair(request, OpCode::str_eq)->as_i64() == 1);
+    CHECK(pair("GET", OpCode::str_eq)->as_i64() == 0);
+    CHECK(pair("id=42", OpCode::str_find)->as_i64() == static_cast<std::int64_t>(request.find("id=42")));
+    CHECK(pair("HTTP/1.1", OpCode::str_find)->as_i64() == static_cast<std::int64_t>(request.find("HTTP/1.1")));
+    CHECK(pair("id=43", OpCode::str_find)->as_i64() == -1);
+    CHECK(pair("", OpCode::str_find)->as_i64() == 0);
+
+    // A haystack long enough for the vector loop, with near misses sharing the needle's first and last bytes.
+    std::string log(200, 'a');
+    log.replace(50, 5, "ab_ab");
+    log.replace(170, 5, "ab-ab");
+    Program search;
+    const auto haystack = static_cast<std::uint32_t>(search.add_constant(Value::owned_string(log)));
+    const auto needle = static_cast<std::uint32_t>(search.add_constant(Value::owned_string("ab-ab")));
+    search.code = {
+        {OpCode::push_constant, haystack},
+        {OpCode::push_constant, needle},
+        {OpCode::str_find, 0},
+        {OpCode::halt, 0},
+    };
+    CHECK(run_code(search)->as_i64() == 170);
+
+    Program measure;
+    measure.code = {{OpCode::push_input, 0}, {OpCode::str_len, 0}, {OpCode::halt, 0}};
+    CHECK(run_code(measure)->as_i64() == static_cast<std::int64_t>(request.size()));
+    measure.code[1].opcode = OpCode::str_hash;
+    CHECK(static_cast<std::uint64_t>(run_code(measure)->as_i64()) == 0x9DC1F7EBB7751F4CULL);
+
+    // Slicing a borrowed input stays a view into the caller's bytes.
+    Program path;
+    const auto begin = static_cast<std::uint32_t>(path.add_constant(Value::i64(4)));
+    const auto length = static_cast<std::uint32_t>(path.add_constant(Value::i64(14)));
+    path.code = {
+        {OpCode::push_input, 0},
+        {OpCode::push_constant, begin},
+        {OpCode::push_constant, length},
+        {OpCode::str_slice, 0},
+        {OpCode::halt, 0},
+    };
+    REQUIRE(vm.verify(path, 1).has_value());
+    const auto sliced = run_code(path);
+    REQUIRE(sliced.has_value());
+    REQUIRE(sliced->is_string_view());
+    CHECK(sliced->as_string_view() == "/api/v1/orders");
+    CHECK(sliced->as_string_view().data() == request.data() + 4);
+
+    // Slicing a constant shares its refcounted payload.
+    path.code[0] = {OpCode::push_constant, static_cast<std::uint32_t>(path.add_constant(Value::owned_string(request)))};
+    const auto shared_slice = run_code(path);
+    REQUIRE(shared_slice.has_value());
+    REQUIRE(shared_slice->is_shared_string());
+    CHECK(shared_slice->as_shared_string().view() == "/api/v1/orders");
+    const std::string_view constant_text = path.constants.back().as_shared_string().view();
+    CHECK(shared_slice->as_shared_string().view().data() == constant_text.data() + 4);
+
+    path.code[2] = {OpCode::push_constant, static_cast<std::uint32_t>(path.add_constant(Value::i64(64)))};
+    const auto past_end = run_code(path);
+    REQUIRE(!past_end.has_value());
+    CHECK(past_end.error().code == ErrorCode::invalid_string_access);
+
+    // Concatenation lands in the arena; the result is copied out only because it escapes the run.
+    Program joined;
+    const auto suffix = static_cast<std::uint32_t>(joined.add_constant(Value::owned_string("#tail")));
+    joined.code = {
+        {OpCode::push_input, 0},
+        {OpCode::push_constant, suffix},
+        {OpCode::str_concat, 0},
+        {OpCode::halt, 0},
+    };
+    vm.set_arena_payloads_enabled(true);
+    const auto arena_joined = run_code(joined);
+    REQUIRE(arena_joined.has_value());
+    CHECK(arena_joined->expect_string("joined").value() == request + "#tail");
+    joined.code.insert(joined.code.begin() + 3, {OpCode::str_len, 0});
+    CHECK(run_code(joined)->as_i64() == static_cast<std::int64_t>(request.size() + 5));
+    vm.set_arena_payloads_enabled(false);
+    joined.code.erase(joined.code.begin() + 3);
+    const auto heap_joined = run_code(joined);
+    REQUIRE(heap_joined.has_value());
+    CHECK(heap_joined->is_owned_string());
+    CHECK(heap_joined->as_owned_string() == request + "#tail");
+
+    Program mistyped;
+    mistyped.code = {{OpCode::push_constant, 0}, {OpCode::str_len, 0}, {OpCode::halt, 0}};
+    static_cast<void>(mistyped.add_constant(Value::i64(7)));
+    CHECK(run_code(mistyped).error().code == ErrorCode::type_mismatch);
+}
+
+TEST_CASE("interned strings route through str_switch by id and survive serialization")
+{
+    using namespace stella::vm;
+
+    constexpr std::uint32_t route_count = 300;
+    const auto route_name = [](const std::uint32_t i) { return "tenant-" + std::to_string(i) + "/orders"; };
+
+    // Routes fan out to three handlers that push their group; anything else falls through to -1.
+    Program router;
+    Program::StringSwitch routes;
+    routes.default_target = 2;
+    for (std::uint32_t i = 0; i < route_count; ++i)
+    {
+        const auto route = static_cast<std::uint32_t>(router.add_constant(Value::owned_string(route_name(i))));
+        routes.cases.push_back({route, 4 + 2 * (i % 3)});
+    }
+    const auto repeated = static_cast<std::uint32_t>(router.add_constant(Value::owned_string(route_name(0))));
+    routes.cases.push_back({repeated, 2});
+    const auto table = static_cast<std::uint32_t>(router.add_string_switch(std::move(routes)));
+    const auto group = [&router](const std::int64_t value) {
+        return static_cast<std::uint32_t>(router.add_constant(Value::i64(value)));
+    };
+    const std::uint32_t unmatched = group(-1);
+    const std::uint32_t first = group(0);
+    const std::uint32_t second = group(1);
+    const std::uint32_t third = group(2);
+    router.code = {
+        {OpCode::push_input, 0},
+        {OpCode::str_switch, table},
+        {OpCode::push_constant, unmatched},
+        {OpCode::halt, 0},
+        {OpCode::push_constant, first},
+        {OpCode::halt, 0},
+        {OpCode::push_constant, second},
+        {OpCode::halt, 0},
+        {OpCode::push_constant, third},
+        {OpCode::halt, 0},
+    };
+
+    VM vm;
+    CHECK(vm.verify(router, 1).error().code == ErrorCode::stale_intern_table);
+    CHECK(router.intern_strings() == route_count);
+    REQUIRE(vm.verify(router, 1).has_value());
+
+    // Equal constants share one id and one payload.
+    CHECK(router.interned.constant_id(repeated) == router.interned.constant_id(0));
+    const std::string_view canonical = router.constants[0].as_shared_string().view();
+    CHECK(router.constants[repeated].as_shared_string().view().data() == canonical.data());
+
+    const auto route = [&vm](const Program& program, Value input) {
+        vm.clear_inputs();
+        static_cast<void>(vm.push_input(std::move(input)));
+        return vm.run(program);
+    };
+    const std::string seven = route_name(7);
+    CHECK(route(router, Value::borrowed_string(seven))->as_i64() == 1);
+    CHECK(route(router, Value::borrowed_string(route_name(0)))->as_i64() == 0);
+    CHECK(route(router, Value::borrowed_string("tenant-7/refunds"))->as_i64() == -1);
+
+    // A host that interns at binding time hands the VM an id, and dispatch never touches the bytes.
+    const std::int64_t eight = router.interned.find(route_name(8));
+    REQUIRE(eight >= 0);
+    CHECK(route(router, Value::i64(eight))->as_i64() == 2);
+    CHECK(route(router, Value::i64(-1))->as_i64() == -1);
+    CHECK(route(router, Value::i64(route_count + 5))->as_i64() == -1);
+
+    // In-place edits are stale too; the dispatch row would otherwise jump to a target the verifier never saw.
+    router.string_switches[table].cases[7].target = 8;
+    CHECK(vm.verify(router, 1).error().code == ErrorCode::stale_intern_table);
+    CHECK(route(router, Value::borrowed_string(seven)).error().code == ErrorCode::stale_intern_table);
+    router.intern_strings();
+    CHECK(route(router, Value::borrowed_string(seven))->as_i64() == 2);
+    router.string_switches[table].cases[7].target = 6;
+    router.constants[7] = Value::owned_string("tenant-7/renamed");
+    CHECK(vm.verify(router, 1).error().code == ErrorCode::stale_intern_table);
+    router.constants[7] = Value::owned_string(seven);
+    router.intern_strings();
+    CHECK(route(router, Value::borrowed_string(seven))->as_i64() == 1);
+
+    const auto encoded = serialize_program(router);
+    REQUIRE(encoded.has_value());
+    const auto decoded = deserialize_program(encoded->bytes());
+    REQUIRE(decoded.has_value());
+    CHECK(decoded->string_switches == router.string_switches);
+    CHECK(decoded->interned.find(route_name(8)) == eight);
+    REQUIRE(vm.verify(decoded.value(), 1).has_value());
+    for (std::uint32_t i = 0; i < route_count; i += 37)
+    {
+        CHECK(route(decoded.value(), Value::borrowed_string(route_name(i)))->as_i64() == i % 3);
+    }
+
+    Program matcher;
+    const auto wanted = static_cast<std::uint32_t>(matcher.add_constant(Value::owned_string(route_name(42))));
+    matcher.code = {{OpCode::push_input, 0}, {OpCode::str_eq_interned, wanted}, {OpCode::halt, 0}};
+    matcher.intern_strings();
+    REQUIRE(vm.verify(matcher, 1).has_value());
+
+    // Re-interning after swapping the constant for an integer leaves no region patched, but the operand is no
+    // longer a string, so the incremental check has to start over.
+    auto matcher_state = vm.verify_with_state(matcher, 1);
+    REQUIRE(matcher_state.has_value());
+    matcher.constants[wanted] = Value::i64(42);
+    matcher.intern_strings();
+    const auto repooled = vm.verify_incremental(matcher, matcher_state.value(), ProgramChanges {});
+    REQUIRE(!repooled.has_value());
+    CHECK(repooled.error().code == ErrorCode::invalid_constant_index);
+    matcher.constants[wanted] = Value::owned_string(route_name(42));
+    matcher.intern_strings();
+    CHECK(route(matcher, Value::borrowed_string(route_name(42)))->as_i64() == 1);
+    CHECK(route(matcher, Value::borrowed_string(route_name(43)))->as_i64() == 0);
+    CHECK(route(matcher, Value::i64(matcher.interned.find(route_name(42))))->as_i64() == 1);
+    matcher.code[1].opcode = OpCode::str_intern;
+    CHECK(route(matcher, Value::borrowed_string(route_name(42)))->as_i64() == matcher.interned.find(route_name(42)));
+    CHECK(route(matcher, Value::borrowed_string("absent"))->as_i64() == -1);
+
+    // Editing the pool without re-interning is caught rather than dispatching on stale ids.
+    static_cast<void>(matcher.add_constant(Value::owned_string("late")));
+    CHECK(route(matcher, Value::borrowed_string("late")).error().code == ErrorCode::stale_intern_table);
+
+    // Version 1 payloads have no switch section and still load.
+    Program plain;
+    static_cast<void>(plain.add_constant(Value::owned_string("legacy")));
+    plain.code = {{OpCode::push_constant, 0}, {OpCode::str_len, 0}, {OpCode::halt, 0}};
+    const auto plain_encoded = serialize_program(plain);
+    REQUIRE(plain_encoded.has_value());
+    std::vector<std::byte> legacy(plain_encoded->bytes().begin(), plain_encoded->bytes().end() - 4);
+    legacy[4] = std::byte {1};
+    legacy[5] = std::byte {0};
+    const auto legacy_program = deserialize_program(legacy);
+    REQUIRE(legacy_program.has_value());
+    CHECK(legacy_program->interned.find("legacy") == 0);
+    CHECK(route(legacy_program.value(), Value {})->as_i64() == 6);
 }
 
 TEST_CASE("bytecode VM executes branch and arithmetic opcodes")
@@ -407,29 +1839,78 @@ TEST_CASE("bytecode VM supports function call frames and locals")
     CHECK(result->as_i64() == 18);
 }
 
-TEST_CASE("VM step budget prevents runaway execution")
+TEST_CASE("VM step budget prevents runaway execution")
+{
+    using namespace stella::vm;
+
+    VM vm;
+    Program program;
+    const auto value = static_cast<std::uint32_t>(program.add_constant(Value::i64(42)));
+    program.code = {
+        {OpCode::push_constant, value},
+        {OpCode::halt, 0},
+    };
+
+    vm.set_step_budget(1);
+    Result<Value> limited = vm.run_unchecked(program);
+    REQUIRE(!limited.has_value());
+    CHECK(limited.error().code == ErrorCode::step_budget_exceeded);
+
+    vm.set_step_budget(2);
+    Result<Value> allowed = vm.run_unchecked(program);
+    REQUIRE(allowed.has_value());
+    CHECK(allowed->is_i64());
+    CHECK(allowed->as_i64() == 42);
+
+    vm.clear_step_budget();
+}
+
+TEST_CASE("resumable runs suspend on the step budget and continue inside call frames")
 {
     using namespace stella::vm;
 
     VM vm;
     Program program;
-    const auto value = static_cast<std::uint32_t>(program.add_constant(Value::i64(42)));
+    const auto input_value = static_cast<std::uint32_t>(program.add_constant(Value::i64(6)));
+    const auto add_value = static_cast<std::uint32_t>(program.add_constant(Value::i64(3)));
+    const auto function_index = static_cast<std::uint32_t>(program.add_function(3, 1, 1));
     program.code = {
-        {OpCode::push_constant, value},
+        {OpCode::push_constant, input_value},
+        {OpCode::call, function_index},
         {OpCode::halt, 0},
+        {OpCode::load_local, 0},
+        {OpCode::push_constant, add_value},
+        {OpCode::add_i64, 0},
+        {OpCode::ret, 0},
     };
 
-    vm.set_step_budget(1);
-    Result<Value> limited = vm.run_unchecked(program);
-    REQUIRE(!limited.has_value());
-    CHECK(limited.error().code == ErrorCode::step_budget_exceeded);
+    const auto idle = vm.resume();
+    REQUIRE(!idle.has_value());
+    CHECK(idle.error().code == ErrorCode::not_suspended);
 
     vm.set_step_budget(2);
-    Result<Value> allowed = vm.run_unchecked(program);
-    REQUIRE(allowed.has_value());
-    CHECK(allowed->is_i64());
-    CHECK(allowed->as_i64() == 42);
+    auto slice = vm.run_resumable(program);
+    REQUIRE(slice.has_value());
+    CHECK(slice->status == RunStatus::suspended);
+    CHECK(vm.suspended());
 
+    std::size_t slices = 1;
+    while (slice.has_value() && slice->status == RunStatus::suspended)
+    {
+        slice = vm.resume();
+        ++slices;
+    }
+    REQUIRE(slice.has_value());
+    CHECK(slice->value.as_i64() == 9);
+    CHECK(slices == 4U);
+    CHECK(!vm.suspended());
+
+    REQUIRE(vm.run_resumable(program).has_value());
+    CHECK(vm.suspended());
+    const auto restarted = vm.run_unchecked(program);
+    REQUIRE(!restarted.has_value());
+    CHECK(restarted.error().code == ErrorCode::step_budget_exceeded);
+    CHECK(!vm.suspended());
     vm.clear_step_budget();
 }
 
@@ -577,8 +2058,8 @@ TEST_CASE("bytecode serialization roundtrip preserves executable behavior")
     CHECK(decoded->constants[3].expect_string("decoded").value() == "borrowed");
     CHECK(decoded->constants[4].is_string());
     CHECK(decoded->constants[4].expect_string("decoded").value() == "owned");
-    CHECK(decoded->constants[5].is_buffer());
-    CHECK(decoded->constants[5].as_buffer().size == 3);
+    CHECK(decoded->constants[5].is_shared_buffer());
+    CHECK(decoded->constants[5].as_shared_buffer().size() == 3);
 
     VM vm;
     const auto verify = vm.verify(*decoded, 0);
@@ -589,6 +2070,193 @@ TEST_CASE("bytecode serialization roundtrip preserves executable behavior")
     CHECK(result->as_i64() == 35);
 }
 
+TEST_CASE("buffer constants are shared by refcount and promoted copy-on-write")
+{
+    using namespace stella::vm;
+
+    MoveBuffer template_bytes(4096);
+    template_bytes.bytes()[0] = std::byte {0x7F};
+
+    Program program;
+    const auto c0 = static_cast<std::uint32_t>(program.add_constant(Value::owned_buffer(std::move(template_bytes))));
+    REQUIRE(program.constants[c0].is_shared_buffer());
+    const std::byte* pooled = program.constants[c0].as_shared_buffer().bytes().data();
+
+    VM vm;
+    std::vector<const std::byte*> seen;
+    const auto inspect = static_cast<std::uint32_t>(vm.bind_native(
+        "inspect", 2, [&seen](VM&, std::span<Value> args) -> Result<Value> {
+            seen.push_back(args[0].as_shared_buffer().bytes().data());
+            seen.push_back(args[1].as_shared_buffer().bytes().data());
+            return Value::i64(args[1].as_shared_buffer().use_count());
+        }));
+    const auto mutate = static_cast<std::uint32_t>(
+        vm.bind_native("mutate", 1, [](VM&, std::span<Value> args) -> Result<Value> {
+            Result<MoveBuffer> owned = args[0].take_buffer();
+            if (!owned.has_value())
+            {
+                return std::unexpected(owned.error());
+            }
+            owned->bytes()[0] = std::byte {0x01};
+            return Value::owned_buffer(std::move(owned).value());
+        }));
+
+    program.code = {
+        {OpCode::push_constant, c0},
+        {OpCode::dup, 0},
+        {OpCode::call_native, inspect},
+        {OpCode::pop, 0},
+        {OpCode::push_constant, c0},
+        {OpCode::call_native, mutate},
+        {OpCode::halt, 0},
+    };
+    REQUIRE(vm.verify(program, 0).has_value());
+
+    Result<Value> result = vm.run(program);
+    REQUIRE(result.has_value());
+    REQUIRE(seen.size() == 2);
+    CHECK(seen[0] == pooled);
+    CHECK(seen[1] == pooled);
+
+    REQUIRE(result->is_buffer());
+    CHECK(result->as_buffer().data_ptr() != pooled);
+    CHECK(std::to_integer<int>(result->as_buffer().bytes()[0]) == 0x01);
+    CHECK(std::to_integer<int>(program.constants[c0].as_shared_buffer().bytes()[0]) == 0x7F);
+    CHECK(program.constants[c0].as_shared_buffer().use_count() == 1);
+
+    SharedBuffer sole = SharedBuffer::copy_of(program.constants[c0].as_shared_buffer().bytes());
+    const std::byte* sole_ptr = sole.bytes().data();
+    MoveBuffer stolen = std::move(sole).into_move_buffer();
+    CHECK(stolen.data_ptr() == sole_ptr);
+}
+
+TEST_CASE("dup and load_local share native-returned payloads instead of copying them")
+{
+    using namespace stella::vm;
+
+    VM vm;
+    const auto make_buffer = static_cast<std::uint32_t>(
+        vm.bind_native("make_buffer", 0, [](VM&, std::span<Value>) -> Result<Value> {
+            return Value::owned_buffer(MoveBuffer(4096));
+        }));
+    const auto make_text = static_cast<std::uint32_t>(
+        vm.bind_native("make_text", 0, [](VM&, std::span<Value>) -> Result<Value> {
+            return Value::owned_string(std::string(256, 't'));
+        }));
+    const auto same_payload = static_cast<std::uint32_t>(
+        vm.bind_native("same_payload", 2, [](VM&, std::span<Value> args) -> Result<Value> {
+            const auto payload = [](const Value& value) -> const void* {
+                return value.is_string() ? static_cast<const void*>(value.expect_string("same").value().data())
+                                         : static_cast<const void*>(value.expect_bytes("same").value().data());
+            };
+            const bool shared = (args[0].is_shared_buffer() || args[0].is_shared_string()) &&
+                payload(args[0]) == payload(args[1]);
+            return Value::i64(shared ? 1 : 0);
+        }));
+
+    Program duplicated;
+    duplicated.code = {
+        {OpCode::call_native, make_buffer},
+        {OpCode::dup, 0},
+        {OpCode::call_native, same_payload},
+        {OpCode::halt, 0},
+    };
+    REQUIRE(vm.verify(duplicated, 0).has_value());
+    CHECK(vm.run(duplicated)->as_i64() == 1);
+
+    Program local;
+    const auto twice = static_cast<std::uint32_t>(local.add_function(3, 1, 1));
+    local.code = {
+        {OpCode::call_native, make_text},
+        {OpCode::call, twice},
+        {OpCode::halt, 0},
+        {OpCode::load_local, 0},
+        {OpCode::load_local, 0},
+        {OpCode::call_native, same_payload},
+        {OpCode::ret, 0},
+    };
+    REQUIRE(vm.verify(local, 0).has_value());
+    CHECK(vm.run(local)->as_i64() == 1);
+}
+
+TEST_CASE("arena payload mode reclaims transient values per run and promotes the result")
+{
+    using namespace stella::vm;
+
+    VM vm;
+    vm.set_arena_payloads_enabled(true);
+
+    std::vector<const char*> scratch_addresses;
+    const auto scratch = static_cast<std::uint32_t>(
+        vm.bind_native("scratch", 0, [&scratch_addresses](VM& host, std::span<Value>) -> Result<Value> {
+            Value text = host.transient_string("discarded scratch text");
+            if (text.is_string_view())
+            {
+                scratch_addresses.push_back(text.as_string_view().data());
+            }
+            return text;
+        }));
+    const auto greet = static_cast<std::uint32_t>(
+        vm.bind_native("greet", 0, [](VM& host, std::span<Value>) -> Result<Value> {
+            return host.transient_string("hello from the arena");
+        }));
+
+    Program program;
+    program.code = {
+        {OpCode::call_native, scratch},
+        {OpCode::pop, 0},
+        {OpCode::call_native, greet},
+        {OpCode::halt, 0},
+    };
+
+    for (int run = 0; run < 2; ++run)
+    {
+        Result<Value> result = vm.run(program);
+        REQUIRE(result.has_value());
+        REQUIRE(result->is_owned_string());
+        CHECK(result->as_owned_string() == "hello from the arena");
+        CHECK(!vm.arena().contains(result->as_owned_string().data()));
+    }
+
+    REQUIRE(scratch_addresses.size() == 2);
+    CHECK(scratch_addresses[0] == scratch_addresses[1]);
+
+    // Host data parked in the arena before a run does not stop the run from reclaiming its own payloads.
+    const std::string_view pinned = vm.arena().copy_string("host setup that outlives every run");
+    scratch_addresses.clear();
+    for (int run = 0; run < 3; ++run)
+    {
+        REQUIRE(vm.run(program).has_value());
+    }
+    REQUIRE(scratch_addresses.size() == 3);
+    CHECK(scratch_addresses[0] == scratch_addresses[1]);
+    CHECK(scratch_addresses[1] == scratch_addresses[2]);
+    CHECK(pinned == "host setup that outlives every run");
+
+    // A resumable run abandoned mid-flight gives its arena scope back, so later runs keep reusing the same memory.
+    Program parked = program;
+    parked.code.insert(parked.code.begin() + 2, {OpCode::yield, 0});
+    scratch_addresses.clear();
+    const auto slice = vm.run_resumable(parked);
+    REQUIRE(slice.has_value());
+    CHECK(slice->status == RunStatus::yielded);
+    REQUIRE(vm.suspended());
+    for (int run = 0; run < 3; ++run)
+    {
+        REQUIRE(vm.run(program).has_value());
+    }
+    CHECK(!vm.suspended());
+    REQUIRE(scratch_addresses.size() == 4);
+    CHECK(scratch_addresses[1] == scratch_addresses[0]);
+    CHECK(scratch_addresses[2] == scratch_addresses[1]);
+    CHECK(scratch_addresses[3] == scratch_addresses[2]);
+
+    vm.set_arena_payloads_enabled(false);
+    Result<Value> heap_result = vm.run(program);
+    REQUIRE(heap_result.has_value());
+    CHECK(heap_result->is_owned_string());
+}
+
 TEST_CASE("profiling and trace hooks collect execution telemetry")
 {
     using namespace stella::vm;
@@ -818,6 +2486,246 @@ TEST_CASE("verifier validates function bodies even when not called")
     CHECK(verify.error().code == ErrorCode::invalid_local_index);
 }
 
+TEST_CASE("verifier follows function control flow into a shared tail or the next function")
+{
+    using namespace stella::vm;
+
+    VM vm;
+    Program program;
+    (void)program.add_function(1, 0, 0);
+    const auto tail = static_cast<std::uint32_t>(program.add_function(4, 0, 0));
+
+    const auto one = static_cast<std::uint32_t>(program.add_constant(Value::i64(1)));
+    program.code = {
+        {OpCode::halt, 0},
+        {OpCode::push_constant, one},
+        {OpCode::push_constant, one},
+        {OpCode::jump, 6},
+        {OpCode::push_constant, one},
+        {OpCode::push_constant, one},
+        {OpCode::add_i64, 0},
+        {OpCode::ret, 0},
+    };
+
+    const auto jump_in = vm.verify(program, 0);
+    REQUIRE_MESSAGE(jump_in.has_value(), jump_in.error().message);
+
+    // The shared tail sits in the second function's region, so patching it re-checks the function jumping in too.
+    auto state = vm.verify_with_state(program, 0);
+    REQUIRE_MESSAGE(state.has_value(), state.error().message);
+    program.code[6] = {OpCode::sub_i64, 0};
+    const auto tail_patch = vm.verify_incremental(program, state.value(), ProgramChanges {.code_ranges = {{6, 7}}});
+    REQUIRE_MESSAGE(tail_patch.has_value(), tail_patch.error().message);
+    CHECK(tail_patch->reverified_regions() == 2);
+
+    program.code[3] = {OpCode::pop, 0};
+    const auto fall_through = vm.verify(program, 0);
+    REQUIRE_MESSAGE(fall_through.has_value(), fall_through.error().message);
+
+    // A walk past the region still reports what the continued path does wrong, here a local the caller lacks.
+    program.functions[tail].local_count = 1;
+    program.code[4] = {OpCode::load_local, 0};
+    const auto foreign_local = vm.verify(program, 0);
+    REQUIRE(!foreign_local.has_value());
+    CHECK(foreign_local.error().code == ErrorCode::invalid_local_index);
+
+    constexpr std::uint32_t function_count = 50'000;
+    Program shared;
+    shared.code = {{OpCode::push_constant, one}, {OpCode::call, 0}, {OpCode::halt, 0}};
+    (void)shared.add_constant(Value::i64(1));
+    const auto epilogue = static_cast<std::uint32_t>(3 + (function_count * 2) + 1);
+    for (std::uint32_t i = 0; i < function_count; ++i)
+    {
+        (void)shared.add_function(static_cast<std::uint32_t>(shared.code.size()), 1, 1);
+        shared.code.push_back({OpCode::load_local, 0});
+        shared.code.push_back({OpCode::jump, epilogue});
+    }
+    (void)shared.add_function(static_cast<std::uint32_t>(shared.code.size()), 1, 1);
+    shared.code.push_back({OpCode::load_local, 0});
+    shared.code.push_back({OpCode::ret, 0});
+
+    const auto serial = vm.verify(shared, 0);
+    REQUIRE_MESSAGE(serial.has_value(), serial.error().message);
+    ThreadPool pool(4);
+    const auto parallel = vm.verify_parallel(shared, 0, pool);
+    REQUIRE_MESSAGE(parallel.has_value(), parallel.error().message);
+}
+
+TEST_CASE("verifier scales linearly with many small functions")
+{
+    using namespace stella::vm;
+
+    constexpr std::uint32_t function_count = 50'000;
+
+    VM vm;
+    Program program;
+    const auto one = static_cast<std::uint32_t>(program.add_constant(Value::i64(1)));
+    program.code.reserve(3 + (function_count * 4));
+    program.code.push_back({OpCode::push_constant, one});
+    program.code.push_back({OpCode::call, function_count - 1});
+    program.code.push_back({OpCode::halt, 0});
+    for (std::uint32_t i = 0; i < function_count; ++i)
+    {
+        (void)program.add_function(static_cast<std::uint32_t>(program.code.size()), 1, 1);
+        program.code.push_back({OpCode::load_local, 0});
+        program.code.push_back({OpCode::push_constant, one});
+        program.code.push_back({OpCode::add_i64, 0});
+        program.code.push_back({OpCode::ret, 0});
+    }
+
+    const auto verify = vm.verify(program, 0);
+    REQUIRE_MESSAGE(verify.has_value(), verify.error().message);
+
+    program.code[program.code.size() - 2] = {OpCode::store_local, 1};
+    const auto broken = vm.verify(program, 0);
+    REQUIRE(!broken.has_value());
+    CHECK(broken.error().code == ErrorCode::invalid_local_index);
+}
+
+TEST_CASE("parallel verifier reports the lowest failing function deterministically")
+{
+    using namespace stella::vm;
+
+    constexpr std::uint32_t function_count = 50'000;
+
+    VM vm;
+    Program program;
+    const auto one = static_cast<std::uint32_t>(program.add_constant(Value::i64(1)));
+    program.code.push_back({OpCode::push_constant, one});
+    program.code.push_back({OpCode::call, 0});
+    program.code.push_back({OpCode::halt, 0});
+    for (std::uint32_t i = 0; i < function_count; ++i)
+    {
+        (void)program.add_function(static_cast<std::uint32_t>(program.code.size()), 1, 1);
+        program.code.push_back({OpCode::load_local, 0});
+        program.code.push_back({OpCode::push_constant, one});
+        program.code.push_back({OpCode::add_i64, 0});
+        program.code.push_back({OpCode::ret, 0});
+    }
+
+    ThreadPool pool(4);
+    const auto valid = vm.verify_parallel(program, 0, pool);
+    REQUIRE_MESSAGE(valid.has_value(), valid.error().message);
+
+    const auto body_of = [](const std::uint32_t function) { return 3 + (function * 4); };
+    program.code[body_of(41'000)] = {OpCode::load_local, 3};
+    program.code[body_of(12'345) + 1] = {OpCode::push_constant, 99};
+
+    for (int attempt = 0; attempt < 8; ++attempt)
+    {
+        const auto parallel = vm.verify_parallel(program, 0, pool);
+        REQUIRE(!parallel.has_value());
+        CHECK(parallel.error().code == ErrorCode::invalid_constant_index);
+    }
+
+    const auto serial = vm.verify(program, 0);
+    REQUIRE(!serial.has_value());
+    CHECK(serial.error().code == ErrorCode::invalid_constant_index);
+
+    // Every worker blocks inside verify_parallel at once, so the queued chunks can only be verified by the callers.
+    ThreadPool saturated(2);
+    std::latch nested(2);
+    std::array<std::optional<ErrorCode>, 2> nested_errors {};
+    for (std::size_t worker = 0; worker < nested_errors.size(); ++worker)
+    {
+        saturated.execute([&, worker] {
+            const auto result = vm.verify_parallel(program, 0, saturated);
+            nested_errors[worker] = result.has_value() ? std::nullopt : std::optional(result.error().code);
+            nested.count_down();
+        });
+    }
+    nested.wait();
+    CHECK(nested_errors[0] == ErrorCode::invalid_constant_index);
+    CHECK(nested_errors[1] == ErrorCode::invalid_constant_index);
+}
+
+TEST_CASE("incremental verification re-checks only patched regions and affected callers")
+{
+    using namespace stella::vm;
+
+    VM vm;
+    Program program;
+    const auto one = static_cast<std::uint32_t>(program.add_constant(Value::i64(1)));
+    const auto inc = static_cast<std::uint32_t>(program.add_function(4, 1, 1));
+    const auto twice = static_cast<std::uint32_t>(program.add_function(8, 1, 1));
+    const auto unrelated = static_cast<std::uint32_t>(program.add_function(13, 0, 0));
+
+    program.code = {
+        {OpCode::push_constant, one},
+        {OpCode::call, twice},
+        {OpCode::halt, 0},
+        {OpCode::halt, 0},
+        {OpCode::load_local, 0},
+        {OpCode::push_constant, one},
+        {OpCode::add_i64, 0},
+        {OpCode::ret, 0},
+        {OpCode::load_local, 0},
+        {OpCode::call, inc},
+        {OpCode::call, inc},
+        {OpCode::ret, 0},
+        {OpCode::halt, 0},
+        {OpCode::push_constant, one},
+        {OpCode::ret, 0},
+    };
+    (void)unrelated;
+
+    auto state = vm.verify_with_state(program, 0);
+    REQUIRE_MESSAGE(state.has_value(), state.error().message);
+    CHECK(state->reverified_regions() == 4);
+
+    program.code[5] = {OpCode::dup, 0};
+    const auto body_patch = vm.verify_incremental(program, state.value(), ProgramChanges {.functions = {inc}});
+    REQUIRE_MESSAGE(body_patch.has_value(), body_patch.error().message);
+    CHECK(body_patch->reverified_regions() == 1);
+
+    const auto range_patch =
+        vm.verify_incremental(program, body_patch.value(), ProgramChanges {.code_ranges = {{5, 6}}});
+    REQUIRE(range_patch.has_value());
+    CHECK(range_patch->reverified_regions() == 1);
+
+    program.functions[inc].arity = 0;
+    const auto signature_patch = vm.verify_incremental(program, range_patch.value(), ProgramChanges {});
+    REQUIRE(signature_patch.has_value());
+    CHECK(signature_patch->reverified_regions() == 2);
+
+    program.code[8] = {OpCode::push_constant, 7};
+    const auto bad_patch =
+        vm.verify_incremental(program, signature_patch.value(), ProgramChanges {.functions = {twice}});
+    REQUIRE(!bad_patch.has_value());
+    CHECK(bad_patch.error().code == ErrorCode::invalid_constant_index);
+
+    const auto full = vm.verify(program, 0);
+    REQUIRE(!full.has_value());
+    CHECK(full.error().code == bad_patch.error().code);
+
+    struct Pair final
+    {
+        std::int64_t first = 0;
+        std::int64_t second = 0;
+    };
+    const auto wide =
+        RecordSchema::of<Pair>({record_field<&Pair::first>("first"), record_field<&Pair::second>("second")});
+    const auto narrow = RecordSchema::of<Pair>({record_field<&Pair::first>("first")});
+    REQUIRE(wide.has_value());
+    REQUIRE(narrow.has_value());
+
+    VM record_vm;
+    const Pair pair {3, 4};
+    REQUIRE(record_vm.bind_record(*wide, pair).has_value());
+    Program record_program;
+    record_program.code = {{OpCode::load_field_i64, field_operand(0, 1)}, {OpCode::halt, 0}};
+    auto record_state = record_vm.verify_with_state(record_program, 0);
+    REQUIRE(record_state.has_value());
+
+    // No code changed, but slot 0 now has one field, so the base state no longer vouches for reading field 1.
+    record_vm.clear_records();
+    REQUIRE(record_vm.bind_record(*narrow, pair).has_value());
+    const auto rebound = record_vm.verify_incremental(record_program, record_state.value(), ProgramChanges {});
+    REQUIRE(!rebound.has_value());
+    CHECK(rebound.error().code == ErrorCode::invalid_field_index);
+    CHECK(record_vm.verify(record_program, 0).error().code == ErrorCode::invalid_field_index);
+}
+
 TEST_CASE("arithmetic overflow returns explicit error")
 {
     using namespace stella::vm;
@@ -907,3 +2815,208 @@ TEST_CASE("bytecode parser rejects excessive instruction count")
     REQUIRE(!decoded.has_value());
     CHECK(decoded.error().code == ErrorCode::bytecode_limit_exceeded);
 }
+
+TEST_CASE("program registry publishes versions and defers reclamation until readers release")
+{
+    using namespace stella::vm;
+
+    const auto make_program = [](const std::int64_t value) {
+        Program program;
+        const auto constant = static_cast<std::uint32_t>(program.add_constant(Value::i64(value)));
+        program.code = {
+            {OpCode::push_constant, constant},
+            {OpCode::halt, 0},
+        };
+        return program;
+    };
+
+    VM vm;
+    ProgramRegistry registry;
+    auto reader = registry.reader();
+    CHECK(!reader.acquire());
+
+    const auto first = registry.publish(make_program(1), vm, 0);
+    REQUIRE(first.has_value());
+    CHECK(first.value() == 1);
+
+    {
+        auto pinned = reader.acquire();
+        REQUIRE(pinned);
+        CHECK(pinned.version() == 1);
+
+        const auto second = registry.publish(make_program(2), vm, 0);
+        REQUIRE(second.has_value());
+        CHECK(registry.current_version() == 2);
+        CHECK(registry.retired_versions() == 1);
+
+        const auto pinned_result = vm.run_unchecked(pinned.program());
+        REQUIRE(pinned_result.has_value());
+        CHECK(pinned_result->as_i64() == 1);
+    }
+
+    CHECK(registry.collect() == 1);
+    CHECK(registry.retired_versions() == 0);
+
+    Program invalid;
+    invalid.code = {{OpCode::jump, 42}};
+    const auto rejected = registry.publish(std::move(invalid), vm, 0);
+    REQUIRE(!rejected.has_value());
+    CHECK(rejected.error().code == ErrorCode::invalid_jump_target);
+    CHECK(registry.current_version() == 2);
+
+    auto latest = reader.acquire();
+    const auto latest_result = vm.run_unchecked(latest.program());
+    REQUIRE(latest_result.has_value());
+    CHECK(latest_result->as_i64() == 2);
+}
+
+TEST_CASE("program registry readers run concurrently with publishers")
+{
+    using namespace stella::vm;
+
+    VM verifier;
+    ProgramRegistry registry;
+
+    const auto make_program = [](const std::int64_t value) {
+        Program program;
+        const auto constant = static_cast<std::uint32_t>(program.add_constant(Value::i64(value)));
+        program.code = {
+            {OpCode::push_constant, constant},
+            {OpCode::halt, 0},
+        };
+        return program;
+    };
+    REQUIRE(registry.publish(make_program(0), verifier, 0).has_value());
+
+    std::atomic<bool> stop {false};
+    std::atomic<int> regressions {0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t)
+    {
+        workers.emplace_back([&] {
+            VM vm;
+            auto reader = registry.reader();
+            std::int64_t last_seen = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                auto snapshot = reader.acquire();
+                const auto result = vm.run_unchecked(snapshot.program());
+                if (!result.has_value() || result->as_i64() < last_seen ||
+                    result->as_i64() != static_cast<std::int64_t>(snapshot.version()) - 1)
+                {
+                    regressions.fetch_add(1, std::memory_order_relaxed);
+                }
+                last_seen = result.has_value() ? result->as_i64() : last_seen;
+            }
+        });
+    }
+
+    for (std::int64_t value = 1; value <= 200; ++value)
+    {
+        REQUIRE(registry.publish(make_program(value), verifier, 0).has_value());
+    }
+    stop.store(true, std::memory_order_relaxed);
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    (void)registry.collect();
+    CHECK(regressions.load() == 0);
+    CHECK(registry.current_version() == 201);
+    CHECK(registry.retired_versions() == 0);
+}
+
+TEST_CASE("program cache reuses prepared artifacts across instances and evicts by size")
+{
+    using namespace stella::vm;
+
+    const std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / ("stella_vm_cache_test_" + std::to_string(std::random_device {}()));
+    std::filesystem::remove_all(directory);
+
+    VM vm;
+    (void)vm.native("twice").bind([](std::int64_t value) { return value * 2; });
+
+    const auto make_bytecode = [](const std::int64_t value) {
+        Program program;
+        const auto constant = static_cast<std::uint32_t>(program.add_constant(Value::i64(value)));
+        program.code = {
+            {OpCode::push_constant, constant},
+            {OpCode::call_native, 0},
+            {OpCode::halt, 0},
+        };
+        return serialize_program(program).value();
+    };
+
+    const MoveBuffer bytecode = make_bytecode(21);
+    int prepare_calls = 0;
+    const auto prepare = [&prepare_calls](Program program) -> Result<Program> {
+        ++prepare_calls;
+        return program;
+    };
+
+    {
+        ProgramCache cache(directory);
+        const auto first = cache.load(bytecode.bytes(), vm, 0, "test-pipeline", prepare);
+        REQUIRE(first.has_value());
+        CHECK(cache.stats().misses == 1);
+        CHECK(cache.stats().stores == 1);
+        CHECK(prepare_calls == 1);
+    }
+
+    {
+        ProgramCache restarted(directory);
+        const auto cached = restarted.load(bytecode.bytes(), vm, 0, "test-pipeline", prepare);
+        REQUIRE(cached.has_value());
+        CHECK(restarted.stats().hits == 1);
+        CHECK(prepare_calls == 1);
+
+        const auto result = vm.run(cached.value());
+        REQUIRE(result.has_value());
+        CHECK(result->as_i64() == 42);
+
+        VM other_natives;
+        (void)other_natives.native("twice").arity(1).bind([](std::int64_t value) { return value * 3; });
+        (void)other_natives.native("extra").bind([](std::int64_t value) { return value; });
+        const auto different_table = restarted.load(bytecode.bytes(), other_natives, 0, "test-pipeline", prepare);
+        REQUIRE(different_table.has_value());
+        CHECK(restarted.stats().misses == 1);
+        CHECK(prepare_calls == 2);
+    }
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory))
+    {
+        if (entry.is_regular_file())
+        {
+            std::filesystem::resize_file(entry.path(), 20);
+        }
+    }
+
+    {
+        ProgramCache corrupted(directory, 1024);
+        const auto reloaded = corrupted.load(bytecode.bytes(), vm, 0, "test-pipeline", prepare);
+        REQUIRE(reloaded.has_value());
+        CHECK(corrupted.stats().corrupt_entries == 1);
+        CHECK(corrupted.stats().misses == 1);
+
+        for (std::int64_t value = 0; value < 64; ++value)
+        {
+            const MoveBuffer extra = make_bytecode(value);
+            REQUIRE(corrupted.load(extra.bytes(), vm, 0).has_value());
+        }
+        CHECK(corrupted.stats().evictions > 0);
+
+        std::uintmax_t total_bytes = 0;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(directory))
+        {
+            if (entry.is_regular_file())
+            {
+                total_bytes += entry.file_size();
+            }
+        }
+        CHECK(total_bytes <= 1024);
+    }
+
+    std::filesystem::remove_all(directory);
+}